@@ -0,0 +1,217 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+
+#include "AllocTracker.h"
+#include "IDSource.h"
+#include "Random.h"
+
+namespace FTK::Bench
+{
+    Options Options::parse(int argc, char **argv)
+    {
+        Options res;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--filter")
+                res.filter = next();
+            else if (arg == "--samples")
+                res.samples = std::max<size_t>(1, std::stoul(next()));
+            else if (arg == "--warmup")
+                res.warmup = std::stoul(next());
+            else if (arg == "--seed")
+                res.seed = std::stoul(next());
+            else if (arg == "--json")
+                res.jsonOutput = next();
+            else if (arg == "--baseline")
+                res.baseline = next();
+            else if (arg == "--threshold")
+                res.threshold = std::stod(next());
+            else if (arg == "--list")
+                res.listOnly = true;
+            else
+                throw std::invalid_argument("Unknown argument " + arg);
+        }
+        return res;
+    }
+
+    Runner::Runner(const Options &options) : options(options)
+    {
+    }
+
+    void Runner::add(const Benchmark &benchmark)
+    {
+        benchmarks.push_back(benchmark);
+    }
+
+    void Runner::add(const std::string &name, size_t batch, const std::function<void()> &body, const std::function<void()> &setup)
+    {
+        add(Benchmark{name, batch, body, setup});
+    }
+
+    void Runner::setAllocBudget(const std::string &name, double maxAllocsPerOp)
+    {
+        for (auto &b : benchmarks)
+            if (b.name == name)
+                b.allocBudget = maxAllocsPerOp;
+    }
+
+    std::vector<std::string> Runner::list() const
+    {
+        std::vector<std::string> res;
+        for (auto &b : benchmarks)
+            if (matches(b.name))
+                res.push_back(b.name);
+        return res;
+    }
+
+    std::vector<Result> Runner::run() const
+    {
+        std::vector<Result> res;
+        for (auto &b : benchmarks)
+            if (matches(b.name))
+                res.push_back(measure(b));
+        return res;
+    }
+
+    bool Runner::matches(const std::string &name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+
+    Result Runner::measure(const Benchmark &benchmark) const
+    {
+        using clock = std::chrono::steady_clock;
+
+        // every benchmark sees the same random sequence regardless of which ones ran before it
+        Random::getInstance()->seed(options.seed);
+        IDSource::setInstance(std::make_shared<SeededIDSource>(options.seed));
+
+        std::vector<double> timings;
+        timings.reserve(options.samples);
+        AllocCounters allocs;
+        for (size_t i = 0; i < options.warmup + options.samples; i++)
+        {
+            if (benchmark.setup)
+                benchmark.setup();
+            auto before = AllocTracker::getThreadCounters();
+            auto start = clock::now();
+            for (size_t k = 0; k < benchmark.batch; k++)
+                benchmark.body();
+            auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            auto after = AllocTracker::getThreadCounters();
+            if (i >= options.warmup)
+            {
+                timings.push_back(elapsed / benchmark.batch);
+                allocs.allocations += after.allocations - before.allocations;
+                allocs.bytes += after.bytes - before.bytes;
+            }
+        }
+
+        std::sort(timings.begin(), timings.end());
+        auto n = timings.size();
+        auto mean = std::accumulate(timings.begin(), timings.end(), 0.0) / n;
+        double variance = 0;
+        for (auto t : timings)
+            variance += (t - mean) * (t - mean);
+        variance = n > 1 ? variance / (n - 1) : 0;
+        auto median = n % 2 ? timings[n / 2] : (timings[n / 2 - 1] + timings[n / 2]) / 2;
+        auto p95 = timings[std::min(n - 1, (size_t)std::ceil(n * 0.95) - 1)];
+
+        auto ops = (double)n * benchmark.batch;
+        return Result{benchmark.name, benchmark.batch, n, mean, median, std::sqrt(variance), timings.front(), timings.back(), p95, allocs.allocations / ops, allocs.bytes / ops, benchmark.allocBudget};
+    }
+
+    nlohmann::ordered_json Runner::toJson(const std::vector<Result> &results) const
+    {
+        nlohmann::ordered_json j;
+        j["seed"] = options.seed;
+        j["warmup"] = options.warmup;
+        j["samples"] = options.samples;
+        j["unit"] = "ns/op";
+        j["results"] = nlohmann::ordered_json::array();
+        for (auto &r : results)
+        {
+            nlohmann::ordered_json entry;
+            entry["name"] = r.name;
+            entry["batch"] = r.batch;
+            entry["samples"] = r.samples;
+            entry["mean"] = r.mean;
+            entry["median"] = r.median;
+            entry["stddev"] = r.stddev;
+            entry["min"] = r.min;
+            entry["max"] = r.max;
+            entry["p95"] = r.p95;
+            if (AllocTracker::isEnabled())
+            {
+                entry["allocs_per_op"] = r.allocsPerOp;
+                entry["bytes_per_op"] = r.bytesPerOp;
+            }
+            j["results"].push_back(entry);
+        }
+        return j;
+    }
+
+    void Runner::print(const std::vector<Result> &results) const
+    {
+        std::printf("%-40s %12s %12s %12s %12s %12s %12s\n", "benchmark", "median", "mean", "stddev", "min", "p95", "allocs/op");
+        for (auto &r : results)
+        {
+            std::printf("%-40s %12.1f %12.1f %12.1f %12.1f %12.1f ", r.name.c_str(), r.median, r.mean, r.stddev, r.min, r.p95);
+            if (AllocTracker::isEnabled())
+                std::printf("%12.2f\n", r.allocsPerOp);
+            else
+                std::printf("%12s\n", "-");
+        }
+    }
+
+    bool Runner::compare(const std::vector<Result> &results, const nlohmann::json &baseline) const
+    {
+        bool regressed = false;
+        std::printf("\n%-40s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+        for (auto &r : results)
+        {
+            auto it = std::find_if(baseline["results"].begin(), baseline["results"].end(), [&r](auto &e)
+                                   { return e["name"] == r.name; });
+            if (it == baseline["results"].end())
+            {
+                std::printf("%-40s %12s %12.1f %9s\n", r.name.c_str(), "-", r.median, "new");
+                continue;
+            }
+            // medians are compared since they are far less sensitive to scheduler noise than means
+            auto base = (*it)["median"].get<double>();
+            auto change = base > 0 ? r.median / base - 1 : 0;
+            auto flag = change > options.threshold;
+            regressed |= flag;
+            std::printf("%-40s %12.1f %12.1f %+8.1f%%%s\n", r.name.c_str(), base, r.median, change * 100, flag ? " REGRESSION" : "");
+        }
+        return !regressed;
+    }
+
+    bool Runner::checkAllocBudgets(const std::vector<Result> &results) const
+    {
+        if (!AllocTracker::isEnabled())
+            return true;
+        bool exceeded = false;
+        for (auto &r : results)
+        {
+            if (r.allocBudget < 0 || r.allocsPerOp <= r.allocBudget)
+                continue;
+            std::printf("%s: %.2f allocations per op exceeds budget of %.2f\n", r.name.c_str(), r.allocsPerOp, r.allocBudget);
+            exceeded = true;
+        }
+        return !exceeded;
+    }
+} // namespace FTK::Bench
@@ -0,0 +1,87 @@
+#ifndef FTK_BENCH_BENCH_H
+#define FTK_BENCH_BENCH_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace FTK::Bench
+{
+    struct Options
+    {
+        size_t warmup = 5;
+        size_t samples = 30;
+        unsigned int seed = 1122;
+        std::string filter;
+        std::string jsonOutput;
+        std::string baseline;
+        double threshold = 0.1;
+        bool listOnly = false;
+
+        static Options parse(int argc, char **argv);
+    };
+
+    struct Benchmark
+    {
+        std::string name;
+        size_t batch;
+        std::function<void()> body;
+        std::function<void()> setup;
+        double allocBudget = -1;
+    };
+
+    // all timings are in nanoseconds per operation
+    struct Result
+    {
+        std::string name;
+        size_t batch;
+        size_t samples;
+        double mean;
+        double median;
+        double stddev;
+        double min;
+        double max;
+        double p95;
+        double allocsPerOp;
+        double bytesPerOp;
+        double allocBudget;
+    };
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options &options);
+
+        void add(const Benchmark &benchmark);
+        void add(const std::string &name, size_t batch, const std::function<void()> &body, const std::function<void()> &setup = {});
+        void setAllocBudget(const std::string &name, double maxAllocsPerOp);
+
+        std::vector<std::string> list() const;
+        std::vector<Result> run() const;
+
+        nlohmann::ordered_json toJson(const std::vector<Result> &results) const;
+        void print(const std::vector<Result> &results) const;
+        bool compare(const std::vector<Result> &results, const nlohmann::json &baseline) const;
+        bool checkAllocBudgets(const std::vector<Result> &results) const;
+
+    private:
+        bool matches(const std::string &name) const;
+        Result measure(const Benchmark &benchmark) const;
+
+        Options options;
+        std::vector<Benchmark> benchmarks;
+    };
+
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+        static const void *volatile sink;
+        sink = &value;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+} // namespace FTK::Bench
+
+#endif // FTK_BENCH_BENCH_H
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "bench.h"
+#include "suites.h"
+
+int main(int argc, char **argv)
+{
+    FTK::Bench::Options options;
+    try
+    {
+        options = FTK::Bench::Options::parse(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << "usage: ftk-bench [--filter substr] [--samples n] [--warmup n] [--seed n] [--json out.json] [--baseline base.json] [--threshold 0.1] [--list]\n";
+        return 2;
+    }
+
+    FTK::Bench::Runner runner(options);
+    FTK::Bench::registerAllBenchmarks(runner);
+
+    if (options.listOnly)
+    {
+        for (auto &name : runner.list())
+            std::cout << name << "\n";
+        return 0;
+    }
+
+    auto results = runner.run();
+    runner.print(results);
+
+    if (!options.jsonOutput.empty())
+    {
+        std::ofstream ofs(options.jsonOutput);
+        ofs << std::setw(4) << runner.toJson(results);
+    }
+
+    auto withinBudget = runner.checkAllocBudgets(results);
+
+    if (!options.baseline.empty())
+    {
+        std::ifstream ifs(options.baseline);
+        if (!ifs)
+        {
+            std::cerr << "Cannot open baseline " << options.baseline << "\n";
+            return 2;
+        }
+        nlohmann::json baseline;
+        ifs >> baseline;
+        if (!runner.compare(results, baseline))
+            return 1;
+    }
+    return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,560 @@
+#include "suites.h"
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+
+#include <nlohmann/json.hpp>
+
+#include "CombatAI.h"
+#include "Dice.h"
+#include "Entity.h"
+#include "Expr.h"
+#include "GameManager.h"
+#include "GameSession.h"
+#include "GameSnapshot.h"
+#include "IDSource.h"
+#include "MapLoader.h"
+#include "Modifier.h"
+#include "Registry.h"
+#include "SaveContainer.h"
+#include "Serializer.h"
+#include "SessionHost.h"
+#include "World.h"
+#include "WorldGenerator.h"
+#include "combat.h"
+
+namespace FTK::Bench
+{
+    static nlohmann::json loadJson(const std::string &path)
+    {
+        std::ifstream ifs(path);
+        if (!ifs)
+            throw std::invalid_argument("Cannot open " + path);
+        nlohmann::json j;
+        ifs >> j;
+        return j;
+    }
+
+    static const nlohmann::json &demoMap()
+    {
+        static const auto j = loadJson("assets/gamedata/demo_map.json");
+        return j;
+    }
+
+    static nlohmann::json withAttribute(nlohmann::json j, const std::string &name, double base)
+    {
+        for (auto &attr : j["attributes"])
+            if (attr["name"] == name)
+                attr["base"] = base;
+        return j;
+    }
+
+    static std::shared_ptr<Player> makePlayer(const std::string &weaponID = {}, double speed = 0)
+    {
+        auto j = demoMap()["world"]["players"][0];
+        if (speed)
+            j = withAttribute(j, "speed", speed);
+        auto ep = j.get<std::shared_ptr<Player>>();
+        if (!weaponID.empty())
+            ep->addEquipment(MainRegistry::getInstance()->equipmentTemplates->get(weaponID).build());
+        return ep;
+    }
+
+    static std::shared_ptr<Enemy> makeEnemy(double maxHP = 0)
+    {
+        auto j = demoMap()["world"]["entities"][0];
+        if (maxHP)
+            j = withAttribute(j, "max_hp", maxHP);
+        return j.get<std::shared_ptr<Enemy>>();
+    }
+
+    static WorldGeneratorOptions generatorOptions(unsigned int seed, const Vec2i &dimension = WorldGeneratorOptions().dimension, size_t enemyCount = WorldGeneratorOptions().enemyCount)
+    {
+        WorldGeneratorOptions options;
+        options.seed = seed;
+        options.dimension = dimension;
+        options.enemyCount = enemyCount;
+        return options;
+    }
+
+    // the serializers only write ordered_json, so the generated document is round-tripped through text
+    static nlohmann::json generateSave(const WorldGeneratorOptions &options)
+    {
+        return nlohmann::json::parse(WorldGenerator(options).generate().dump());
+    }
+
+    // a seeded session of its own, so a suite neither sees nor disturbs the process-wide game
+    static std::shared_ptr<GameSession> makeSession()
+    {
+        return std::make_shared<GameSession>(1u);
+    }
+
+    // a setup loading a generated map into the session on its first run only, then calling loaded
+    static std::function<void()> loadGenerated(const std::shared_ptr<GameSession> &session, const WorldGeneratorOptions &options, const std::function<void()> &loaded = {})
+    {
+        auto done = std::make_shared<bool>(false);
+        return [session, options, loaded, done]()
+        {
+            if (*done)
+                return;
+            GameSession::Scope scope(*session);
+            GameManager::getInstance()->loadMapFromJson(generateSave(options));
+            if (loaded)
+                loaded();
+            *done = true;
+        };
+    }
+
+    // contexts hang off a child scope so the benchmarks never write into the shared global scope
+    static Math::Context childScope()
+    {
+        return Math::Context::default_global().getChild();
+    }
+
+    void registerExprBenchmarks(Runner &runner)
+    {
+        // the bindings only hold weak references, the lambdas keep the entities alive
+        auto ep = makePlayer();
+        auto enemy = makeEnemy();
+        auto self = std::make_shared<Math::Bindings>(childScope());
+        ep->bindMathContext("self", *self);
+        auto target = std::make_shared<Math::Bindings>(childScope());
+        enemy->bindMathContext("target", *target);
+
+        auto skillCtx = std::make_shared<Math::Bindings>(childScope());
+        MainRegistry::getInstance()->activeSkills->get("active:basic_attack").bindContext("skill", *skillCtx);
+        (*skillCtx)["did_damage"] = true;
+        (*skillCtx)["rolled_result"] = 2;
+
+        auto constant = std::make_shared<Math::Expression>("25");
+        auto attribute = std::make_shared<Math::Expression>("self.atk");
+        auto function = std::make_shared<Math::Expression>("max(self.hp*0.1, 1)");
+        auto absorption = std::make_shared<Math::Expression>("target.p_def/(target.p_def+50)");
+        // same value, but no registered formula matches the text
+        auto absorptionCparse = std::make_shared<Math::Expression>("target.p_def/(target.p_def+50.0)");
+        auto condition = std::make_shared<Math::Condition>("skill.target_type==TargetType.Single && did_damage");
+
+        runner.add("expr/eval_constant", 1000, [constant, self, ep]()
+                   { doNotOptimize(constant->eval(*self)); });
+        runner.add("expr/eval_attribute", 1000, [attribute, self, ep]()
+                   { doNotOptimize(attribute->eval(*self)); });
+        runner.add("expr/eval_function", 1000, [function, self, ep]()
+                   { doNotOptimize(function->eval(*self)); });
+        runner.add("expr/eval_absorption", 1000, [absorption, target, enemy]()
+                   { doNotOptimize(absorption->eval(*target)); });
+        runner.add("expr/eval_absorption_cparse", 1000, [absorptionCparse, target, enemy]()
+                   { doNotOptimize(absorptionCparse->eval(*target)); });
+        runner.add("expr/eval_condition", 1000, [condition, skillCtx]()
+                   { doNotOptimize(condition->eval(*skillCtx)); });
+        runner.add("expr/construct", 100, [absorption]()
+                   { Math::Expression copy(*absorption);
+                     doNotOptimize(copy); });
+        runner.add("expr/construct_interned", 100, [absorption]()
+                   { Math::Expression same(absorption->getRawExpr());
+                     doNotOptimize(same); });
+        runner.add("expr/resolve_absorption", 1000, [absorption, target, enemy]()
+                   { doNotOptimize(target->resolve(absorption->getVariables())); });
+    }
+
+    void registerEntityBenchmarks(Runner &runner)
+    {
+        auto ep = makePlayer("weapon:hammer");
+
+        runner.add("entity/get_attribute", 10000, [ep]()
+                   { doNotOptimize(ep->get("speed")); });
+        runner.add("entity/get_stat", 10000, [ep]()
+                   { doNotOptimize(ep->get("focus")); });
+        runner.setAllocBudget("entity/get_attribute", 0);
+        runner.setAllocBudget("entity/get_stat", 0);
+        runner.add("entity/get_skill_cd", 1000, [ep]()
+                   { doNotOptimize(ep->getPassiveSkillCD()); });
+        runner.add("entity/view_skill_cd", 1000, [ep]()
+                   {
+                       int total = 0;
+                       ep->forEachPassiveSkillCD([&total](const std::string &, int cd)
+                                                 { total += cd; });
+                       doNotOptimize(total); });
+        runner.add("entity/view_buffs_equipments", 1000, [ep]()
+                   { doNotOptimize(ep->viewBuffs().size() + ep->viewEquipments().size()); });
+        runner.setAllocBudget("entity/view_skill_cd", 0);
+        runner.setAllocBudget("entity/view_buffs_equipments", 0);
+        runner.add("entity/bind_math_context", 1000, [ep]()
+                   {
+                       Math::Bindings bindings(childScope());
+                       ep->bindMathContext("self", bindings);
+                       doNotOptimize(bindings.isBound("self")); });
+
+        auto value = std::make_shared<ModifiableValue>(100);
+        runner.add("modifier/add_remove", 1000, [value]()
+                   {
+                       Modifier mod("bench", ModifierType::DirectAdd, 10);
+                       value->addModifier(mod);
+                       value->removeModifier(mod.uuid);
+                       doNotOptimize(value->get()); });
+
+        auto stacked = std::make_shared<ModifiableValue>(100);
+        for (int i = 0; i < 16; i++)
+            stacked->addModifier(Modifier("stack", i % 2 ? ModifierType::DirectMult : ModifierType::DirectAdd, 0.01 * i));
+        runner.add("modifier/add_remove_stacked", 1000, [stacked]()
+                   {
+                       Modifier mod("bench", ModifierType::FinalAdd, 10);
+                       stacked->addModifier(mod);
+                       stacked->removeModifier(mod.uuid);
+                       doNotOptimize(stacked->get()); });
+
+        auto buffed = makeEnemy(1000);
+        runner.add("entity/tick_buffs", 100, [buffed]()
+                   { buffed->updateBuffs(); },
+                   [buffed]()
+                   {
+                       buffed->clearBuffs();
+                       for (auto buffTemplate : *MainRegistry::getInstance()->buffTemplates)
+                           buffed->addBuff(buffTemplate.build(1000)); });
+
+        auto equipment = MainRegistry::getInstance()->equipmentTemplates->get("armor:plate_armor").build();
+        runner.add("entity/equip_unequip", 100, [ep, equipment]()
+                   {
+                       ep->addEquipment(equipment);
+                       doNotOptimize(ep->removeEquipment(EquipmentType::Armor)); });
+    }
+
+    void registerRegistryBenchmarks(Runner &runner)
+    {
+        auto registry = MainRegistry::getInstance();
+        runner.add("registry/get_first", 1000, [registry]()
+                   { doNotOptimize(registry->activeSkills->get("active:basic_attack")); });
+        runner.add("registry/get_last", 1000, [registry]()
+                   { doNotOptimize(registry->activeSkills->get("active:seppuku")); });
+        runner.add("registry/get_equipment", 1000, [registry]()
+                   { doNotOptimize(registry->equipmentTemplates->get("accessory:bracelet")); });
+        runner.add("registry/get_instance", 1000, []()
+                   { doNotOptimize(MainRegistry::getInstance()); });
+        auto buffTemplate = std::make_shared<BuffTemplate>(registry->buffTemplates->get("debuff:poisoned"));
+        runner.add("registry/build_buff", 1000, [buffTemplate]()
+                   { doNotOptimize(buffTemplate->build(3)); });
+        auto equipmentTemplate = registry->equipmentTemplates->get("armor:plate_armor");
+        runner.add("registry/build_equipment", 1000, [equipmentTemplate]()
+                   { doNotOptimize(equipmentTemplate.build()); });
+
+        SystemIDSource systemSource;
+        auto seededSource = std::make_shared<SeededIDSource>(1122);
+        runner.add("id/system", 10000, [systemSource]() mutable
+                   { doNotOptimize(systemSource.next()); });
+        runner.add("id/seeded", 10000, [seededSource]()
+                   { doNotOptimize(seededSource->next()); });
+
+        auto activeJson = std::make_shared<nlohmann::json>(loadJson("assets/gamedata/active_skills.json"));
+        auto equipmentJson = std::make_shared<nlohmann::json>(loadJson("assets/gamedata/equipment_templates.json"));
+        runner.add("registry/load_active_skills", 10, [activeJson]()
+                   { doNotOptimize(activeJson->get<std::shared_ptr<Registry<ActiveSkill>>>()); });
+        runner.add("registry/load_equipment_templates", 10, [equipmentJson]()
+                   { doNotOptimize(equipmentJson->get<std::shared_ptr<Registry<EquipmentTemplate>>>()); });
+        // reloaded into a snapshot of its own, publishing it would change the data of the suites run after
+        runner.add("registry/reload_active_skills", 10, [registry]()
+                   { doNotOptimize(registry->reloaded("active_skills.json")); });
+        runner.add("registry/save_active_skills", 10, [registry]()
+                   {
+                       nlohmann::ordered_json j = registry->activeSkills;
+                       doNotOptimize(j.dump()); });
+    }
+
+    void registerWorldBenchmarks(Runner &runner)
+    {
+        auto worldJson = std::make_shared<nlohmann::json>(demoMap()["world"]);
+        auto world = worldJson->get<std::shared_ptr<World>>();
+
+        runner.add("world/get_entities_at_hit", 1000, [world]()
+                   { doNotOptimize(world->getEntitiesAt(137, 49)); });
+        runner.add("world/get_entities_at_miss", 1000, [world]()
+                   { doNotOptimize(world->getEntitiesAt(0, 0)); });
+        runner.add("world/get_players_at", 1000, [world]()
+                   { doNotOptimize(world->getPlayersAt(135, 47)); });
+        runner.add("world/load_json", 1, [worldJson]()
+                   { doNotOptimize(worldJson->get<std::shared_ptr<World>>()); });
+        runner.add("world/save_json", 1, [world]()
+                   {
+                       nlohmann::ordered_json j = world;
+                       doNotOptimize(j.dump()); });
+        runner.add("world/parse_and_load", 1, []()
+                   {
+                       auto j = nlohmann::json::parse(demoMap().dump());
+                       doNotOptimize(j["world"].get<std::shared_ptr<World>>()); });
+        runner.add("world/stream_load", 1, []()
+                   {
+                       std::istringstream is(demoMap().dump());
+                       doNotOptimize(MapLoader::load(is).world); });
+
+        auto options = generatorOptions(1, Vec2i(500, 500), 5000);
+        options.playerCount = 50;
+        options.shopCount = 20;
+        auto largeJson = std::make_shared<nlohmann::json>(generateSave(options)["world"]);
+        auto large = largeJson->get<std::shared_ptr<World>>();
+        auto probe = large->entities.front()->getPos();
+
+        runner.add("world/large_get_entities_at", 100, [large, probe]()
+                   { doNotOptimize(large->getEntitiesAt(probe)); });
+        auto nearby = std::make_shared<std::vector<EntityHandle>>();
+        runner.add("world/large_entities_in_radius", 100, [large, probe, nearby]()
+                   {
+                       large->getEntitiesInRadius(probe, BattleRadius, *nearby);
+                       doNotOptimize(nearby->size()); });
+        runner.add("world/large_players_in_rect", 100, [large, probe, nearby]()
+                   {
+                       large->getPlayersInRect(probe - Vec2i(50, 50), probe + Vec2i(50, 50), *nearby);
+                       doNotOptimize(nearby->size()); });
+        auto start = large->players.front()->getPos();
+        auto goal = large->players.back()->getPos();
+        runner.add("world/large_distance_field", 1, [large, start]()
+                   {
+                       large->getPathfinder()->invalidate();
+                       doNotOptimize(large->getPathfinder()->getDistanceField(start)); });
+        runner.add("world/large_reachable_cached", 100, [large, start]()
+                   { doNotOptimize(large->getPathfinder()->getReachable(start, 10)); });
+        runner.add("world/large_find_path", 1, [large, start, goal]()
+                   {
+                       large->getPathfinder()->invalidate();
+                       doNotOptimize(large->getPathfinder()->findPath(start, goal)); });
+        runner.add("world/large_reveal_players", 100, [large]()
+                   {
+                       VisibilityMap visibility(large->dimension);
+                       for (auto &ep : large->players)
+                           visibility.reveal(ep->getPos());
+                       doNotOptimize(visibility.getChangedCells().size()); });
+        runner.add("world/large_encode_visibility", 10, [large]()
+                   { doNotOptimize(large->getVisibility().encode()); });
+        runner.add("world/large_count_alive_objects", 10, [large]()
+                   {
+                       size_t alive = 0;
+                       for (auto &e : large->entities)
+                           alive += !e->isDead();
+                       doNotOptimize(alive); });
+        runner.add("world/large_count_alive_components", 10, [large]()
+                   {
+                       size_t alive = 0;
+                       for (auto f : large->getComponents().flags)
+                           alive += !(f & ComponentFlag_Dead);
+                       doNotOptimize(alive); });
+        runner.add("world/large_load_json", 1, [largeJson]()
+                   { doNotOptimize(largeJson->get<std::shared_ptr<World>>()); });
+        auto largeText = std::make_shared<std::string>(nlohmann::json{{"world", *largeJson}}.dump());
+        runner.add("world/large_parse_and_load", 1, [largeText]()
+                   { doNotOptimize(nlohmann::json::parse(*largeText)["world"].get<std::shared_ptr<World>>()); });
+        runner.add("world/large_stream_load", 1, [largeText]()
+                   {
+                       std::istringstream is(*largeText);
+                       doNotOptimize(MapLoader::load(is).world); });
+        auto largeSave = std::make_shared<SaveContainer>();
+        largeSave->put("world", largeJson->dump());
+        auto largeEncoded = std::make_shared<std::vector<uint8_t>>(largeSave->encode());
+        runner.add("save/large_compress", 1, [largeJson]()
+                   {
+                       SaveContainer container;
+                       container.put("world", largeJson->dump());
+                       doNotOptimize(container.encode()); });
+        runner.add("save/large_decompress", 1, [largeSave]()
+                   { doNotOptimize(largeSave->get("world")); });
+        runner.add("save/large_decode_checked", 1, [largeEncoded]()
+                   { doNotOptimize(SaveContainer::decode(*largeEncoded)); });
+        runner.add("world/large_save_json", 1, [large]()
+                   {
+                       nlohmann::ordered_json j = large;
+                       doNotOptimize(j.dump()); });
+    }
+
+    // resolveAction/processAction are private, so a turn is staged through the public state machine
+    // and every op re-enters ResolveActions with the same selection, which runs both phases
+    static void addCombatBenchmark(Runner &runner, const std::string &name, const std::string &skillID, const std::string &weaponID, size_t enemyCount)
+    {
+        auto combat = CombatSystem::getInstance();
+        auto setup = [combat, skillID, weaponID, enemyCount]()
+        {
+            combat->reset();
+            std::vector<std::shared_ptr<Enemy>> enemies;
+            for (size_t i = 0; i < enemyCount; i++)
+                enemies.push_back(makeEnemy(1e9));
+            auto ep = makePlayer(weaponID, 1e6);
+            combat->beginBattle({ep}, enemies);
+            combat->beginRound();
+            combat->beginTurn();
+            combat->setActionSelectionType(ActionSelectionType::Skill);
+            combat->markActionSelected(skillID);
+            combat->markTargetSelected(enemies.front()->uuid);
+            combat->prepRollDice();
+        };
+        runner.add(name, 20, [combat]()
+                   {
+                       combat->markDiceRolled(1);
+                       combat->resolveActions(); },
+                   setup);
+    }
+
+    // three slow players against three enemies with the first enemy to move, in a session of its own
+    static std::function<void()> stageAIBattle(const std::shared_ptr<GameSession> &session)
+    {
+        return [session]()
+        {
+            GameSession::Scope scope(*session);
+            auto combat = CombatSystem::getInstance();
+            combat->reset();
+            std::vector<std::shared_ptr<Player>> players;
+            for (size_t i = 0; i < 3; i++)
+                players.push_back(withAttribute(demoMap()["world"]["players"][i], "speed", 1).get<std::shared_ptr<Player>>());
+            combat->beginBattle(players, {makeEnemy(), makeEnemy(), makeEnemy()});
+            combat->beginRound();
+            combat->beginTurn();
+        };
+    }
+
+    static void addCombatAIBenchmark(Runner &runner, const std::string &name, size_t iterations, size_t workers)
+    {
+        auto session = makeSession();
+        auto ai = std::make_shared<std::shared_ptr<CombatAI>>();
+        auto stage = stageAIBattle(session);
+        runner.add(name, 1, [session, ai]()
+                   {
+                       GameSession::Scope scope(*session);
+                       doNotOptimize((*ai)->decide(*CombatSystem::getInstance()).actionID); },
+                   [stage, ai, iterations, workers]()
+                   {
+                       if (!*ai)
+                       {
+                           CombatAIOptions options;
+                           options.timeBudget = {};
+                           options.iterations = iterations;
+                           options.workers = workers;
+                           *ai = std::make_shared<CombatAI>(options);
+                       }
+                       stage(); });
+    }
+
+    void registerCombatBenchmarks(Runner &runner)
+    {
+        addCombatBenchmark(runner, "combat/basic_attack", "active:basic_attack", {}, 1);
+        addCombatBenchmark(runner, "combat/basic_attack_passive", "active:basic_attack", "weapon:hammer", 3);
+        addCombatBenchmark(runner, "combat/splash_3", "active:shock_blast", "weapon:ritual_sword", 3);
+        addCombatBenchmark(runner, "combat/splash_8", "active:shock_blast", "weapon:ritual_sword", 8);
+
+        // the damage of one splash over 8 targets, one apply per target against one applyBatch
+        auto splash = std::make_shared<DamageAction>(ActionType::Damage, TargetType::Splash, TargetScope::Enemy, DamageType::Physical, Math::Expression("self.atk*0.5"));
+        auto source = makePlayer({}, 1e6);
+        auto targets = std::make_shared<std::vector<std::shared_ptr<Entity>>>();
+        for (size_t i = 0; i < 8; i++)
+            targets->push_back(makeEnemy(1e9));
+        auto splashCtx = std::make_shared<ActionContext>(ActionContext{Math::Bindings(childScope())});
+        source->bindMathContext("self", splashCtx->bindings);
+        runner.add("combat/splash_apply_8", 100, [splash, source, targets, splashCtx]()
+                   {
+                       for (auto &target : *targets)
+                       {
+                           target->bindMathContext("target", splashCtx->bindings);
+                           splash->apply(source, target, *splashCtx);
+                       } });
+        runner.add("combat/splash_apply_batch_8", 100, [splash, source, targets, splashCtx]()
+                   { splash->applyBatch(source, *targets, *splashCtx); });
+
+        auto aiSession = makeSession();
+        runner.add("combat/fork", 1000, [aiSession]()
+                   {
+                       GameSession::Scope scope(*aiSession);
+                       doNotOptimize(CombatSystem::getInstance()->fork()); },
+                   stageAIBattle(aiSession));
+        addCombatAIBenchmark(runner, "combat/ai_decide_256_1_worker", 256, 1);
+        addCombatAIBenchmark(runner, "combat/ai_decide_256", 256, std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    void registerDiceBenchmarks(Runner &runner)
+    {
+        runner.add("dice/roll_uniform_1", 1000, []()
+                   { doNotOptimize(Dice::rollUniformDices(1, 0.5)); });
+        runner.add("dice/roll_uniform_10", 1000, []()
+                   { doNotOptimize(Dice::rollUniformDices(10, 0.5)); });
+        runner.add("dice/roll_uniform_guarenteed", 1000, []()
+                   { doNotOptimize(Dice::rollUniformDices(10, 0.5, 3)); });
+    }
+
+    void registerSessionBenchmarks(Runner &runner)
+    {
+        constexpr size_t sessionCount = 16;
+        auto host = std::make_shared<SessionHost>();
+        auto sessions = std::make_shared<std::vector<SessionHost::SessionID>>();
+        auto load = [host, sessions]()
+        {
+            if (!sessions->empty())
+                return;
+            for (unsigned int seed = 1; seed <= sessionCount; seed++)
+            {
+                auto save = generateSave(generatorOptions(seed));
+                auto id = host->createSession(seed);
+                host->submit(id, [save](GameSession &session)
+                             { session.getGameManager()->loadMapFromJson(save); })
+                    .get();
+                sessions->push_back(id);
+            }
+        };
+        auto query = [](GameSession &session)
+        {
+            auto world = session.getGameManager()->getWorld();
+            world->getPathfinder()->invalidate();
+            for (auto &ep : world->players)
+                doNotOptimize(world->getPathfinder()->getReachable(ep->getPos(), (int)Dice::rollUniformDices(10, 0.5)));
+        };
+
+        runner.add("session/host_parallel_queries", 10, [host, sessions, query]()
+                   {
+                       for (auto id : *sessions)
+                           host->submit(id, query);
+                       host->wait(); },
+                   load);
+        runner.add("session/host_serial_queries", 10, [host, sessions, query]()
+                   {
+                       for (auto id : *sessions)
+                           host->submit(id, query).get(); },
+                   load);
+    }
+
+    void registerSnapshotBenchmarks(Runner &runner)
+    {
+        auto session = makeSession();
+        auto base = std::make_shared<std::shared_ptr<const GameSnapshot>>();
+        auto load = loadGenerated(session, generatorOptions(1, Vec2i(256, 256), 2000), [base]()
+                                  { *base = GameSnapshot::capture(); });
+
+        runner.add("snapshot/capture_full", 1, [session]()
+                   {
+                       GameSession::Scope scope(*session);
+                       doNotOptimize(GameSnapshot::capture()); },
+                   load);
+        runner.add("snapshot/capture_one_changed", 100, [session, base]()
+                   {
+                       GameSession::Scope scope(*session);
+                       GameManager::getInstance()->getWorld()->players.front()->dec("hp");
+                       doNotOptimize(GameSnapshot::capture(*base)); },
+                   load);
+        runner.add("snapshot/restore_one_changed", 100, [session, base]()
+                   {
+                       GameSession::Scope scope(*session);
+                       GameManager::getInstance()->getWorld()->players.front()->dec("hp");
+                       (*base)->restore(); },
+                   load);
+        runner.add("snapshot/json_round_trip", 1, [session]()
+                   {
+                       GameSession::Scope scope(*session);
+                       auto gameMgr = GameManager::getInstance();
+                       gameMgr->loadMapFromJson(nlohmann::json::parse(gameMgr->toJson().dump())); },
+                   load);
+    }
+
+    void registerAllBenchmarks(Runner &runner)
+    {
+        registerExprBenchmarks(runner);
+        registerEntityBenchmarks(runner);
+        registerRegistryBenchmarks(runner);
+        registerWorldBenchmarks(runner);
+        registerCombatBenchmarks(runner);
+        registerDiceBenchmarks(runner);
+        registerSessionBenchmarks(runner);
+        registerSnapshotBenchmarks(runner);
+    }
+} // namespace FTK::Bench
@@ -0,0 +1,20 @@
+#ifndef FTK_BENCH_SUITES_H
+#define FTK_BENCH_SUITES_H
+
+#include "bench.h"
+
+namespace FTK::Bench
+{
+    void registerExprBenchmarks(Runner &runner);
+    void registerEntityBenchmarks(Runner &runner);
+    void registerRegistryBenchmarks(Runner &runner);
+    void registerWorldBenchmarks(Runner &runner);
+    void registerCombatBenchmarks(Runner &runner);
+    void registerDiceBenchmarks(Runner &runner);
+    void registerSessionBenchmarks(Runner &runner);
+    void registerSnapshotBenchmarks(Runner &runner);
+
+    void registerAllBenchmarks(Runner &runner);
+} // namespace FTK::Bench
+
+#endif // FTK_BENCH_SUITES_H
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "WorldGenerator.h"
+
+static const char *usage = "usage: ftk-gen [-o out.json] [--seed n] [--size WxH] [--rock-density 0.15] [--players n] [--enemies n]\n"
+                           "               [--shops n] [--shop-stock n] [--equipment-chance 0.5] [--buff-chance 0.1] [--max-buffs n]\n"
+                           "               [--gold n] [--items n]\n";
+
+int main(int argc, char **argv)
+{
+    FTK::WorldGeneratorOptions options;
+    std::string output = "generated_map.json";
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "-o" || arg == "--output")
+                output = next();
+            else if (arg == "--seed")
+                options.seed = std::stoul(next());
+            else if (arg == "--size")
+            {
+                auto size = next();
+                auto x = size.find('x');
+                if (x == std::string::npos)
+                    throw std::invalid_argument("Size must be in the form WxH");
+                options.dimension = FTK::Vec2i(std::stoi(size.substr(0, x)), std::stoi(size.substr(x + 1)));
+            }
+            else if (arg == "--rock-density")
+                options.rockDensity = std::stod(next());
+            else if (arg == "--players")
+                options.playerCount = std::stoul(next());
+            else if (arg == "--enemies")
+                options.enemyCount = std::stoul(next());
+            else if (arg == "--shops")
+                options.shopCount = std::stoul(next());
+            else if (arg == "--shop-stock")
+                options.shopStock = std::stoul(next());
+            else if (arg == "--equipment-chance")
+                options.equipmentChance = std::stod(next());
+            else if (arg == "--buff-chance")
+                options.buffChance = std::stod(next());
+            else if (arg == "--max-buffs")
+                options.maxBuffsPerEntity = std::stoul(next());
+            else if (arg == "--gold")
+                options.startingGold = std::stoi(next());
+            else if (arg == "--items")
+                options.startingItems = std::stoul(next());
+            else
+                throw std::invalid_argument("Unknown argument " + arg);
+        }
+
+        FTK::WorldGenerator(options).generate(output);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << usage;
+        return 2;
+    }
+    return 0;
+}
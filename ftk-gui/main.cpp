@@ -1,6 +1,11 @@
 
 
+#include <iostream>
+
+#include "AllocTracker.h"
+#include "EventBus.h"
 #include "Registry.h"
+#include "RegistryWatcher.h"
 #include "GameManager.h"
 
 #include "gui.h"
@@ -10,6 +15,20 @@ int main()
 {
     FTK::MainRegistry::getInstance()->exportAll("exports/configs");
 
+    FTK::RegistryWatcher watcher;
+    watcher.setListener([](const std::string &file, const std::string &error)
+                        {
+                            if (!error.empty())
+                                std::cerr << "failed to reload " << file << ": " << error << std::endl; });
+    try
+    {
+        watcher.start();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+
     const auto window = FTK::GUI::createWindow("FTK", 1600, 900);
 
     glClearColor(0.25, 0.25, 0.25, 1);
@@ -18,17 +37,26 @@ int main()
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        FTK::GUI::beginUI();
-        FTK::GUI::ViewManager::getInstance()->render();
-        FTK::GUI::endUI();
+        {
+            FTK::AllocTracker::Scope allocScope(FTK::AllocTag::Frame);
+            FTK::EventBus::getInstance()->flush();
+            FTK::GUI::beginUI();
+            FTK::GUI::ViewManager::getInstance()->render();
+            FTK::GUI::endUI();
+        }
+        FTK::AllocTracker::completeInterval(FTK::AllocTag::Frame);
     }
 
+    watcher.stop();
     FTK::GUI::destroyWindow(window);
     if (FTK::GameManager::getInstance()->getWorld())
     {
         int i = 0;
-        while (std::filesystem::exists("saves/autosave_" + std::to_string(i) + ".json"))
+        while (std::filesystem::exists("saves/autosave_" + std::to_string(i) + ".ftksave"))
             i++;
-        FTK::GameManager::getInstance()->saveMap("saves/autosave_" + std::to_string(i) + ".json");
+        FTK::GameManager::getInstance()->saveMap("saves/autosave_" + std::to_string(i) + ".ftksave");
     }
+
+    if (FTK::AllocTracker::isEnabled())
+        FTK::AllocTracker::print(std::cout);
 }
\ No newline at end of file
@@ -1,10 +1,15 @@
 #include "view.h"
 
+#include <ctime>
+#include <random>
+
 #include <imgui.h>
 #include <ImGuiFileDialog.h>
 
 #include "utils.h"
-#include "Dice.h"
+#include "CombatAI.h"
+#include "CommandLog.h"
+#include "EventBus.h"
 #include "GameManager.h"
 #include "Registry.h"
 #include "combat.h"
@@ -27,6 +32,9 @@ static const std::map<FTK::EquipmentType, std::string> equipmentTexts{
 
 static bool shouldFocus = false;
 static ImVec2 gameViewFocus;
+static std::vector<char> reachableMask;
+static bool reachableDirty = true;
+static std::tuple<FTK::GameState, FTK::ExploreState, uuids::uuid> reachableKey;
 static bool doneRolling = false;
 size_t diceRollRes = 0;
 static int focusUsed = 0;
@@ -64,6 +72,12 @@ namespace FTK::GUI
     ViewManager::ViewManager()
     {
         config.path = "./saves";
+        // decides within the default time budget, the command log records each choice so replays never search
+        CombatSystem::getInstance()->setEnemyAI(std::make_shared<CombatAI>());
+        EventBus::getInstance()->subscribe([](const Event &e)
+                                           {
+                                               if (std::holds_alternative<EntityMovedEvent>(e) || std::holds_alternative<StatChangedEvent>(e) || std::holds_alternative<RectRevealedEvent>(e))
+                                                   reachableDirty = true; });
     }
 
     void ViewManager::renderMap(bool disabled)
@@ -80,6 +94,15 @@ namespace FTK::GUI
 
         auto gameMgr = GameManager::getInstance();
         auto world = gameMgr->getWorld();
+        if (auto key = std::make_tuple(gameMgr->getGameState(), gameMgr->getExploreState(), gameMgr->getCurrentPlayerUUID()); reachableDirty || key != reachableKey || reachableMask.size() != world->dimension.getX() * world->dimension.getY())
+        {
+            reachableMask.assign(world->dimension.getX() * world->dimension.getY(), 0);
+            for (auto &pos : gameMgr->getReachableCells())
+                reachableMask[pos.getY() * world->dimension.getX() + pos.getX()] = 1;
+            reachableKey = key;
+            reachableDirty = false;
+        }
+        auto &reachable = reachableMask;
         for (int y = 0; y < world->dimension.getY(); y++)
         {
             for (int x = 0; x < world->dimension.getX(); x++)
@@ -87,19 +110,22 @@ namespace FTK::GUI
                 if (x)
                     ImGui::SameLine();
                 auto rect = world->getRectAt(x, y);
+                auto visible = world->isVisible(x, y);
                 Texture tex = getRectTexture(rect->getID(), rect->getMetadata());
                 ImVec4 bgColor = {0, 0, 0, 0};
+                if (reachable[y * world->dimension.getX() + x] && visible)
+                    bgColor = {0.2f, 0.6f, 1.0f, 0.25f};
                 std::string id = "rect_" + std::to_string(x) + "_" + std::to_string(y);
                 auto cursor = ImGui::GetCursorPos();
                 ImGui::SetNextItemAllowOverlap();
-                if (!rect->isVisible())
+                if (!visible)
                     ImGui::PushStyleVar(ImGuiStyleVar_Alpha, 0);
                 ImGui::Image((void *)(intptr_t)tex.textureID, ImVec2(tex.width, tex.height), ImVec2(0, 0), ImVec2(1, 1));
-                if (!rect->isVisible())
+                if (!visible)
                     ImGui::PopStyleVar();
                 ImGui::SetCursorPos(cursor);
                 std::string content;
-                if (rect->isVisible())
+                if (visible)
                 {
                     if (auto re = world->getRectEntityAt(x, y))
                     {
@@ -136,18 +162,22 @@ namespace FTK::GUI
                 }
                 if (!content.empty())
                     content.pop_back();
-                ImGui::BeginDisabled(!rect->isVisible() && gameMgr->getGameState() != GameState::Teleport);
+                ImGui::BeginDisabled(!visible && gameMgr->getGameState() != GameState::Teleport);
                 ImGui::PushID(id.c_str());
-                ImGui::PushStyleColor(ImGuiCol_Button, {0, 0, 0, 0});
+                ImGui::PushStyleColor(ImGuiCol_Button, bgColor);
                 if (ImGui::Button("", {64, 64}))
                 {
                     std::cout << "clicked on " << id << std::endl;
-                    if ((gameMgr->getGameState() == GameState::Teleport || (gameMgr->getGameState() == GameState::Explore && gameMgr->getExploreState() == ExploreState::Move)) && !gameMgr->movePlayer({x, y}))
+                    if (gameMgr->getGameState() == GameState::Teleport && !gameMgr->movePlayer({x, y}))
+                    {
+                        invalidPos = true;
+                    }
+                    else if (gameMgr->getGameState() == GameState::Explore && gameMgr->getExploreState() == ExploreState::Move && !gameMgr->movePlayerTo({x, y}))
                     {
                         invalidPos = true;
                     }
                 }
-                if (rect->isVisible())
+                if (visible)
                     ImGui::SetItemTooltip("(%d, %d)\n%s", x, y, content.c_str());
                 else
                     ImGui::SetItemTooltip("(%d, %d)", x, y);
@@ -206,19 +236,18 @@ namespace FTK::GUI
         {
             const auto activeSkills = MainRegistry::getInstance()->activeSkills;
 
-            for (auto p : ent->getActiveSkillCD())
-            {
-                auto skillData = activeSkills->get(p.first);
+            ent->forEachActiveSkillCD([&](const std::string &skillID, int cd)
+                                      {
+                auto skillData = activeSkills->get(skillID);
                 auto entryID = uuids::to_string(ent->uuid) + "_" + skillData.id;
-                auto display = skillData.name + " - CD: " + std::to_string(p.second);
+                auto display = skillData.name + " - CD: " + std::to_string(cd);
                 ImGui::PushID(entryID.c_str());
                 if (ImGui::Selectable(display.c_str()))
                 {
                     std::cout << "clicked on " << entryID << std::endl;
                 }
                 ImGui::SetItemTooltip("%s", skillData.description.c_str());
-                ImGui::PopID();
-            }
+                ImGui::PopID(); });
             ImGui::EndListBox();
         }
         ImGui::Text("Passive:");
@@ -226,19 +255,18 @@ namespace FTK::GUI
         {
             const auto passiveSkills = MainRegistry::getInstance()->passiveSkills;
 
-            for (auto p : ent->getPassiveSkillCD())
-            {
-                auto skillData = passiveSkills->get(p.first);
+            ent->forEachPassiveSkillCD([&](const std::string &skillID, int cd)
+                                      {
+                auto skillData = passiveSkills->get(skillID);
                 auto entryID = uuids::to_string(ent->uuid) + "_" + skillData.id;
-                auto display = skillData.name + " - CD: " + std::to_string(p.second);
+                auto display = skillData.name + " - CD: " + std::to_string(cd);
                 ImGui::PushID(entryID.c_str());
                 if (ImGui::Selectable(display.c_str()))
                 {
                     std::cout << "clicked on " << entryID << std::endl;
                 }
                 ImGui::SetItemTooltip("%s", skillData.description.c_str());
-                ImGui::PopID();
-            }
+                ImGui::PopID(); });
             ImGui::EndListBox();
         }
         ImGui::SeparatorText("Buffs / Debuffs");
@@ -246,7 +274,7 @@ namespace FTK::GUI
         {
             const auto buffs = MainRegistry::getInstance()->buffTemplates;
 
-            for (auto buff : ent->getBuffs())
+            for (auto &buff : ent->viewBuffs())
             {
                 auto buffData = buffs->get(buff.id);
                 auto entryID = uuids::to_string(ent->uuid) + "_" + buffData.id;
@@ -265,7 +293,7 @@ namespace FTK::GUI
         ImGui::SeparatorText("Equipments");
         auto equipList = MainRegistry::getInstance()->equipmentTemplates;
         ImGui::BeginDisabled(inCombat || gameMgr->getExploreState() == ExploreState::BeginRound || gameMgr->getExploreState() == ExploreState::EndRound || gameMgr->getCurrentPlayerUUID() != ent->uuid);
-        for (auto p : ent->getEquipments())
+        for (auto &p : ent->viewEquipments())
         {
             auto id = uuids::to_string(ent->uuid) + "_" + equipmentTexts.at(p.first);
             auto popupID = "equip";
@@ -279,7 +307,7 @@ namespace FTK::GUI
                 ImGui::PushID(id.c_str());
                 if (ImGui::Button("Unequip"))
                 {
-                    gameMgr->getInventory()->addEquipment(ent->removeEquipment(p.first));
+                    gameMgr->unequip(ent->uuid, p.first);
                 }
                 ImGui::PopID();
             }
@@ -304,7 +332,7 @@ namespace FTK::GUI
                                 ImGui::PushID((id + uuids::to_string(e.uuid)).c_str());
                                 if (ImGui::Selectable(equipList->get(e.id).name.c_str(), false))
                                 {
-                                    ent->addEquipment(gameMgr->getInventory()->removeEquipment(e.uuid));
+                                    gameMgr->equip(ent->uuid, e.uuid);
                                     ImGui::CloseCurrentPopup();
                                 }
                                 ImGui::SetItemTooltip(equipList->get(e.id).name.c_str());
@@ -448,7 +476,7 @@ namespace FTK::GUI
         ImGui::SeparatorText("Equipments");
         if (ImGui::BeginListBox("##inventory_equipments", {200, 100}))
         {
-            for (auto equip : inv->getEquipments())
+            for (auto &equip : inv->viewEquipments())
             {
                 auto equipData = equipEntries->get(equip.id);
                 auto display = equipData.name;
@@ -841,7 +869,11 @@ namespace FTK::GUI
                     auto ep = std::dynamic_pointer_cast<Player>(combatSys->getCurrentEntity());
                     auto skillData = MainRegistry::getInstance()->activeSkills->get(combatSys->getSelectedSctionID());
                     if (rollChance == -1)
-                        rollChance = skillData.rollChanceExpr.eval(ep->getMathContext("self")) / 100;
+                    {
+                        Math::Bindings bindings;
+                        ep->bindMathContext("self", bindings);
+                        rollChance = skillData.rollChanceExpr.eval(bindings) / 100;
+                    }
                     auto diceRolls = skillData.diceRolls;
                     if (skillData.id == "active:basic_attack")
                         diceRolls = combatSys->getCurrentEntity()->getWeaponDiceRoll();
@@ -949,16 +981,26 @@ namespace FTK::GUI
         ImGui::Begin("Main Control", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
         if (ImGui::Button("Save game"))
         {
-            fileDialog.OpenDialog("SaveMapKey", "Save Map", ".json", config);
+            fileDialog.OpenDialog("SaveMapKey", "Save Map", ".ftksave,.json", config);
+        }
+        if (!CommandLog::getInstance()->isRecording())
+        {
+            if (ImGui::Button("Start recording"))
+                CommandLog::getInstance()->begin(std::random_device()());
+        }
+        else if (ImGui::Button("Stop recording"))
+        {
+            stopRecording();
         }
         if (ImGui::Button("Exit to main menu without saving"))
         {
+            stopRecording();
             viewState = ViewState::MainMenu;
             GameManager::getInstance()->reset();
         }
         if (ImGui::Button("Save and exit to main menu"))
         {
-            fileDialog.OpenDialog("SaveMapAndExitKey", "Save Map", ".json", config);
+            fileDialog.OpenDialog("SaveMapAndExitKey", "Save Map", ".ftksave,.json", config);
         }
         ImGui::End();
 
@@ -979,6 +1021,7 @@ namespace FTK::GUI
                 auto saveFile = fileDialog.GetFilePathName();
                 GameManager::getInstance()->saveMap(saveFile);
                 std::cout << "Game saved to: " << saveFile << std::endl;
+                stopRecording();
                 viewState = ViewState::MainMenu;
                 GameManager::getInstance()->reset();
             }
@@ -986,6 +1029,17 @@ namespace FTK::GUI
         }
     }
 
+    void ViewManager::stopRecording()
+    {
+        auto commandLog = CommandLog::getInstance();
+        if (!commandLog->isRecording())
+            return;
+        commandLog->end();
+        auto path = "saves/replay_" + std::to_string(std::time(nullptr)) + ".ftklog";
+        commandLog->save(path);
+        std::cout << "Replay saved to: " << path << std::endl;
+    }
+
     void ViewManager::renderMainMenu()
     {
         ImGUI_FullscreenNextWindow();
@@ -1004,7 +1058,7 @@ namespace FTK::GUI
         ImGUI_AlignForWidth(150);
         if (ImGui::Button("Load game", {150, 0}))
         {
-            fileDialog.OpenDialog("LoadMapKey", "Load Map", ".json", config);
+            fileDialog.OpenDialog("LoadMapKey", "Load Map", ".ftksave,.json", config);
         }
 
         ImGUI_AlignForWidth(150);
@@ -1091,10 +1145,8 @@ namespace FTK::GUI
             {
                 if (ImGui::Button("Roll"))
                 {
-                    guarentee += focusUsed;
-                    diceRollRes = Dice::rollUniformDices(rollAmount, std::max(0.0, std::min(1.0, rollChance * ep->get("dice_chance_mult"))), guarentee);
+                    diceRollRes = GameManager::getInstance()->rollFocusedDice(ep->uuid, rollAmount, rollChance, guarentee, focusUsed);
                     doneRolling = true;
-                    ep->dec("focus", focusUsed);
                 }
             }
             else
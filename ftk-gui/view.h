@@ -55,6 +55,7 @@ namespace FTK::GUI
         void renderTeleportControl();
 
         void renderMainControl();
+        void stopRecording();
 
         void renderMainMenu();
         void renderNewGame();
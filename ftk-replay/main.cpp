@@ -0,0 +1,125 @@
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CombatAI.h"
+#include "CommandLog.h"
+#include "SessionHost.h"
+#include "combat.h"
+
+static const char *usage = "usage: ftk-replay [--jobs n] [--repeat n] log.ftklog...\n";
+
+int main(int argc, char **argv)
+{
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    size_t repeat = 1;
+    std::vector<std::string> paths;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "-j" || arg == "--jobs")
+                jobs = std::max<size_t>(1, std::stoul(next()));
+            else if (arg == "--repeat")
+                repeat = std::max<size_t>(1, std::stoul(next()));
+            else if (arg.size() > 1 && arg[0] == '-')
+                throw std::invalid_argument("Unknown argument " + arg);
+            else
+                paths.push_back(arg);
+        }
+        if (paths.empty())
+            throw std::invalid_argument("No command log given");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << usage;
+        return 2;
+    }
+
+    std::vector<std::shared_ptr<FTK::CommandLog>> logs;
+    try
+    {
+        for (auto &path : paths)
+            logs.push_back(FTK::CommandLog::load(path));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    struct Run
+    {
+        size_t log;
+        uint32_t hash = 0;
+        std::future<void> done;
+    };
+
+    // every run gets its own session, so replays of the same log never share state
+    FTK::SessionHost host(std::min(jobs, logs.size() * repeat));
+    std::vector<Run> runs;
+    runs.reserve(logs.size() * repeat);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repeat; r++)
+        for (size_t i = 0; i < logs.size(); i++)
+        {
+            runs.push_back({i});
+            auto &run = runs.back();
+            run.done = host.submit(host.createSession(), [&log = logs[i], &hash = run.hash](FTK::GameSession &session)
+                                   {
+                                       // recorded choices replay as they are, the AI of the header only searches when a choice is missing
+                                       // and then without a time limit, so such a replay is still reproducible
+                                       if (auto options = log->getAIOptions())
+                                       {
+                                           options->timeBudget = {};
+                                           options->workers = 1;
+                                           session.getCombatSystem()->setEnemyAI(std::make_shared<FTK::CombatAI>(*options));
+                                       }
+                                       hash = log->replay(); });
+        }
+    host.wait();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    size_t commands = 0;
+    for (auto &run : runs)
+    {
+        auto &log = logs[run.log];
+        auto &path = paths[run.log];
+        try
+        {
+            run.done.get();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << path << ": replay failed: " << e.what() << std::endl;
+            failures++;
+            continue;
+        }
+        commands += log->getCommands().size();
+        if (log->hasFinalHash() && log->getFinalHash() != run.hash)
+        {
+            std::cerr << path << ": state hash " << std::hex << std::setw(8) << std::setfill('0') << run.hash
+                      << " does not match the recorded " << std::setw(8) << log->getFinalHash() << std::dec << std::setfill(' ') << std::endl;
+            failures++;
+        }
+    }
+
+    std::cout << runs.size() << " replays, " << commands << " commands in " << std::fixed << std::setprecision(3) << elapsed << " s ("
+              << std::setprecision(0) << (elapsed > 0 ? commands / elapsed : 0) << " commands/s) on " << host.getWorkerCount() << " workers, "
+              << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
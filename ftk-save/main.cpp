@@ -0,0 +1,113 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "SaveContainer.h"
+
+static const char *usage = "usage: ftk-save [--jobs n] verify|list save.ftksave...\n"
+                           "       ftk-save pack save.json out.ftksave\n";
+
+static int pack(const std::string &in, const std::string &out)
+{
+    std::ifstream ifs(in);
+    if (!ifs)
+        throw std::invalid_argument("Cannot open " + in);
+    nlohmann::ordered_json j;
+    ifs >> j;
+    if (!j.contains("world"))
+        throw std::invalid_argument(in + " is not a map or save");
+    FTK::SaveContainer container;
+    container.put("world", j["world"].dump());
+    j.erase("world");
+    container.put("state", j.dump());
+    container.save(out);
+    for (auto &section : container.getSections())
+        std::cout << section.name << ": " << section.rawSize << " -> " << section.storedSize << " bytes" << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::string command;
+    std::vector<std::string> paths;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            if (arg == "-j" || arg == "--jobs")
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                jobs = std::max<size_t>(1, std::stoul(argv[++i]));
+            }
+            else if (arg.size() > 1 && arg[0] == '-')
+                throw std::invalid_argument("Unknown argument " + arg);
+            else if (command.empty())
+                command = arg;
+            else
+                paths.push_back(arg);
+        }
+        if (command != "verify" && command != "list" && command != "pack")
+            throw std::invalid_argument("Unknown command " + command);
+        if (command == "pack" && paths.size() != 2)
+            throw std::invalid_argument("pack takes a json save and an output path");
+        if (paths.empty())
+            throw std::invalid_argument("No save given");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << usage;
+        return 2;
+    }
+
+    if (command == "pack")
+    {
+        try
+        {
+            return pack(paths[0], paths[1]);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto reports = command == "verify" ? FTK::SaveContainer::verifyAll(paths, jobs) : FTK::SaveContainer::listAll(paths, jobs);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    uint64_t bytes = 0;
+    for (auto &report : reports)
+    {
+        bytes += report.fileSize;
+        if (!report.valid)
+        {
+            std::cerr << report.path << ": " << report.error << std::endl;
+            failures++;
+            continue;
+        }
+        if (command != "list")
+            continue;
+        std::cout << report.path << " (" << report.fileSize << " bytes)" << std::endl;
+        for (auto &section : report.sections)
+            std::cout << "  " << section.name << ": " << (section.codec == FTK::SaveContainer::Codec::LZ ? "lz " : "stored ")
+                      << section.rawSize << " -> " << section.storedSize << " bytes, crc " << std::hex << std::setw(8) << std::setfill('0')
+                      << section.crc << std::dec << std::setfill(' ') << std::endl;
+    }
+
+    std::cout << reports.size() << " saves, " << bytes << " bytes in " << std::fixed << std::setprecision(3) << elapsed << " s on "
+              << std::min(jobs, reports.size()) << " workers, " << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+#include "commands.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "CombatAI.h"
+#include "CommandLog.h"
+#include "GameManager.h"
+#include "Random.h"
+#include "WorldGenerator.h"
+#include "combat.h"
+
+namespace FTK::Server
+{
+    using Handler = std::function<nlohmann::json(const nlohmann::json &)>;
+
+    // enemy_ai options come from clients, searches of every connection share one pool
+    static constexpr long long MaxAITimeMs = 5000;
+    static constexpr size_t MaxAIIterations = 20000;
+    static constexpr size_t MaxAITrees = 64;
+    static constexpr size_t MaxAIWorkers = 4;
+    static constexpr size_t MaxAIRolloutTurns = 64;
+
+    static std::filesystem::path saveDirectory = "saves";
+
+    template <typename T>
+    static T boundedArg(const nlohmann::json &args, const std::string &key, T defaultValue, T min, T max)
+    {
+        if (!args.contains(key))
+            return std::min(defaultValue, max);
+        auto value = args.at(key).get<long long>();
+        if (value < (long long)min || (unsigned long long)value > (unsigned long long)max)
+            throw std::invalid_argument(key + " must be between " + std::to_string(min) + " and " + std::to_string(max));
+        return (T)value;
+    }
+
+    static nlohmann::json toJson(const Vec2i &pos)
+    {
+        return {pos.getX(), pos.getY()};
+    }
+
+    static Vec2i posArg(const nlohmann::json &args)
+    {
+        return Vec2i(args.at("x").get<int>(), args.at("y").get<int>());
+    }
+
+    // client paths name a file inside the save directory, absolute paths and .. are refused
+    static std::string savePathArg(const nlohmann::json &args)
+    {
+        auto name = args.at("path").get<std::string>();
+        std::filesystem::path path(name);
+        if (path.empty() || path.has_root_path() || !path.has_filename())
+            throw std::invalid_argument("Not a save file name: " + name);
+        for (auto &part : path)
+            if (part == "..")
+                throw std::invalid_argument("Not a save file name: " + name);
+        return (saveDirectory / path).string();
+    }
+
+    static std::shared_ptr<GameManager> requireWorld()
+    {
+        auto gameMgr = GameManager::getInstance();
+        if (!gameMgr->getWorld())
+            throw std::invalid_argument("No map is loaded");
+        return gameMgr;
+    }
+
+    static bool hasCurrentPlayer(const std::shared_ptr<GameManager> &gameMgr)
+    {
+        return gameMgr->getCurrentPlayerIndex() < gameMgr->getPlayerTurnOrder().size();
+    }
+
+    // the GameManager overloads without a uuid index the turn order before checking the explore state
+    static std::shared_ptr<GameManager> requireTurn()
+    {
+        auto gameMgr = requireWorld();
+        if (!hasCurrentPlayer(gameMgr))
+            throw std::invalid_argument("No player is taking a turn");
+        return gameMgr;
+    }
+
+    static std::shared_ptr<CombatSystem> requireCombat()
+    {
+        requireWorld();
+        auto combatSys = CombatSystem::getInstance();
+        if (combatSys->getCombatState() == CombatState::None)
+            throw std::invalid_argument("Not in combat");
+        return combatSys;
+    }
+
+    static nlohmann::json exploreSummary()
+    {
+        auto gameMgr = GameManager::getInstance();
+        if (!gameMgr->getWorld())
+            return {{"loaded", false}};
+        nlohmann::json j;
+        j["loaded"] = true;
+        j["game_state"] = gameMgr->getGameState();
+        j["explore_state"] = gameMgr->getExploreState();
+        j["round"] = gameMgr->getRoundNumber();
+        if (auto ep = hasCurrentPlayer(gameMgr) ? gameMgr->getCurrentPlayer() : nullptr)
+            j["current_player"] = {{"uuid", uuids::to_string(ep->uuid)}, {"name", ep->name}, {"pos", toJson(ep->getPos())}, {"hp", ep->get("hp")}, {"ap", ep->getAP()}, {"focus", ep->getAsInt("focus")}};
+        return j;
+    }
+
+    static nlohmann::json combatSummary()
+    {
+        auto combatSys = CombatSystem::getInstance();
+        nlohmann::json j;
+        j["combat_state"] = combatSys->getCombatState();
+        if (combatSys->getCombatState() == CombatState::None)
+            return j;
+        j["round"] = combatSys->getRoundNumber();
+        j["turn"] = combatSys->getTurnNumber();
+        if (auto ent = combatSys->getCurrentEntity())
+            j["current_entity"] = {{"uuid", uuids::to_string(ent->uuid)}, {"name", ent->name}, {"player", ent->isPlayer()}};
+        j["action_selection_type"] = combatSys->getActionSelectionType();
+        j["action_candidates"] = combatSys->getActionCandidates();
+        j["selected_action"] = combatSys->getSelectedSctionID();
+        j["target_candidates"] = nlohmann::json::array();
+        for (auto &e : combatSys->getTargetCandidates())
+            j["target_candidates"].push_back({{"uuid", uuids::to_string(e->uuid)}, {"name", e->name}, {"hp", e->get("hp")}});
+        if (!combatSys->getSelectedTarget().is_nil())
+            j["selected_target"] = uuids::to_string(combatSys->getSelectedTarget());
+        return j;
+    }
+
+    static void chooseAction(ActionSelectionType type, const std::string &id)
+    {
+        auto combatSys = requireCombat();
+        if (combatSys->getCombatState() != CombatState::ChooseAction || !combatSys->getCurrentEntity()->isPlayer())
+            throw std::invalid_argument("Not choosing an action");
+        if (combatSys->getActionSelectionType() != type)
+            combatSys->setActionSelectionType(type);
+        auto candidates = combatSys->getActionCandidates();
+        if (std::find(candidates.begin(), candidates.end(), id) == candidates.end())
+            throw std::invalid_argument(id + " can not be used now");
+        combatSys->markActionSelected(id);
+    }
+
+    static const std::map<std::string, Handler> &handlers()
+    {
+        static const std::map<std::string, Handler> res{
+            {"state", [](const nlohmann::json &)
+             { return nlohmann::json{{"explore", exploreSummary()}, {"combat", combatSummary()}}; }},
+            {"seed", [](const nlohmann::json &args)
+             {
+                 Random::getInstance()->seed(args.at("seed").get<unsigned int>());
+                 return nlohmann::json(true);
+             }},
+            {"generate", [](const nlohmann::json &args)
+             {
+                 WorldGeneratorOptions options;
+                 options.seed = args.value("seed", options.seed);
+                 options.dimension = Vec2i(args.value("width", options.dimension.getX()), args.value("height", options.dimension.getY()));
+                 options.playerCount = args.value("players", options.playerCount);
+                 options.enemyCount = args.value("enemies", options.enemyCount);
+                 options.shopCount = args.value("shops", options.shopCount);
+                 // the generator writes ordered_json, loadMapFromJson reads json
+                 GameManager::getInstance()->loadMapFromJson(nlohmann::json::parse(WorldGenerator(options).generate().dump()));
+                 return exploreSummary();
+             }},
+            {"load", [](const nlohmann::json &args)
+             {
+                 GameManager::getInstance()->loadMap(savePathArg(args));
+                 return exploreSummary();
+             }},
+            {"save", [](const nlohmann::json &args)
+             {
+                 requireWorld()->saveMap(savePathArg(args));
+                 return nlohmann::json(true);
+             }},
+            {"record_begin", [](const nlohmann::json &args)
+             {
+                 requireWorld();
+                 CommandLog::getInstance()->begin(args.value("seed", std::random_device()()));
+                 return nlohmann::json(true);
+             }},
+            {"record_end", [](const nlohmann::json &args)
+             {
+                 auto commandLog = CommandLog::getInstance();
+                 if (!commandLog->isRecording())
+                     throw std::invalid_argument("Not recording");
+                 commandLog->end();
+                 if (args.contains("path"))
+                     commandLog->save(savePathArg(args));
+                 return nlohmann::json{{"commands", commandLog->getCommands().size()}, {"hash", commandLog->getFinalHash()}};
+             }},
+            {"enemy_ai", [](const nlohmann::json &args)
+             {
+                 auto combatSys = CombatSystem::getInstance();
+                 if (!args.value("enabled", true))
+                 {
+                     combatSys->setEnemyAI(nullptr);
+                     return nlohmann::json(false);
+                 }
+                 CombatAIOptions options;
+                 // a time budget of 0 searches until the iterations are used up, which are bounded as well
+                 options.timeBudget = std::chrono::milliseconds(boundedArg<long long>(args, "time_ms", options.timeBudget.count(), 0, MaxAITimeMs));
+                 options.iterations = boundedArg<size_t>(args, "iterations", options.iterations, 1, MaxAIIterations);
+                 options.trees = boundedArg<size_t>(args, "trees", options.trees, 1, MaxAITrees);
+                 options.workers = boundedArg<size_t>(args, "workers", options.workers, 1, MaxAIWorkers);
+                 options.rolloutTurns = boundedArg<size_t>(args, "rollout_turns", options.rolloutTurns, 0, MaxAIRolloutTurns);
+                 combatSys->setEnemyAI(std::make_shared<CombatAI>(options));
+                 return nlohmann::json(true);
+             }},
+            {"begin_round", [](const nlohmann::json &)
+             {
+                 requireWorld()->beginRound();
+                 return exploreSummary();
+             }},
+            {"begin_turn", [](const nlohmann::json &)
+             {
+                 requireWorld()->beginTurn();
+                 return exploreSummary();
+             }},
+            {"roll_ap", [](const nlohmann::json &args)
+             {
+                 requireTurn()->rollAP(args.value("focus", 0));
+                 return exploreSummary();
+             }},
+            {"move", [](const nlohmann::json &args)
+             { return nlohmann::json(requireTurn()->movePlayer(posArg(args))); }},
+            {"move_to", [](const nlohmann::json &args)
+             { return nlohmann::json(requireTurn()->movePlayerTo(posArg(args))); }},
+            {"reachable", [](const nlohmann::json &)
+             {
+                 auto res = nlohmann::json::array();
+                 for (auto &pos : requireTurn()->getReachableCells())
+                     res.push_back(toJson(pos));
+                 return res;
+             }},
+            {"retreat", [](const nlohmann::json &)
+             { return nlohmann::json(requireTurn()->retreatPlayer()); }},
+            {"use_item", [](const nlohmann::json &args)
+             {
+                 auto gameMgr = requireTurn();
+                 auto id = args.at("id").get<std::string>();
+                 if (gameMgr->getInventory()->getItemAmount(id) <= 0)
+                     throw std::invalid_argument("No " + id + " in the inventory");
+                 gameMgr->useItem(id);
+                 return exploreSummary();
+             }},
+            {"trigger_battle", [](const nlohmann::json &args)
+             {
+                 auto gameMgr = requireTurn();
+                 if (gameMgr->getInteractableType(gameMgr->getCurrentPlayer()->getPos()) != InteractableType::Enemy)
+                     throw std::invalid_argument("There is no enemy to fight here");
+                 gameMgr->triggerBattle(gameMgr->getCurrentPlayer()->getPos(), args.value("ambush", false));
+                 return combatSummary();
+             }},
+            {"interaction_done", [](const nlohmann::json &args)
+             {
+                 requireTurn()->markInteractionDone(args.value("all", false));
+                 return exploreSummary();
+             }},
+            {"end_turn", [](const nlohmann::json &)
+             {
+                 requireWorld()->endTurn();
+                 return exploreSummary();
+             }},
+            {"end_round", [](const nlohmann::json &)
+             {
+                 requireWorld()->endRound();
+                 return exploreSummary();
+             }},
+            {"combat_begin_round", [](const nlohmann::json &)
+             {
+                 requireCombat()->beginRound();
+                 return combatSummary();
+             }},
+            {"combat_begin_turn", [](const nlohmann::json &)
+             {
+                 requireCombat()->beginTurn();
+                 return combatSummary();
+             }},
+            {"choose_skill", [](const nlohmann::json &args)
+             {
+                 chooseAction(ActionSelectionType::Skill, args.at("id").get<std::string>());
+                 return combatSummary();
+             }},
+            {"choose_item", [](const nlohmann::json &args)
+             {
+                 chooseAction(ActionSelectionType::Item, args.at("id").get<std::string>());
+                 return combatSummary();
+             }},
+            {"select_target", [](const nlohmann::json &args)
+             {
+                 auto combatSys = requireCombat();
+                 auto uuid = uuids::uuid::from_string(args.at("uuid").get<std::string>());
+                 auto candidates = combatSys->getTargetCandidates();
+                 if (!uuid || std::find_if(candidates.begin(), candidates.end(), [&uuid](auto &e)
+                                           { return e->uuid == *uuid; }) == candidates.end())
+                     throw std::invalid_argument("Not a valid target");
+                 combatSys->markTargetSelected(*uuid);
+                 return combatSummary();
+             }},
+            {"confirm", [](const nlohmann::json &)
+             {
+                 auto combatSys = requireCombat();
+                 if (combatSys->getCombatState() != CombatState::ChooseAction || !combatSys->readyToRollDice())
+                     throw std::invalid_argument("The action is not ready");
+                 combatSys->confirmChoice();
+                 return combatSummary();
+             }},
+            {"roll_dice", [](const nlohmann::json &)
+             {
+                 auto combatSys = requireCombat();
+                 if (combatSys->getCombatState() != CombatState::RollDice)
+                     throw std::invalid_argument("Not rolling dice");
+                 if (combatSys->getActionSelectionType() == ActionSelectionType::Item)
+                     combatSys->markDiceRolled(0);
+                 else
+                     combatSys->rollDice();
+                 return combatSummary();
+             }},
+            {"resolve", [](const nlohmann::json &)
+             {
+                 requireCombat()->resolveActions();
+                 return combatSummary();
+             }},
+            {"combat_end_turn", [](const nlohmann::json &)
+             {
+                 requireCombat()->endTurn();
+                 return combatSummary();
+             }},
+            {"combat_end_round", [](const nlohmann::json &)
+             {
+                 requireCombat()->endRound();
+                 return combatSummary();
+             }},
+            {"end_battle", [](const nlohmann::json &)
+             {
+                 requireCombat()->endBattle();
+                 return nlohmann::json{{"explore", exploreSummary()}, {"combat", combatSummary()}};
+             }}};
+        return res;
+    }
+
+    void setSaveDirectory(const std::string &dir)
+    {
+        saveDirectory = dir;
+    }
+
+    nlohmann::json execute(const std::string &command, const nlohmann::json &args)
+    {
+        auto it = handlers().find(command);
+        if (it == handlers().end())
+            throw std::invalid_argument("Unknown command " + command);
+        return it->second(args);
+    }
+
+    std::string handleLine(const std::string &line)
+    {
+        nlohmann::json res;
+        res["id"] = nullptr;
+        try
+        {
+            auto request = nlohmann::json::parse(line);
+            if (request.contains("id"))
+                res["id"] = request["id"];
+            res["result"] = execute(request.at("cmd").get<std::string>(), request.value("args", nlohmann::json::object()));
+            res["ok"] = true;
+        }
+        catch (const std::exception &e)
+        {
+            res.erase("result");
+            res["ok"] = false;
+            res["error"] = e.what();
+        }
+        return res.dump();
+    }
+} // namespace FTK::Server
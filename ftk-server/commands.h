@@ -0,0 +1,23 @@
+#ifndef FTK_SERVER_COMMANDS_H
+#define FTK_SERVER_COMMANDS_H
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace FTK::Server
+{
+    // load, save and record_end take paths relative to this directory and can not leave it,
+    // set it before the server starts
+    void setSaveDirectory(const std::string &dir);
+
+    // Runs one command against the GameSession entered on the calling thread and returns its result,
+    // throws on unknown commands, bad arguments or commands that are not valid in the current state.
+    nlohmann::json execute(const std::string &command, const nlohmann::json &args);
+
+    // One request line {"id": ..., "cmd": "...", "args": {...}} in, one response line out (without the newline):
+    // {"id": ..., "ok": true, "result": ...} or {"id": ..., "ok": false, "error": "..."}
+    std::string handleLine(const std::string &line);
+} // namespace FTK::Server
+
+#endif // FTK_SERVER_COMMANDS_H
@@ -0,0 +1,88 @@
+#include <csignal>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "RegistryWatcher.h"
+#include "commands.h"
+#include "server.h"
+
+static const char *usage = "usage: ftk-server [--socket ftk.sock] [--workers n] [--saves dir]\n";
+
+static FTK::Server::Server *running = nullptr;
+
+static void onSignal(int)
+{
+    if (running)
+        running->stop();
+}
+
+int main(int argc, char **argv)
+{
+    std::string socketPath = "ftk.sock";
+    std::string saveDirectory = "saves";
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--socket")
+                socketPath = next();
+            else if (arg == "--workers")
+                workers = std::stoul(next());
+            else if (arg == "--saves")
+                saveDirectory = next();
+            else
+                throw std::invalid_argument("Unknown argument " + arg);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << usage;
+        return 2;
+    }
+
+    try
+    {
+        FTK::RegistryWatcher watcher;
+        watcher.setListener([](const std::string &file, const std::string &error)
+                            {
+                                if (!error.empty())
+                                    std::cerr << "failed to reload " << file << ": " << error << std::endl; });
+        try
+        {
+            watcher.start();
+        }
+        catch (const std::exception &e)
+        {
+            // hot reload is optional, the server runs on the gamedata it started with
+            std::cerr << e.what() << std::endl;
+        }
+        std::filesystem::create_directories(saveDirectory);
+        FTK::Server::setSaveDirectory(saveDirectory);
+        FTK::Server::Server server(socketPath, workers);
+        running = &server;
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        std::signal(SIGPIPE, SIG_IGN);
+        std::cout << "listening on " << socketPath << " with " << workers << " workers" << std::endl;
+        server.run();
+        running = nullptr;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include "server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "commands.h"
+
+namespace FTK::Server
+{
+    static std::system_error systemError(const std::string &what)
+    {
+        return std::system_error(errno, std::generic_category(), what);
+    }
+
+    Server::Server(const std::string &socketPath, size_t workerCount) : socketPath(socketPath), host(workerCount)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(addr.sun_path))
+            throw std::invalid_argument("Socket path is too long: " + socketPath);
+        std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        // the destructor does not run when this throws, so the descriptors opened so far are closed here
+        try
+        {
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd < 0)
+                throw systemError("socket");
+            unlink(socketPath.c_str());
+            if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0)
+                throw systemError("bind " + socketPath);
+            if (listen(listenFd, SOMAXCONN) < 0)
+                throw systemError("listen");
+
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (epollFd < 0 || wakeFd < 0)
+                throw systemError("epoll");
+            for (auto fd : {listenFd, wakeFd})
+            {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+                    throw systemError("epoll_ctl");
+            }
+        }
+        catch (...)
+        {
+            closeDescriptors();
+            throw;
+        }
+    }
+
+    Server::~Server()
+    {
+        while (!connections.empty())
+            closeConnection(connections.begin()->second);
+        // queued requests of closed clients still run, let them finish while this object is alive
+        host.wait();
+        closeDescriptors();
+    }
+
+    void Server::run()
+    {
+        epoll_event events[64];
+        while (!stopping)
+        {
+            int n = epoll_wait(epollFd, events, 64, -1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw systemError("epoll_wait");
+            }
+            for (int i = 0; i < n && !stopping; i++)
+            {
+                auto fd = events[i].data.fd;
+                if (fd == listenFd)
+                {
+                    acceptClients();
+                    continue;
+                }
+                if (fd == wakeFd)
+                {
+                    uint64_t count;
+                    while (read(wakeFd, &count, sizeof(count)) > 0)
+                        ;
+                    drainCompleted();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end())
+                    continue;
+                auto conn = it->second;
+                if (events[i].events & EPOLLIN)
+                    readFrom(conn);
+                if (connections.count(fd) && (events[i].events & EPOLLOUT))
+                    writeTo(conn);
+                if (connections.count(fd) && (events[i].events & (EPOLLERR | EPOLLHUP)))
+                    closeConnection(conn);
+            }
+        }
+    }
+
+    void Server::stop()
+    {
+        stopping = true;
+        uint64_t one = 1;
+        [[maybe_unused]] auto res = write(wakeFd, &one, sizeof(one));
+    }
+
+    void Server::acceptClients()
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            auto conn = std::make_shared<Connection>();
+            conn->fd = fd;
+            conn->session = host.createSession();
+            connections.emplace(fd, conn);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+
+    void Server::readFrom(const std::shared_ptr<Connection> &conn)
+    {
+        char buffer[1 << 16];
+        while (conn->reading)
+        {
+            auto n = read(conn->fd, buffer, sizeof(buffer));
+            if (n == 0)
+            {
+                // a last line without the newline is still a request
+                if (!conn->input.empty() && conn->input.back() == '\r')
+                    conn->input.pop_back();
+                if (!conn->input.empty())
+                    submit(conn, std::move(conn->input));
+                conn->input.clear();
+                conn->closing = true;
+                conn->reading = false;
+                updateInterest(conn);
+                writeTo(conn);
+                return;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                closeConnection(conn);
+                return;
+            }
+            if (n < 0)
+                break;
+            conn->input.append(buffer, n);
+
+            size_t begin = 0;
+            for (auto end = conn->input.find('\n'); end != std::string::npos; end = conn->input.find('\n', begin))
+            {
+                auto line = conn->input.substr(begin, end - begin);
+                begin = end + 1;
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (!line.empty())
+                    submit(conn, std::move(line));
+            }
+            conn->input.erase(0, begin);
+            if (conn->input.size() > MaxLineLength)
+            {
+                closeConnection(conn);
+                return;
+            }
+            if (conn->pending >= MaxPendingRequests)
+            {
+                conn->reading = false;
+                updateInterest(conn);
+            }
+        }
+    }
+
+    void Server::writeTo(const std::shared_ptr<Connection> &conn)
+    {
+        std::unique_lock lock(conn->outputMutex);
+        size_t written = 0;
+        while (written < conn->output.size())
+        {
+            auto n = send(conn->fd, conn->output.data() + written, conn->output.size() - written, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    break;
+                lock.unlock();
+                closeConnection(conn);
+                return;
+            }
+            written += n;
+        }
+        conn->output.erase(0, written);
+        bool writing = !conn->output.empty();
+        lock.unlock();
+
+        // responses are appended before pending drops, so nothing is left to send once both are zero
+        if (conn->closing && !writing && conn->pending == 0)
+        {
+            closeConnection(conn);
+            return;
+        }
+        bool reading = !conn->closing && (conn->reading || conn->pending < MaxPendingRequests / 2);
+        if (writing != conn->writing || reading != conn->reading)
+        {
+            conn->writing = writing;
+            conn->reading = reading;
+            updateInterest(conn);
+        }
+    }
+
+    void Server::closeConnection(const std::shared_ptr<Connection> &conn)
+    {
+        if (!connections.count(conn->fd))
+            return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+        close(conn->fd);
+        connections.erase(conn->fd);
+        host.closeSession(conn->session);
+    }
+
+    void Server::closeDescriptors()
+    {
+        if (listenFd >= 0)
+            unlink(socketPath.c_str());
+        for (auto fd : {listenFd, epollFd, wakeFd})
+            if (fd >= 0)
+                close(fd);
+        listenFd = epollFd = wakeFd = -1;
+    }
+
+    void Server::updateInterest(const std::shared_ptr<Connection> &conn)
+    {
+        epoll_event ev{};
+        ev.events = (conn->reading ? EPOLLIN : 0) | (conn->writing ? EPOLLOUT : 0);
+        ev.data.fd = conn->fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+    }
+
+    void Server::submit(const std::shared_ptr<Connection> &conn, std::string line)
+    {
+        conn->pending++;
+        std::weak_ptr<Connection> weak = conn;
+        host.submit(conn->session, [this, weak, line = std::move(line)](GameSession &)
+                    {
+                        auto response = handleLine(line);
+                        auto conn = weak.lock();
+                        if (!conn)
+                            return;
+                        {
+                            std::lock_guard lock(conn->outputMutex);
+                            conn->output += response;
+                            conn->output += '\n';
+                        }
+                        conn->pending--;
+                        {
+                            std::lock_guard lock(completedMutex);
+                            completed.push_back(conn);
+                        }
+                        uint64_t one = 1;
+                        [[maybe_unused]] auto res = write(wakeFd, &one, sizeof(one)); });
+    }
+
+    void Server::drainCompleted()
+    {
+        std::vector<std::weak_ptr<Connection>> ready;
+        {
+            std::lock_guard lock(completedMutex);
+            ready.swap(completed);
+        }
+        for (auto &weak : ready)
+        {
+            auto conn = weak.lock();
+            if (!conn)
+                continue;
+            if (auto it = connections.find(conn->fd); it != connections.end() && it->second == conn)
+                writeTo(conn);
+        }
+    }
+} // namespace FTK::Server
@@ -0,0 +1,74 @@
+#ifndef FTK_SERVER_SERVER_H
+#define FTK_SERVER_SERVER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SessionHost.h"
+
+namespace FTK::Server
+{
+    // JSON-lines over a Unix domain socket, one GameSession per connection.
+    // A single thread runs the epoll loop (accept, read, write); requests are handed to a SessionHost,
+    // so one client's requests run in order while different clients run in parallel. Clients may
+    // pipeline: every complete line is queued at once and responses come back in request order.
+    // A client that shuts down its write side still gets the responses to everything it sent; the
+    // connection closes once those are flushed.
+    class Server
+    {
+    public:
+        Server(const std::string &socketPath, size_t workerCount);
+        Server(const Server &other) = delete;
+        ~Server();
+
+        void run();
+        // safe to call from a signal handler
+        void stop();
+
+        // reading from a client pauses while this many of its requests are unanswered
+        static constexpr size_t MaxPendingRequests = 1024;
+        static constexpr size_t MaxLineLength = 1 << 20;
+
+    private:
+        struct Connection
+        {
+            int fd;
+            SessionHost::SessionID session;
+            std::string input;
+            std::mutex outputMutex;
+            std::string output;
+            std::atomic<size_t> pending{0};
+            bool reading = true;
+            bool writing = false;
+            // the client sent EOF, close once every response is written
+            bool closing = false;
+        };
+
+        void acceptClients();
+        void readFrom(const std::shared_ptr<Connection> &conn);
+        void writeTo(const std::shared_ptr<Connection> &conn);
+        void closeConnection(const std::shared_ptr<Connection> &conn);
+        void closeDescriptors();
+        void updateInterest(const std::shared_ptr<Connection> &conn);
+        void submit(const std::shared_ptr<Connection> &conn, std::string line);
+        void drainCompleted();
+
+        std::string socketPath;
+        int listenFd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;
+        std::atomic<bool> stopping = false;
+
+        SessionHost host;
+        std::unordered_map<int, std::shared_ptr<Connection>> connections;
+
+        std::mutex completedMutex;
+        std::vector<std::weak_ptr<Connection>> completed;
+    };
+} // namespace FTK::Server
+
+#endif // FTK_SERVER_SERVER_H
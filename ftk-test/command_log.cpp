@@ -0,0 +1,151 @@
+#include "suites.h"
+
+#include "CombatAI.h"
+#include "CommandLog.h"
+#include "GameManager.h"
+#include "IDSource.h"
+#include "combat.h"
+#include "fixtures.h"
+
+namespace FTK::Test
+{
+    // plays a fixed script of explore turns: every move tries the four directions in an order that rotates with the step,
+    // interactions are skipped, so the same map and seed always give the same commands
+    static void playExplore(size_t steps)
+    {
+        static const Vec2i directions[] = {Vec2i(1, 0), Vec2i(0, 1), Vec2i(-1, 0), Vec2i(0, -1)};
+        auto gameMgr = GameManager::getInstance();
+        for (size_t step = 0; step < steps; step++)
+        {
+            if (gameMgr->getGameState() == GameState::Interact)
+            {
+                gameMgr->markInteractionDone(true);
+                continue;
+            }
+            switch (gameMgr->getExploreState())
+            {
+            case ExploreState::BeginRound:
+                gameMgr->beginRound();
+                break;
+            case ExploreState::BeginTurn:
+                gameMgr->beginTurn();
+                break;
+            case ExploreState::RollAP:
+                gameMgr->rollAP(0);
+                break;
+            case ExploreState::Move:
+            {
+                auto pos = gameMgr->getCurrentPlayer()->getPos();
+                bool moved = false;
+                for (size_t i = 0; i < 4 && !moved; i++)
+                    moved = gameMgr->movePlayer(pos + directions[(step + i) % 4]);
+                if (!moved)
+                    return;
+                break;
+            }
+            case ExploreState::EndTurn:
+                gameMgr->endTurn();
+                break;
+            case ExploreState::EndRound:
+                gameMgr->endRound();
+                break;
+            default:
+                return;
+            }
+        }
+    }
+
+    static std::shared_ptr<CommandLog> record(unsigned int mapSeed, unsigned int logSeed)
+    {
+        auto session = makeSession();
+        GameSession::Scope scope(*session);
+        loadGenerated(mapSeed);
+        auto log = CommandLog::getInstance();
+        log->begin(logSeed);
+        playExplore(200);
+        log->end();
+        return CommandLog::decode(log->encode());
+    }
+
+    static uint32_t replayInSession(const CommandLog &log)
+    {
+        auto session = makeSession();
+        GameSession::Scope scope(*session);
+        return log.replay();
+    }
+
+    void registerCommandLogTests(Runner &runner)
+    {
+        runner.add("command_log/encode_round_trip", []()
+                   {
+                       auto session = makeSession();
+                       GameSession::Scope scope(*session);
+                       loadGenerated(3);
+                       CombatAIOptions options;
+                       options.timeBudget = std::chrono::milliseconds(0);
+                       options.iterations = 64;
+                       options.trees = 2;
+                       options.workers = 1;
+                       session->getCombatSystem()->setEnemyAI(std::make_shared<CombatAI>(options));
+
+                       auto log = CommandLog::getInstance();
+                       log->begin(42);
+                       playExplore(40);
+                       auto target = IDSource::fromBits(1, 2);
+                       CommandLog::recordChoice("skill:attack", target);
+                       log->end();
+
+                       auto decoded = CommandLog::decode(log->encode());
+                       checkEqual(decoded->getSeed(), 42u, "seed");
+                       check(decoded->getSnapshot() == log->getSnapshot(), "the snapshot differs");
+                       check(decoded->getCommands() == log->getCommands(), "the commands differ");
+                       check(decoded->hasFinalHash(), "the final hash is missing");
+                       checkEqual(decoded->getFinalHash(), log->getFinalHash(), "final hash");
+                       check(decoded->getAIOptions().has_value(), "the AI options are missing");
+                       checkEqual(decoded->getAIOptions()->iterations, (size_t)64, "AI iterations");
+                       checkEqual(decoded->getAIOptions()->trees, (size_t)2, "AI trees");
+                       checkEqual(decoded->getAIOptions()->timeBudget.count(), (long long)0, "AI time budget");
+
+                       auto &last = decoded->getCommands().back();
+                       check(last.type == CommandType::EnemyChoice, "the enemy choice is not the last command");
+                       check(decoded->encode() == log->encode(), "encoding is not stable"); });
+        runner.add("command_log/decode_rejects_bad_data", []()
+                   {
+                       auto data = record(3, 1)->encode();
+                       auto badMagic = data;
+                       badMagic[0] = 'X';
+                       checkThrows([&badMagic]()
+                                   { CommandLog::decode(badMagic); },
+                                   "decoding a bad magic");
+                       auto badVersion = data;
+                       badVersion[6] = 99;
+                       checkThrows([&badVersion]()
+                                   { CommandLog::decode(badVersion); },
+                                   "decoding an unsupported version");
+                       auto truncated = data;
+                       truncated.resize(truncated.size() / 2);
+                       checkThrows([&truncated]()
+                                   { CommandLog::decode(truncated); },
+                                   "decoding a truncated log"); });
+        runner.add("command_log/restores_id_source", []()
+                   {
+                       auto session = makeSession();
+                       GameSession::Scope scope(*session);
+                       loadGenerated(3);
+                       auto before = IDSource::getInstance();
+                       auto log = CommandLog::getInstance();
+                       log->begin(5);
+                       check(IDSource::getInstance() != before, "begin did not install a seeded source");
+                       log->end();
+                       check(IDSource::getInstance() == before, "end did not restore the source");
+                       log->replay();
+                       check(IDSource::getInstance() == before, "replay did not restore the source"); });
+        runner.add("command_log/replay_is_deterministic", []()
+                   {
+                       auto log = record(7, 1234);
+                       check(log->getCommands().size() > 20, "the script recorded too few commands");
+                       checkEqual(replayInSession(*log), log->getFinalHash(), "hash of the first replay");
+                       checkEqual(replayInSession(*log), log->getFinalHash(), "hash of the second replay");
+                       checkEqual(record(7, 1234)->getFinalHash(), log->getFinalHash(), "hash of a second recording"); });
+    }
+} // namespace FTK::Test
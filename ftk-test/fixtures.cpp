@@ -0,0 +1,39 @@
+#include "fixtures.h"
+
+#include <filesystem>
+
+#include <nlohmann/json.hpp>
+
+#include "GameManager.h"
+#include "WorldGenerator.h"
+
+namespace FTK::Test
+{
+    std::shared_ptr<GameSession> makeSession()
+    {
+        return std::make_shared<GameSession>(1u);
+    }
+
+    void loadGenerated(unsigned int seed)
+    {
+        WorldGeneratorOptions options;
+        options.seed = seed;
+        options.dimension = Vec2i(40, 30);
+        options.enemyCount = 6;
+        // the generator writes ordered_json, loadMapFromJson reads json
+        GameManager::getInstance()->loadMapFromJson(nlohmann::json::parse(WorldGenerator(options).generate().dump()));
+    }
+
+    std::string tempPath(const std::string &name)
+    {
+        // emptied once per run, so files of an earlier run never make a test pass
+        static const auto dir = []()
+        {
+            auto dir = std::filesystem::temp_directory_path() / "ftk-test";
+            std::filesystem::remove_all(dir);
+            std::filesystem::create_directories(dir);
+            return dir;
+        }();
+        return (dir / name).string();
+    }
+} // namespace FTK::Test
@@ -0,0 +1,19 @@
+#ifndef FTK_TEST_FIXTURES_H
+#define FTK_TEST_FIXTURES_H
+
+#include <memory>
+#include <string>
+
+#include "GameSession.h"
+
+namespace FTK::Test
+{
+    // a seeded session of its own, so a test neither sees nor disturbs the process-wide game
+    std::shared_ptr<GameSession> makeSession();
+    // a small generated map loaded into the session entered on the calling thread, the same seed gives the same game
+    void loadGenerated(unsigned int seed);
+    // a file name in a directory under the system temp directory that is emptied once per run
+    std::string tempPath(const std::string &name);
+} // namespace FTK::Test
+
+#endif // FTK_TEST_FIXTURES_H
@@ -0,0 +1,30 @@
+#include <iostream>
+
+#include "suites.h"
+#include "test.h"
+
+int main(int argc, char **argv)
+{
+    FTK::Test::Options options;
+    try
+    {
+        options = FTK::Test::Options::parse(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n"
+                  << "usage: ftk-test [--filter substr] [--list]\n";
+        return 2;
+    }
+
+    FTK::Test::Runner runner(options);
+    FTK::Test::registerAllTests(runner);
+
+    if (options.listOnly)
+    {
+        for (auto &name : runner.list())
+            std::cout << name << "\n";
+        return 0;
+    }
+    return runner.run() ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+#include "suites.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#include "CommandLog.h"
+#include "GameManager.h"
+#include "SaveContainer.h"
+#include "fixtures.h"
+
+namespace FTK::Test
+{
+    static std::vector<uint8_t> randomBytes(size_t size, unsigned int seed)
+    {
+        std::mt19937 engine(seed);
+        std::vector<uint8_t> res(size);
+        for (auto &b : res)
+            b = (uint8_t)engine();
+        return res;
+    }
+
+    static std::string repeatedText(size_t copies)
+    {
+        std::string res;
+        for (size_t i = 0; i < copies; i++)
+            res += "{\"id\":\"enemy:goblin\",\"pos\":[" + std::to_string(i % 97) + "," + std::to_string(i % 31) + "],\"hp\":40},";
+        return res;
+    }
+
+    static std::vector<uint8_t> readBytes(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    }
+
+    static void writeBytes(const std::string &path, const std::vector<uint8_t> &data)
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write((const char *)data.data(), data.size());
+    }
+
+    static SaveContainer sampleContainer()
+    {
+        SaveContainer container;
+        container.put("world", repeatedText(500));
+        auto noise = randomBytes(3000, 5);
+        container.put("state", std::string(noise.begin(), noise.end()));
+        return container;
+    }
+
+    void registerSaveContainerTests(Runner &runner)
+    {
+        runner.add("save_container/compress_round_trip", []()
+                   {
+                       auto text = repeatedText(200);
+                       std::vector<std::vector<uint8_t>> inputs{{}, {'a', 'b', 'c'}, std::vector<uint8_t>(10000, 'a'), randomBytes(5000, 1), std::vector<uint8_t>(text.begin(), text.end())};
+                       for (auto &input : inputs)
+                       {
+                           auto compressed = SaveContainer::compress(input.data(), input.size());
+                           check(SaveContainer::decompress(compressed.data(), compressed.size(), input.size()) == input, "decompressing " + std::to_string(input.size()) + " bytes gives other bytes");
+                       }
+                       check(SaveContainer::compress(inputs[2].data(), inputs[2].size()).size() < inputs[2].size() / 10, "a run of one byte barely compresses"); });
+        runner.add("save_container/sections_round_trip", []()
+                   {
+                       auto container = sampleContainer();
+                       auto decoded = SaveContainer::decode(container.encode());
+                       checkEqual(decoded.getSections().size(), (size_t)2, "sections");
+                       check(decoded.get("world") == container.get("world"), "the world section differs");
+                       check(decoded.get("state") == container.get("state"), "the state section differs");
+                       check(decoded.getSections()[0].codec == SaveContainer::Codec::LZ, "text is stored compressed");
+                       check(decoded.getSections()[1].codec == SaveContainer::Codec::Stored, "noise is stored as it is");
+                       check(decoded.encode() == container.encode(), "encoding is not stable");
+
+                       container.put("world", "replaced");
+                       checkEqual(container.getSections().size(), (size_t)2, "sections after replacing one");
+                       checkEqual(container.get("world"), std::string("replaced"), "replaced section");
+                       checkThrows([&container]()
+                                   { container.get("missing"); },
+                                   "getting a missing section"); });
+        runner.add("save_container/file_round_trip", []()
+                   {
+                       auto path = tempPath("round_trip.ftksave");
+                       auto container = sampleContainer();
+                       container.save(path);
+                       check(!std::filesystem::exists(path + ".tmp"), "the temporary file is left behind");
+                       check(SaveContainer::isContainer(path) && SaveContainer::hasExtension(path), "not recognized as a container");
+                       check(SaveContainer::load(path).get("world") == container.get("world"), "the loaded world differs");
+
+                       // saving over an existing file replaces it
+                       SaveContainer other;
+                       other.put("world", "small");
+                       other.save(path);
+                       checkEqual(SaveContainer::load(path).get("world"), std::string("small"), "the world after saving over it"); });
+        runner.add("save_container/list_reads_header_only", []()
+                   {
+                       auto path = tempPath("corrupted.ftksave");
+                       sampleContainer().save(path);
+                       auto listed = SaveContainer::list(path);
+                       check(listed.valid, "list: " + listed.error);
+                       checkEqual(listed.sections.size(), (size_t)2, "listed sections");
+                       checkEqual(listed.fileSize, (uint64_t)std::filesystem::file_size(path), "listed file size");
+                       check(SaveContainer::verify(path).valid, "a fresh save does not verify");
+
+                       // a flipped payload byte is only found by verify, list trusts the header
+                       auto data = readBytes(path);
+                       data[data.size() - 10] ^= 0xFF;
+                       writeBytes(path, data);
+                       check(SaveContainer::list(path).valid, "list read the payload");
+                       check(!SaveContainer::verify(path).valid, "verify missed a corrupted section");
+                       checkThrows([&path]()
+                                   { SaveContainer::load(path); },
+                                   "loading a corrupted save");
+
+                       // a truncated file is found by the sizes in the header
+                       data.resize(data.size() - 100);
+                       writeBytes(path, data);
+                       check(!SaveContainer::list(path).valid, "list missed a truncated save"); });
+        runner.add("save_container/rejects_corrupted_header", []()
+                   {
+                       auto data = sampleContainer().encode();
+                       data[10] ^= 0x01;
+                       checkThrows([&data]()
+                                   { SaveContainer::decode(data); },
+                                   "decoding a corrupted header");
+                       checkThrows([]()
+                                   { SaveContainer::decode({'n', 'o', 'p', 'e'}); },
+                                   "decoding something that is not a save"); });
+        runner.add("save_container/game_round_trip", []()
+                   {
+                       auto path = tempPath("game.ftksave");
+                       auto saved = makeSession();
+                       uint32_t hash;
+                       {
+                           GameSession::Scope scope(*saved);
+                           loadGenerated(11);
+                           GameManager::getInstance()->saveMap(path);
+                           hash = CommandLog::hashState();
+                       }
+                       auto loaded = makeSession();
+                       GameSession::Scope scope(*loaded);
+                       GameManager::getInstance()->loadMap(path);
+                       checkEqual(CommandLog::hashState(), hash, "state hash after loading the save"); });
+    }
+} // namespace FTK::Test
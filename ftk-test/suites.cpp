@@ -0,0 +1,11 @@
+#include "suites.h"
+
+namespace FTK::Test
+{
+    void registerAllTests(Runner &runner)
+    {
+        registerVisibilityMapTests(runner);
+        registerSaveContainerTests(runner);
+        registerCommandLogTests(runner);
+    }
+} // namespace FTK::Test
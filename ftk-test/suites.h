@@ -0,0 +1,15 @@
+#ifndef FTK_TEST_SUITES_H
+#define FTK_TEST_SUITES_H
+
+#include "test.h"
+
+namespace FTK::Test
+{
+    void registerVisibilityMapTests(Runner &runner);
+    void registerSaveContainerTests(Runner &runner);
+    void registerCommandLogTests(Runner &runner);
+
+    void registerAllTests(Runner &runner);
+} // namespace FTK::Test
+
+#endif // FTK_TEST_SUITES_H
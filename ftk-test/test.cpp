@@ -0,0 +1,79 @@
+#include "test.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace FTK::Test
+{
+    Options Options::parse(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg(argv[i]);
+            auto next = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--filter")
+                options.filter = next();
+            else if (arg == "--list")
+                options.listOnly = true;
+            else
+                throw std::invalid_argument("Unknown argument " + arg);
+        }
+        return options;
+    }
+
+    Runner::Runner(const Options &options) : options(options)
+    {
+    }
+
+    void Runner::add(const std::string &name, const std::function<void()> &body)
+    {
+        tests.push_back({name, body});
+    }
+
+    std::vector<std::string> Runner::list() const
+    {
+        std::vector<std::string> res;
+        for (auto &test : tests)
+            if (matches(test.name))
+                res.push_back(test.name);
+        return res;
+    }
+
+    size_t Runner::run() const
+    {
+        size_t ran = 0;
+        size_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto &test : tests)
+        {
+            if (!matches(test.name))
+                continue;
+            ran++;
+            try
+            {
+                test.body();
+                std::cout << "ok    " << test.name << std::endl;
+            }
+            catch (const std::exception &e)
+            {
+                std::cout << "FAIL  " << test.name << ": " << e.what() << std::endl;
+                failed++;
+            }
+        }
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << ran << " tests, " << failed << " failed in " << std::fixed << std::setprecision(3) << elapsed << " s" << std::endl;
+        return failed;
+    }
+
+    bool Runner::matches(const std::string &name) const
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    }
+} // namespace FTK::Test
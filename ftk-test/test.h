@@ -0,0 +1,87 @@
+#ifndef FTK_TEST_TEST_H
+#define FTK_TEST_TEST_H
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace FTK::Test
+{
+    struct Options
+    {
+        std::string filter;
+        bool listOnly = false;
+
+        static Options parse(int argc, char **argv);
+    };
+
+    struct Test
+    {
+        std::string name;
+        std::function<void()> body;
+    };
+
+    // thrown by the checks, any other exception fails the test as well
+    class Failure : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Runs every test whose name contains the filter, each one on its own, and reports the failures.
+    class Runner
+    {
+    public:
+        explicit Runner(const Options &options);
+
+        void add(const std::string &name, const std::function<void()> &body);
+
+        std::vector<std::string> list() const;
+        // the number of failed tests
+        size_t run() const;
+
+    private:
+        bool matches(const std::string &name) const;
+
+        Options options;
+        std::vector<Test> tests;
+    };
+
+    inline void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+            throw Failure(what);
+    }
+
+    template <typename T, typename U>
+    inline void checkEqual(const T &actual, const U &expected, const std::string &what)
+    {
+        if (actual == expected)
+            return;
+        std::ostringstream os;
+        os << what << ": got " << actual << ", expected " << expected;
+        throw Failure(os.str());
+    }
+
+    template <typename Func>
+    inline void checkThrows(Func func, const std::string &what)
+    {
+        try
+        {
+            func();
+        }
+        catch (const Failure &)
+        {
+            throw;
+        }
+        catch (const std::exception &)
+        {
+            return;
+        }
+        throw Failure(what + " did not throw");
+    }
+} // namespace FTK::Test
+
+#endif // FTK_TEST_TEST_H
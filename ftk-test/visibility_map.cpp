@@ -0,0 +1,73 @@
+#include "suites.h"
+
+#include "VisibilityMap.h"
+
+namespace FTK::Test
+{
+    static void checkSameCells(const VisibilityMap &actual, const VisibilityMap &expected)
+    {
+        checkEqual(actual.dimension, expected.dimension, "dimension");
+        for (int y = 0; y < expected.dimension.getY(); y++)
+            for (int x = 0; x < expected.dimension.getX(); x++)
+                if (actual.isVisible(x, y) != expected.isVisible(x, y))
+                    throw Failure("cell " + std::to_string(x) + "," + std::to_string(y) + " differs");
+        checkEqual(actual.countVisible(), expected.countVisible(), "visible cells");
+    }
+
+    // wider than two words per row, revealed across word boundaries, the corners and past the edges
+    static VisibilityMap revealedMap()
+    {
+        VisibilityMap map(Vec2i(130, 40));
+        map.reveal(Vec2i(0, 0), 3);
+        map.reveal(Vec2i(64, 20), 5);
+        map.reveal(Vec2i(127, 10), 4);
+        map.reveal(Vec2i(129, 39), 3);
+        map.reveal(Vec2i(200, 200), 3);
+        map.markVisible(Vec2i(30, 30));
+        return map;
+    }
+
+    void registerVisibilityMapTests(Runner &runner)
+    {
+        runner.add("visibility_map/rle_round_trip", []()
+                   {
+                       auto map = revealedMap();
+                       check(map.countVisible() > 0, "nothing was revealed");
+                       auto runs = map.encode();
+                       auto decoded = VisibilityMap::decode(map.dimension, runs);
+                       checkSameCells(decoded, map);
+                       check(decoded.encode() == runs, "encoding the decoded map gives other runs"); });
+        runner.add("visibility_map/rows_round_trip", []()
+                   {
+                       auto map = revealedMap();
+                       auto fromRows = VisibilityMap::fromRows(map.dimension, map.toRows());
+                       checkSameCells(fromRows, map);
+                       check(fromRows.encode() == map.encode(), "both layouts must describe the same cells"); });
+        runner.add("visibility_map/empty_and_full", []()
+                   {
+                       VisibilityMap empty(Vec2i(70, 3));
+                       checkSameCells(VisibilityMap::decode(empty.dimension, empty.encode()), empty);
+                       checkEqual(empty.countVisible(), (size_t)0, "visible cells of a new map");
+
+                       VisibilityMap full(Vec2i(70, 3));
+                       for (int y = 0; y < 3; y++)
+                           for (int x = 0; x < 70; x++)
+                               full.markVisible(Vec2i(x, y));
+                       check(full.encode() == std::vector<size_t>{0, 210}, "a full map is an empty hidden run and one visible run");
+                       checkSameCells(VisibilityMap::decode(full.dimension, full.encode()), full); });
+        runner.add("visibility_map/decode_rejects_overflow", []()
+                   { checkThrows([]()
+                                 { VisibilityMap::decode(Vec2i(4, 4), {10, 7}); },
+                                 "decoding runs longer than the map"); });
+        runner.add("visibility_map/changed_cells", []()
+                   {
+                       VisibilityMap map(Vec2i(20, 20));
+                       map.reveal(Vec2i(10, 10), 3);
+                       checkEqual(map.getChangedCells().size(), map.countVisible(), "changed cells of the first reveal");
+                       for (auto &pos : map.getChangedCells())
+                           check(map.isVisible(pos), "a changed cell is not visible");
+                       map.clearChangedCells();
+                       map.reveal(Vec2i(10, 10), 3);
+                       check(map.getChangedCells().empty(), "revealing the same cells again changes nothing"); });
+    }
+} // namespace FTK::Test
@@ -1,14 +1,17 @@
 #include "Action.h"
 
-#include <effolkronium/random.hpp>
-
 #include "Buff.h"
+#include "Random.h"
 #include "Registry.h"
+#include "utils.h"
 
-static FTK::Math::Expression diceMult("rolled_result/dice_rolls");
-static FTK::Math::Condition requireCriticalSuccess("rolled_result==dice_rolls");
-static FTK::Math::Condition requireCriticalFail("rolled_result==0");
-static FTK::Math::Condition requireAny("rolled_result>0");
+static FTK::Math::Expression diceMult("formula:dice_mult");
+static FTK::Math::Condition requireCriticalSuccess("formula:critical_success");
+static FTK::Math::Condition requireCriticalFail("formula:critical_fail");
+static FTK::Math::Condition requireAny("formula:any_success");
+static FTK::Math::Condition allowPartial("skill.allow_partial");
+static FTK::Math::Expression physicalAbsorbtionFormula("formula:physical_absorption");
+static FTK::Math::Expression magicalAbsorbtionFormula("formula:magical_absorption");
 
 namespace FTK
 {
@@ -23,10 +26,10 @@ namespace FTK
 
     bool Action::shouldHaveEffect(const ActionContext &ctx, bool activeSkill) const
     {
-        if (!ctx.condition.eval(ctx.mathContext))
+        if (!ctx.condition.eval(ctx.bindings))
             return false;
         if (activeSkill)
-            return requireCriticalSuccess.eval(ctx.mathContext);
+            return requireCriticalSuccess.eval(ctx.bindings);
         return true;
     }
 
@@ -34,14 +37,23 @@ namespace FTK
     {
     }
 
-    Math::Context Action::getContext(const std::string &key, const Math::Context &base) const
+    void Action::bindContext(const std::string &key, Math::Bindings &bindings) const
     {
-        auto res = base;
-        res[key] = Math::Context();
-        res[key]["action_type"] = (int)actionType;
-        res[key]["target_type"] = (int)targetType;
-        res[key]["target_scope"] = (int)targetScope;
-        return res;
+        bindings.bind(key, getResolver());
+    }
+
+    Math::Bindings::Resolver Action::getResolver() const
+    {
+        return [actionType = actionType, targetType = targetType, targetScope = targetScope](const std::string &field) -> cparse::packToken
+        {
+            if (field == "action_type")
+                return (int)actionType;
+            if (field == "target_type")
+                return (int)targetType;
+            if (field == "target_scope")
+                return (int)targetScope;
+            return cparse::packToken::None();
+        };
     }
 
     std::string Action::getSerialType() const
@@ -64,51 +76,106 @@ namespace FTK
 
     bool DamageAction::shouldHaveEffect(const ActionContext &ctx, bool activeSkill) const
     {
-        if (!ctx.condition.eval(ctx.mathContext))
+        if (!ctx.condition.eval(ctx.bindings))
             return false;
         if (!activeSkill)
             return true;
         return true;
-        return requireAny(ctx.mathContext);
+        return requireAny.eval(ctx.bindings);
     }
 
     void DamageAction::apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill) const
     {
-        static auto physicalAbsorbtionFormula = Math::Expression("target.p_def/(target.p_def+50)");
-        static auto magicalAbsorbtionFormula = Math::Expression("target.m_def/(target.m_def+50)");
-
         if (damageType != DamageType::Default && damageType != DamageType::Physical && damageType != DamageType::Magical && damageType != DamageType::True)
             return;
 
         DamageType dmgT = damageType;
         if (damageType == DamageType::Default)
             dmgT = source->getDamageType();
-        double dmg = damageExpr.eval(context.mathContext);
+        double dmg = damageExpr.eval(context.bindings);
         if (dmgT == DamageType::Physical)
-            dmg *= 1 - physicalAbsorbtionFormula.eval(context.mathContext);
+            dmg *= 1 - physicalAbsorbtionFormula.eval(context.bindings);
         else if (dmgT == DamageType::Magical)
-            dmg *= 1 - magicalAbsorbtionFormula.eval(context.mathContext);
+            dmg *= 1 - magicalAbsorbtionFormula.eval(context.bindings);
         if (activeSkill)
         {
-            if (cparse::calculator::calculate("skill.allow_partial", context.mathContext).asBool())
-                dmg *= diceMult.eval(context.mathContext);
+            if (allowPartial.eval(context.bindings))
+                dmg *= diceMult.eval(context.bindings);
             else
-                dmg *= requireCriticalSuccess.eval(context.mathContext);
+                dmg *= requireCriticalSuccess.eval(context.bindings);
         }
         dmg *= target->get("dmg_taken");
         if (activeSkill)
         {
-            context.mathContext["main_damage"] = (int)dmg;
-            context.mathContext["did_damage"] = (int)dmg > 0;
+            context.bindings["main_damage"] = (int)dmg;
+            context.bindings["did_damage"] = (int)dmg > 0;
         }
         target->dec("hp", (int)dmg);
     }
 
-    Math::Context DamageAction::getContext(const std::string &key, const Math::Context &base) const
+    void DamageAction::applyBatch(const std::shared_ptr<Entity> &source, const std::vector<std::shared_ptr<Entity>> &targets, ActionContext &context, bool activeSkill) const
     {
-        auto res = Action::getContext(key, base);
-        res[key]["damage_type"] = (int)damageType;
-        return res;
+        if (damageType != DamageType::Default && damageType != DamageType::Physical && damageType != DamageType::Magical && damageType != DamageType::True)
+            return;
+        if (targets.empty())
+            return;
+
+        DamageType dmgT = damageType;
+        if (damageType == DamageType::Default)
+            dmgT = source->getDamageType();
+        auto count = targets.size();
+        auto bindTarget = [&targets](size_t lane, Math::Bindings &bindings)
+        {
+            targets[lane]->bindMathContext("target", bindings);
+        };
+
+        // columns of the packed targets, absorbed stays 0 for true damage
+        std::vector<double> dmg(count), absorbed(count, 0), taken(count);
+        damageExpr.evalEach(context.bindings, "target", count, bindTarget, dmg.data());
+        if (dmgT == DamageType::Physical)
+            physicalAbsorbtionFormula.evalEach(context.bindings, "target", count, bindTarget, absorbed.data());
+        else if (dmgT == DamageType::Magical)
+            magicalAbsorbtionFormula.evalEach(context.bindings, "target", count, bindTarget, absorbed.data());
+        double mult = 1;
+        if (activeSkill)
+        {
+            if (allowPartial.eval(context.bindings))
+                mult = diceMult.eval(context.bindings);
+            else
+                mult = requireCriticalSuccess.eval(context.bindings);
+        }
+        for (size_t i = 0; i < count; i++)
+            taken[i] = targets[i]->get("dmg_taken");
+
+        // multiplied in the order apply uses, a factor of exactly 1 leaves every bit as it was
+        for (size_t i = 0; i < count; i++)
+            dmg[i] = dmg[i] * (1 - absorbed[i]) * mult * taken[i];
+
+        for (size_t i = 0; i < count; i++)
+            targets[i]->dec("hp", (int)dmg[i]);
+        if (activeSkill)
+        {
+            context.bindings["main_damage"] = (int)dmg.back();
+            context.bindings["did_damage"] = (int)dmg.back() > 0;
+        }
+    }
+
+    bool DamageAction::canApplyBatch() const
+    {
+        for (auto &v : damageExpr.getVariables())
+            if (v.name == "main_damage" || v.name == "did_damage")
+                return false;
+        return true;
+    }
+
+    Math::Bindings::Resolver DamageAction::getResolver() const
+    {
+        return [base = Action::getResolver(), damageType = damageType](const std::string &field) -> cparse::packToken
+        {
+            if (field == "damage_type")
+                return (int)damageType;
+            return base(field);
+        };
     }
 
     std::string DamageAction::getSerialType() const
@@ -131,27 +198,30 @@ namespace FTK
 
     bool HealAction::shouldHaveEffect(const ActionContext &ctx, bool activeSkill) const
     {
-        if (!ctx.condition.eval(ctx.mathContext))
+        if (!ctx.condition.eval(ctx.bindings))
             return false;
         if (!activeSkill)
             return true;
         return true;
-        return requireAny(ctx.mathContext);
+        return requireAny.eval(ctx.bindings);
     }
 
     void HealAction::apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill) const
     {
         if (damageType != DamageType::Heal)
             return;
-        double healAmt = healExpr.eval(context.mathContext);
+        double healAmt = healExpr.eval(context.bindings);
         target->inc("hp", (int)healAmt);
     }
 
-    Math::Context HealAction::getContext(const std::string &key, const Math::Context &base) const
+    Math::Bindings::Resolver HealAction::getResolver() const
     {
-        auto res = Action::getContext(key, base);
-        res[key]["damage_type"] = (int)damageType;
-        return res;
+        return [base = Action::getResolver(), damageType = damageType](const std::string &field) -> cparse::packToken
+        {
+            if (field == "damage_type")
+                return (int)damageType;
+            return base(field);
+        };
     }
 
     std::string HealAction::getSerialType() const
@@ -220,20 +290,19 @@ namespace FTK
 
     bool DestroyAction::shouldHaveEffect(const ActionContext &ctx, bool activeSkill) const
     {
-        if (!ctx.condition.eval(ctx.mathContext))
+        if (!ctx.condition.eval(ctx.bindings))
             return false;
-        return requireAny.eval(ctx.mathContext);
+        return requireAny.eval(ctx.bindings);
     }
 
     void DestroyAction::apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill) const
     {
         std::vector<EquipmentType> box;
-        for (auto p : target->getEquipments())
-            if (p.second)
-                box.push_back(p.first);
+        target->forEachEquipped([&box](EquipmentType slot, const Equipment &)
+                                { box.push_back(slot); });
         if (!box.empty())
         {
-            effolkronium::random_static::shuffle(box);
+            Random::getInstance()->shuffle(box);
             target->removeEquipment(box.front());
         }
     }
@@ -259,7 +328,7 @@ namespace FTK
     void ModifyStatAction::apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill) const
     {
         auto realPath = targetPath;
-        if (targetPath._Starts_with("stat."))
+        if (startsWith(targetPath, "stat."))
             realPath = targetPath.substr(std::string("stat.").size());
         target->set(realPath, target->get(realPath) + modifyAmount);
     }
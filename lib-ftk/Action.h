@@ -13,7 +13,7 @@ namespace FTK
 {
     struct ActionContext
     {
-        Math::Context mathContext = Math::Context::default_global();
+        Math::Bindings bindings;
         Math::Condition condition = "1";
         std::map<std::string, std::vector<uuids::uuid>> modsToBeRemoved = {};
     };
@@ -28,7 +28,8 @@ namespace FTK
         virtual bool shouldHaveEffect(const ActionContext &ctx, bool activeSkill = false) const;
         virtual void apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill = false) const;
 
-        virtual Math::Context getContext(const std::string &key, const Math::Context &base = Math::Context::default_global()) const;
+        // binds key to this action's type, target type and scope, damage actions add their damage type
+        void bindContext(const std::string &key, Math::Bindings &bindings) const;
 
         virtual std::string getSerialType() const;
 
@@ -36,6 +37,10 @@ namespace FTK
         const TargetType targetType;
         const TargetScope targetScope;
 
+    protected:
+        // reads the fields bound by bindContext
+        virtual Math::Bindings::Resolver getResolver() const;
+
     private:
         friend nlohmann::adl_serializer<Action>;
         friend nlohmann::adl_serializer<std::shared_ptr<Action>>;
@@ -50,14 +55,20 @@ namespace FTK
 
         bool shouldHaveEffect(const ActionContext &ctx, bool activeSkill = false) const override;
         void apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill = false) const override;
-
-        Math::Context getContext(const std::string &key, const Math::Context &base = Math::Context::default_global()) const override;
+        // The same as apply on each target in order, with the damage of every target computed before any hp
+        // is written back. Only for damage expressions that canApplyBatch, on targets other than the source.
+        void applyBatch(const std::shared_ptr<Entity> &source, const std::vector<std::shared_ptr<Entity>> &targets, ActionContext &context, bool activeSkill = false) const;
+        // false when the damage reads the values apply writes into the context
+        bool canApplyBatch() const;
 
         std::string getSerialType() const override;
 
         const DamageType damageType;
         const Math::Expression damageExpr;
 
+    protected:
+        Math::Bindings::Resolver getResolver() const override;
+
     private:
         friend nlohmann::adl_serializer<DamageAction>;
     };
@@ -72,13 +83,14 @@ namespace FTK
         virtual bool shouldHaveEffect(const ActionContext &ctx, bool activeSkill = false) const override;
         void apply(const std::shared_ptr<Entity> &source, const std::shared_ptr<Entity> &target, ActionContext &context, bool activeSkill = false) const override;
 
-        Math::Context getContext(const std::string &key, const Math::Context &base = Math::Context::default_global()) const override;
-
         std::string getSerialType() const override;
 
         const DamageType damageType = DamageType::Heal;
         const Math::Expression healExpr;
 
+    protected:
+        Math::Bindings::Resolver getResolver() const override;
+
     private:
         friend nlohmann::adl_serializer<DamageAction>;
     };
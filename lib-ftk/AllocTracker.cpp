@@ -0,0 +1,237 @@
+#include "AllocTracker.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace FTK
+{
+    static constexpr size_t TagCount = (size_t)AllocTag::Count;
+
+    struct AtomicCounters
+    {
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> deallocations{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<size_t> freedBytes{0};
+
+        AllocCounters load() const
+        {
+            return {allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed),
+                    freedBytes.load(std::memory_order_relaxed)};
+        }
+    };
+
+    static std::array<AtomicCounters, TagCount> counters;
+    static std::array<AllocCounters, TagCount> marks;
+    static std::array<AllocCounters, TagCount> lasts;
+    static std::array<AllocCounters, TagCount> peaks;
+    static std::array<size_t, TagCount> intervals;
+    static std::mutex intervalMutex;
+
+    static thread_local AllocTag currentTag = AllocTag::None;
+    static thread_local AllocCounters threadCounters;
+
+    static AllocCounters operator-(const AllocCounters &a, const AllocCounters &b)
+    {
+        return {a.allocations - b.allocations, a.deallocations - b.deallocations, a.bytes - b.bytes, a.freedBytes - b.freedBytes};
+    }
+
+#ifdef FTK_ALLOC_TRACKING
+    // the block size is stored in front of every block so frees are counted in bytes as well
+    static constexpr size_t HeaderSize = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+    static void *trackedAlloc(size_t size) noexcept
+    {
+        auto raw = static_cast<char *>(std::malloc(size + HeaderSize));
+        if (!raw)
+            return nullptr;
+        *reinterpret_cast<size_t *>(raw) = size;
+        auto &c = counters[(size_t)currentTag];
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.bytes.fetch_add(size, std::memory_order_relaxed);
+        threadCounters.allocations++;
+        threadCounters.bytes += size;
+        return raw + HeaderSize;
+    }
+
+    static void trackedFree(void *ptr) noexcept
+    {
+        if (!ptr)
+            return;
+        auto raw = static_cast<char *>(ptr) - HeaderSize;
+        auto size = *reinterpret_cast<size_t *>(raw);
+        auto &c = counters[(size_t)currentTag];
+        c.deallocations.fetch_add(1, std::memory_order_relaxed);
+        c.freedBytes.fetch_add(size, std::memory_order_relaxed);
+        threadCounters.deallocations++;
+        threadCounters.freedBytes += size;
+        std::free(raw);
+    }
+#endif
+
+    AllocTracker::Scope::Scope(AllocTag tag) : previous(currentTag)
+    {
+        currentTag = tag;
+    }
+
+    AllocTracker::Scope::~Scope()
+    {
+        currentTag = previous;
+    }
+
+    bool AllocTracker::isEnabled()
+    {
+#ifdef FTK_ALLOC_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    AllocCounters AllocTracker::getCounters(AllocTag tag)
+    {
+        return counters[(size_t)tag].load();
+    }
+
+    AllocCounters AllocTracker::getThreadCounters()
+    {
+        return threadCounters;
+    }
+
+    AllocReport AllocTracker::getReport(AllocTag tag)
+    {
+        std::lock_guard lock(intervalMutex);
+        auto i = (size_t)tag;
+        return AllocReport{counters[i].load(), lasts[i], peaks[i], intervals[i]};
+    }
+
+    void AllocTracker::completeInterval(AllocTag tag)
+    {
+        if (!isEnabled())
+            return;
+        std::lock_guard lock(intervalMutex);
+        auto i = (size_t)tag;
+        auto now = counters[i].load();
+        lasts[i] = now - marks[i];
+        marks[i] = now;
+        if (lasts[i].allocations > peaks[i].allocations)
+            peaks[i] = lasts[i];
+        intervals[i]++;
+    }
+
+    void AllocTracker::reset()
+    {
+        std::lock_guard lock(intervalMutex);
+        for (size_t i = 0; i < TagCount; i++)
+        {
+            marks[i] = counters[i].load();
+            lasts[i] = {};
+            peaks[i] = {};
+            intervals[i] = 0;
+        }
+    }
+
+    std::string AllocTracker::getTagName(AllocTag tag)
+    {
+        switch (tag)
+        {
+        case AllocTag::None:
+            return "none";
+        case AllocTag::CombatTurn:
+            return "combat_turn";
+        case AllocTag::Frame:
+            return "frame";
+        case AllocTag::Save:
+            return "save";
+        case AllocTag::Load:
+            return "load";
+        default:
+            return "unknown";
+        }
+    }
+
+    void AllocTracker::print(std::ostream &os)
+    {
+        if (!isEnabled())
+        {
+            os << "allocation tracking disabled (configure with -DFTK_ALLOC_TRACKING=ON)\n";
+            return;
+        }
+        char line[200];
+        std::snprintf(line, sizeof(line), "%-12s %10s %14s %14s %14s %12s %12s\n", "tag", "intervals", "allocations", "bytes", "freed bytes", "last", "peak");
+        os << line;
+        size_t bytes = 0, freedBytes = 0;
+        for (size_t i = 0; i < TagCount; i++)
+        {
+            auto report = getReport((AllocTag)i);
+            std::snprintf(line, sizeof(line), "%-12s %10zu %14zu %14zu %14zu %12zu %12zu\n", getTagName((AllocTag)i).c_str(), report.intervals, report.total.allocations,
+                          report.total.bytes, report.total.freedBytes, report.last.allocations, report.peak.allocations);
+            os << line;
+            bytes += report.total.bytes;
+            freedBytes += report.total.freedBytes;
+        }
+        // a block may be freed under another tag than it was allocated under, so only the sum over tags is live
+        std::snprintf(line, sizeof(line), "live bytes %zu\n", bytes - freedBytes);
+        os << line;
+    }
+} // namespace FTK
+
+#ifdef FTK_ALLOC_TRACKING
+
+void *operator new(std::size_t size)
+{
+    if (auto ptr = FTK::trackedAlloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return FTK::trackedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return FTK::trackedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    FTK::trackedFree(ptr);
+}
+
+#endif // FTK_ALLOC_TRACKING
@@ -0,0 +1,68 @@
+#ifndef FTK_ALLOC_TRACKER_H
+#define FTK_ALLOC_TRACKER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace FTK
+{
+    enum class AllocTag
+    {
+        None,
+        CombatTurn,
+        Frame,
+        Save,
+        Load,
+        Count
+    };
+
+    struct AllocCounters
+    {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t bytes = 0;
+        size_t freedBytes = 0;
+    };
+
+    struct AllocReport
+    {
+        AllocCounters total;
+        AllocCounters last;
+        AllocCounters peak;
+        size_t intervals = 0;
+    };
+
+    // Counts heap traffic through the global operator new/delete when lib-ftk is
+    // built with FTK_ALLOC_TRACKING, every call is a no-op otherwise.
+    // Allocations are attributed to the innermost Scope on the allocating thread,
+    // completeInterval() closes one unit of work (a turn, a frame, a save) for a tag.
+    class AllocTracker
+    {
+    public:
+        class Scope
+        {
+        public:
+            explicit Scope(AllocTag tag);
+            Scope(const Scope &other) = delete;
+            ~Scope();
+
+        private:
+            AllocTag previous;
+        };
+
+        static bool isEnabled();
+
+        static AllocCounters getCounters(AllocTag tag);
+        static AllocCounters getThreadCounters();
+        static AllocReport getReport(AllocTag tag);
+
+        static void completeInterval(AllocTag tag);
+        static void reset();
+
+        static std::string getTagName(AllocTag tag);
+        static void print(std::ostream &os);
+    };
+} // namespace FTK
+
+#endif // FTK_ALLOC_TRACKER_H
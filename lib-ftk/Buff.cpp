@@ -1,6 +1,7 @@
 #include "Buff.h"
 
 #include "utils.h"
+#include "IDSource.h"
 #include "Action.h"
 
 namespace FTK
@@ -44,7 +45,7 @@ namespace FTK
         turns -= decrement;
     }
 
-    Buff::Buff(const std::string &id, int turns, const std::map<std::string, std::multiset<Modifier>> &modifierData) : Buff(uuids::uuid_system_generator{}(), id, turns, {}, modifierData)
+    Buff::Buff(const std::string &id, int turns, const std::map<std::string, std::multiset<Modifier>> &modifierData) : Buff(IDSource::generate(), id, turns, {}, modifierData)
     {
     }
 
@@ -52,6 +53,79 @@ namespace FTK
     {
     }
 
+    void BuffTimers::add(const uuids::uuid &uuid, int turns)
+    {
+        if (auto i = indexOf(uuid); i < buffUUIDs.size())
+        {
+            this->turns[i] = turns;
+            return;
+        }
+        buffUUIDs.push_back(uuid);
+        this->turns.push_back(turns);
+    }
+
+    void BuffTimers::remove(const std::set<uuids::uuid> &marked)
+    {
+        size_t i = 0;
+        while (i < buffUUIDs.size())
+        {
+            if (!marked.count(buffUUIDs[i]))
+            {
+                i++;
+                continue;
+            }
+            buffUUIDs[i] = buffUUIDs.back();
+            turns[i] = turns.back();
+            buffUUIDs.pop_back();
+            turns.pop_back();
+        }
+    }
+
+    void BuffTimers::clear()
+    {
+        buffUUIDs.clear();
+        turns.clear();
+    }
+
+    int BuffTimers::get(const uuids::uuid &uuid) const
+    {
+        if (auto i = indexOf(uuid); i < buffUUIDs.size())
+            return turns[i];
+        throw std::invalid_argument("Buff " + uuids::to_string(uuid) + " has no timer");
+    }
+
+    void BuffTimers::set(const uuids::uuid &uuid, int turns)
+    {
+        if (auto i = indexOf(uuid); i < buffUUIDs.size())
+            this->turns[i] = turns;
+    }
+
+    std::vector<uuids::uuid> BuffTimers::tick(int decrement, int threshold)
+    {
+        for (auto &t : turns)
+            t -= decrement;
+        return expired(threshold);
+    }
+
+    std::vector<uuids::uuid> BuffTimers::expired(int threshold) const
+    {
+        std::vector<uuids::uuid> res;
+        for (size_t i = 0; i < turns.size(); i++)
+            if (turns[i] <= threshold)
+                res.push_back(buffUUIDs[i]);
+        return res;
+    }
+
+    size_t BuffTimers::size() const
+    {
+        return buffUUIDs.size();
+    }
+
+    size_t BuffTimers::indexOf(const uuids::uuid &uuid) const
+    {
+        return std::find(buffUUIDs.begin(), buffUUIDs.end(), uuid) - buffUUIDs.begin();
+    }
+
     Buff BuffTemplate::build(int turns)
     {
         std::map<std::string, std::multiset<Modifier>> modifierData;
@@ -62,6 +62,31 @@ namespace FTK
         friend nlohmann::adl_serializer<Buff>;
     };
 
+    // Remaining turns of an entity's buffs, stored as parallel arrays so that ticking and
+    // expiry tests are tight loops over ints instead of walks over the buff set.
+    // Authoritative while the buffs are attached, Buff::getTurns is refreshed from it whenever it changes.
+    class BuffTimers
+    {
+    public:
+        void add(const uuids::uuid &uuid, int turns);
+        void remove(const std::set<uuids::uuid> &marked);
+        void clear();
+
+        int get(const uuids::uuid &uuid) const;
+        void set(const uuids::uuid &uuid, int turns);
+
+        std::vector<uuids::uuid> tick(int decrement = 1, int threshold = 0);
+        std::vector<uuids::uuid> expired(int threshold = 0) const;
+
+        size_t size() const;
+
+    private:
+        size_t indexOf(const uuids::uuid &uuid) const;
+
+        std::vector<uuids::uuid> buffUUIDs;
+        std::vector<int> turns;
+    };
+
     struct BuffTemplate
     {
     public:
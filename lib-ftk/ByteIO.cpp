@@ -0,0 +1,152 @@
+#include "ByteIO.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace FTK
+{
+    ByteReader::ByteReader(const std::vector<uint8_t> &data, size_t offset) : data(data), offset(offset)
+    {
+    }
+
+    unsigned long long ByteReader::readVarint()
+    {
+        unsigned long long v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (offset >= data.size())
+                throw std::invalid_argument("Truncated data");
+            auto b = data[offset++];
+            v |= (unsigned long long)(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        throw std::invalid_argument("Malformed varint");
+    }
+
+    long long ByteReader::readInt()
+    {
+        auto v = readVarint();
+        return (long long)(v >> 1) ^ -(long long)(v & 1);
+    }
+
+    bool ByteReader::readBool()
+    {
+        return readBytes(1)[0];
+    }
+
+    double ByteReader::readDouble()
+    {
+        auto bytes = readBytes(8);
+        double v;
+        std::memcpy(&v, bytes.data(), sizeof(v));
+        return v;
+    }
+
+    uuids::uuid ByteReader::readUUID()
+    {
+        auto bytes = readBytes(16);
+        return uuids::uuid(bytes.begin(), bytes.end());
+    }
+
+    uint32_t ByteReader::readU32()
+    {
+        auto bytes = readBytes(4);
+        return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    }
+
+    std::string ByteReader::readString()
+    {
+        auto bytes = readBytes(readVarint());
+        return std::string(bytes.begin(), bytes.end());
+    }
+
+    Vec2i ByteReader::readPos()
+    {
+        auto x = (int)readInt();
+        auto y = (int)readInt();
+        return Vec2i(x, y);
+    }
+
+    std::vector<uint8_t> ByteReader::readBytes(size_t size)
+    {
+        if (size > data.size() - offset)
+            throw std::invalid_argument("Truncated data");
+        std::vector<uint8_t> bytes(data.begin() + offset, data.begin() + offset + size);
+        offset += size;
+        return bytes;
+    }
+
+    size_t ByteReader::getOffset() const
+    {
+        return offset;
+    }
+
+    bool ByteReader::atEnd() const
+    {
+        return offset >= data.size();
+    }
+
+    ByteWriter::ByteWriter(std::vector<uint8_t> &data) : data(data)
+    {
+    }
+
+    void ByteWriter::writeVarint(unsigned long long v)
+    {
+        while (v >= 0x80)
+        {
+            data.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        data.push_back((uint8_t)v);
+    }
+
+    void ByteWriter::writeInt(long long v)
+    {
+        writeVarint(((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+    }
+
+    void ByteWriter::writeBool(bool v)
+    {
+        data.push_back(v);
+    }
+
+    void ByteWriter::writeDouble(double v)
+    {
+        uint8_t bytes[8];
+        std::memcpy(bytes, &v, sizeof(v));
+        data.insert(data.end(), std::begin(bytes), std::end(bytes));
+    }
+
+    void ByteWriter::writeUUID(const uuids::uuid &v)
+    {
+        auto bytes = v.as_bytes();
+        for (auto b : bytes)
+            data.push_back((uint8_t)b);
+    }
+
+    void ByteWriter::writeU32(uint32_t v)
+    {
+        for (size_t k = 0; k < 4; k++)
+            data.push_back((uint8_t)(v >> (k * 8)));
+    }
+
+    void ByteWriter::writeString(const std::string &v)
+    {
+        writeVarint(v.size());
+        data.insert(data.end(), v.begin(), v.end());
+    }
+
+    void ByteWriter::writePos(const Vec2i &v)
+    {
+        writeInt(v.getX());
+        writeInt(v.getY());
+    }
+
+    void ByteWriter::writeBytes(const std::vector<uint8_t> &v)
+    {
+        writeVarint(v.size());
+        data.insert(data.end(), v.begin(), v.end());
+    }
+} // namespace FTK
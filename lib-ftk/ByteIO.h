@@ -0,0 +1,89 @@
+#ifndef FTK_BYTE_IO_H
+#define FTK_BYTE_IO_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <uuid.h>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    // The binary encoding shared by command logs and save containers: zigzag varint integers, 1-byte bools,
+    // 8-byte doubles, 16-byte uuids, little-endian 4-byte words, length-prefixed strings and byte runs,
+    // positions as two integers and vectors as a count followed by the elements.
+    // Reads past the end throw std::invalid_argument.
+    class ByteReader
+    {
+    public:
+        explicit ByteReader(const std::vector<uint8_t> &data, size_t offset = 0);
+
+        unsigned long long readVarint();
+        long long readInt();
+        bool readBool();
+        double readDouble();
+        uuids::uuid readUUID();
+        uint32_t readU32();
+        std::string readString();
+        Vec2i readPos();
+        std::vector<uint8_t> readBytes(size_t size);
+
+        size_t getOffset() const;
+        bool atEnd() const;
+
+    private:
+        const std::vector<uint8_t> &data;
+        size_t offset;
+    };
+
+    class ByteWriter
+    {
+    public:
+        explicit ByteWriter(std::vector<uint8_t> &data);
+
+        void writeVarint(unsigned long long v);
+        void writeInt(long long v);
+        void writeBool(bool v);
+        void writeDouble(double v);
+        void writeUUID(const uuids::uuid &v);
+        void writeU32(uint32_t v);
+        void writeString(const std::string &v);
+        void writePos(const Vec2i &v);
+        void writeBytes(const std::vector<uint8_t> &v);
+
+        template <class T>
+        void write(const T &v)
+        {
+            if constexpr (std::is_same_v<T, bool>)
+                writeBool(v);
+            else if constexpr (std::is_enum_v<T>)
+                writeInt((long long)v);
+            else if constexpr (std::is_integral_v<T>)
+                writeInt((long long)v);
+            else if constexpr (std::is_floating_point_v<T>)
+                writeDouble(v);
+            else if constexpr (std::is_same_v<T, uuids::uuid>)
+                writeUUID(v);
+            else if constexpr (std::is_same_v<T, Vec2i>)
+                writePos(v);
+            else
+                writeString(v);
+        }
+
+        template <class T>
+        void write(const std::vector<T> &v)
+        {
+            writeVarint(v.size());
+            for (auto &e : v)
+                write(e);
+        }
+
+    private:
+        std::vector<uint8_t> &data;
+    };
+} // namespace FTK
+
+#endif // FTK_BYTE_IO_H
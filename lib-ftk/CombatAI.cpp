@@ -0,0 +1,308 @@
+#include "CombatAI.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "IDSource.h"
+#include "Random.h"
+#include "Registry.h"
+#include "combat.h"
+
+namespace FTK
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct CombatAI::Node
+    {
+        uuids::uuid actor;
+        Choice choice;
+        bool byEnemy = false;
+        size_t visits = 0;
+        double total = 0;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    // both sides as they were when the decision started, fallen or escaped members count as 0 hp
+    struct CombatAI::Roster
+    {
+        std::vector<uuids::uuid> players;
+        std::vector<uuids::uuid> enemies;
+        double playerMaxHP = 0;
+        double enemyMaxHP = 0;
+    };
+
+    static std::vector<CombatAI::Choice> getChoices(CombatSystem &combat)
+    {
+        std::vector<CombatAI::Choice> res;
+        for (auto &actionID : combat.getActionCandidates())
+        {
+            combat.markActionSelected(actionID);
+            auto targets = combat.getTargetCandidates();
+            if (targets.empty() && combat.readyToRollDice())
+                res.push_back({actionID, {}});
+            for (auto &e : targets)
+                res.push_back({actionID, e->uuid});
+        }
+        return res;
+    }
+
+    // runs the battle on to the next choice or to its end
+    static void advance(CombatSystem &combat)
+    {
+        while (true)
+        {
+            switch (combat.getCombatState())
+            {
+            case CombatState::ResolveActions:
+                combat.resolveActions();
+                break;
+            case CombatState::ProcessActions:
+                combat.processActions();
+                break;
+            case CombatState::EndTurn:
+                combat.endTurn();
+                break;
+            case CombatState::EndRound:
+                combat.endRound();
+                break;
+            case CombatState::BeginRound:
+                combat.beginRound();
+                break;
+            case CombatState::BeginTurn:
+                combat.beginTurn();
+                break;
+            default:
+                return;
+            }
+        }
+    }
+
+    static void play(CombatSystem &combat, const CombatAI::Choice &choice)
+    {
+        combat.markActionSelected(choice.actionID);
+        combat.markTargetSelected(choice.target);
+        combat.prepRollDice();
+        combat.rollDice();
+        advance(combat);
+    }
+
+    static double getHPShare(const CombatSystem &combat, const std::vector<uuids::uuid> &side, double maxHP)
+    {
+        if (maxHP <= 0)
+            return 0;
+        double hp = 0;
+        for (auto &uuid : side)
+            if (auto e = combat.getEntityByUUID(uuid))
+                hp += std::max(e->get("hp"), 0.0);
+        return hp / maxHP;
+    }
+
+    // 1 when the enemies won, 0 when the players did
+    double CombatAI::evaluate(const CombatSystem &combat, const Roster &roster)
+    {
+        if (combat.getPlayers().empty())
+            return 1;
+        if (combat.getEnemies().empty())
+            return 0;
+        return 0.5 + 0.5 * (getHPShare(combat, roster.enemies, roster.enemyMaxHP) - getHPShare(combat, roster.players, roster.playerMaxHP));
+    }
+
+    void CombatAI::runIteration(Node &root, const CombatSystem &base, const Roster &roster) const
+    {
+        auto combat = base.fork();
+        std::vector<Node *> path{&root};
+        auto node = &root;
+        bool expanded = false;
+        while (!expanded && combat->getCombatState() == CombatState::ChooseAction)
+        {
+            auto choices = getChoices(*combat);
+            if (choices.empty())
+                break;
+            auto actor = combat->getCurrentEntity();
+            auto findChild = [node, &actor](const Choice &choice) -> Node *
+            {
+                for (auto &child : node->children)
+                    if (child->actor == actor->uuid && child->choice == choice)
+                        return child.get();
+                return nullptr;
+            };
+
+            Node *next = nullptr;
+            for (auto &choice : choices)
+            {
+                if (!findChild(choice))
+                {
+                    node->children.push_back(std::make_unique<Node>());
+                    next = node->children.back().get();
+                    next->actor = actor->uuid;
+                    next->choice = choice;
+                    next->byEnemy = actor->isEnemy();
+                    expanded = true;
+                    break;
+                }
+            }
+            if (!next)
+            {
+                // dice make the tree open-loop: only the children playable from this state compete
+                auto logVisits = std::log((double)std::max<size_t>(node->visits, 1));
+                auto best = -std::numeric_limits<double>::infinity();
+                for (auto &choice : choices)
+                {
+                    auto child = findChild(choice);
+                    auto score = child->total / child->visits + options.exploration * std::sqrt(logVisits / child->visits);
+                    if (score > best)
+                    {
+                        best = score;
+                        next = child;
+                    }
+                }
+            }
+            play(*combat, next->choice);
+            path.push_back(next);
+            node = next;
+        }
+
+        auto random = Random::getInstance();
+        for (size_t i = 0; i < options.rolloutTurns && combat->getCombatState() == CombatState::ChooseAction; i++)
+        {
+            auto choices = getChoices(*combat);
+            if (choices.empty())
+                break;
+            random->shuffle(choices);
+            play(*combat, choices.front());
+        }
+
+        auto reward = evaluate(*combat, roster);
+        for (auto n : path)
+        {
+            n->visits++;
+            n->total += n->byEnemy ? reward : 1 - reward;
+        }
+    }
+
+    bool CombatAI::Choice::operator==(const Choice &other) const
+    {
+        return actionID == other.actionID && target == other.target;
+    }
+
+    CombatAI::CombatAI(const CombatAIOptions &options) : options(options), host(getSearchHost())
+    {
+        for (size_t i = 0; i < std::clamp<size_t>(options.workers, 1, host->getWorkerCount()); i++)
+            sessions.push_back(host->createSession());
+    }
+
+    CombatAI::~CombatAI()
+    {
+        for (auto id : sessions)
+            host->closeSession(id);
+    }
+
+    std::shared_ptr<SessionHost> CombatAI::getSearchHost()
+    {
+        static const auto instance = std::make_shared<SessionHost>();
+        return instance;
+    }
+
+    const CombatAIOptions &CombatAI::getOptions() const
+    {
+        return options;
+    }
+
+    size_t CombatAI::getLastIterationCount() const
+    {
+        return lastIterations;
+    }
+
+    CombatAI::Choice CombatAI::decide(const CombatSystem &combat)
+    {
+        lastIterations = 0;
+        if (combat.getCombatState() != CombatState::ChooseAction || !combat.getCurrentEntity())
+            return {};
+        auto root = combat.fork();
+        auto choices = getChoices(*root);
+        if (choices.empty() || !options.iterations)
+            return {};
+        if (choices.size() == 1)
+            return choices.front();
+
+        Roster roster;
+        for (auto &ep : root->getPlayers())
+        {
+            roster.players.push_back(ep->uuid);
+            roster.playerMaxHP += ep->get("max_hp");
+        }
+        for (auto &en : root->getEnemies())
+        {
+            roster.enemies.push_back(en->uuid);
+            roster.enemyMaxHP += en->get("max_hp");
+        }
+
+        // the tree seeds come from a copy of the game's Random, deciding leaves the game's own sequence as it was,
+        // so a replay that takes the recorded choice instead of searching draws the same numbers afterwards
+        Random seeds(0);
+        seeds.deserialize(Random::getInstance()->serialize());
+        // the snapshot of the deciding turn, the workers' own combats have none pinned
+        auto registry = MainRegistry::getInstance();
+        auto timed = options.timeBudget.count() > 0;
+        auto deadline = Clock::now() + options.timeBudget;
+        auto trees = std::max<size_t>(options.trees, 1);
+        auto share = (options.iterations + trees - 1) / trees;
+
+        struct Result
+        {
+            std::vector<std::unique_ptr<Node>> children;
+            size_t iterations = 0;
+        };
+        std::vector<Result> results(trees);
+        std::vector<std::future<void>> done;
+        for (size_t i = 0; i < trees; i++)
+        {
+            // forked here, cloning reads the entities and must not race with the other workers
+            std::shared_ptr<const CombatSystem> base = root->fork();
+            auto seed = seeds.next();
+            done.push_back(host->submit(sessions[i % sessions.size()], [this, base, seed, registry, timed, deadline, share, &roster, &result = results[i]](GameSession &session)
+                                       {
+                                           MainRegistry::Scope registryScope(registry);
+                                           session.getRandom()->seed(seed);
+                                           session.setIDSource(std::make_shared<SeededIDSource>(seed));
+                                           Node tree;
+                                           while (result.iterations < share && !(result.iterations && timed && Clock::now() >= deadline))
+                                           {
+                                               runIteration(tree, *base, roster);
+                                               result.iterations++;
+                                           }
+                                           result.children = std::move(tree.children); }));
+        }
+        for (auto &d : done)
+            d.wait();
+        for (auto &d : done)
+            d.get();
+
+        auto actor = root->getCurrentEntity()->uuid;
+        Choice res = choices.front();
+        size_t bestVisits = 0;
+        double bestTotal = 0;
+        for (auto &choice : choices)
+        {
+            size_t visits = 0;
+            double total = 0;
+            for (auto &result : results)
+                for (auto &child : result.children)
+                    if (child->actor == actor && child->choice == choice)
+                    {
+                        visits += child->visits;
+                        total += child->total;
+                    }
+            if (visits > bestVisits || (visits == bestVisits && visits && total > bestTotal))
+            {
+                res = choice;
+                bestVisits = visits;
+                bestTotal = total;
+            }
+        }
+        for (auto &result : results)
+            lastIterations += result.iterations;
+        return res;
+    }
+} // namespace FTK
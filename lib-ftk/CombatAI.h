@@ -0,0 +1,80 @@
+#ifndef FTK_COMBAT_AI_H
+#define FTK_COMBAT_AI_H
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <uuid.h>
+
+#include "SessionHost.h"
+
+namespace FTK
+{
+    class CombatSystem;
+
+    struct CombatAIOptions
+    {
+        // wall clock limit of one decision, zero for none
+        std::chrono::milliseconds timeBudget = std::chrono::milliseconds(50);
+        // iterations of one decision, shared between the trees
+        size_t iterations = 512;
+        // independent search trees, spread over the worker sessions
+        size_t trees = 8;
+        // sessions of the shared search pool the trees run on at once, at most its worker count
+        size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        // turns played at random past the search tree before the battle is scored
+        size_t rolloutTurns = 12;
+        double exploration = 1.4;
+    };
+
+    // Chooses skills and targets by Monte Carlo tree search over forked battles.
+    // Each tree is grown in a GameSession of the process-wide search pool, turns of both sides are searched and dice
+    // are rolled anew on every visit. The root statistics of all trees are merged and the most visited
+    // choice wins. A decision ends when the iterations are used up or the time budget runs out.
+    // Trees are seeded from the state of the deciding game's Random without drawing from it, so without a time budget
+    // a decision depends on the game, the iterations and the tree count only. Command logs record every
+    // choice made, replays take those instead of searching again.
+    class CombatAI
+    {
+    public:
+        struct Choice
+        {
+            std::string actionID;
+            uuids::uuid target;
+
+            bool operator==(const Choice &other) const;
+        };
+
+        explicit CombatAI(const CombatAIOptions &options = CombatAIOptions());
+        CombatAI(const CombatAI &other) = delete;
+        ~CombatAI();
+
+        const CombatAIOptions &getOptions() const;
+        size_t getLastIterationCount() const;
+
+        // the choice for the entity whose turn it is, the battle must be choosing an action;
+        // an empty action id when there is nothing to choose from
+        Choice decide(const CombatSystem &combat);
+
+    private:
+        struct Node;
+        struct Roster;
+
+        void runIteration(Node &root, const CombatSystem &base, const Roster &roster) const;
+        static double evaluate(const CombatSystem &combat, const Roster &roster);
+        // one pool of hardware_concurrency workers shared by every CombatAI of the process,
+        // held by each of them so it outlives the last one even at exit
+        static std::shared_ptr<SessionHost> getSearchHost();
+
+        CombatAIOptions options;
+        std::shared_ptr<SessionHost> host;
+        std::vector<SessionHost::SessionID> sessions;
+        size_t lastIterations = 0;
+    };
+} // namespace FTK
+
+#endif // FTK_COMBAT_AI_H
@@ -0,0 +1,512 @@
+#include "CommandLog.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <CRC.h>
+#include <nlohmann/json.hpp>
+
+#include "GameManager.h"
+#include "GameSession.h"
+#include "IDSource.h"
+#include "Random.h"
+#include "combat.h"
+
+namespace FTK
+{
+    static const char LogMagic[6] = {'F', 'T', 'K', 'L', 'O', 'G'};
+    // followed by the version and a zero byte, version 2 added the enemy AI options after the seed
+    static constexpr uint8_t LogVersion = 2;
+
+    static std::shared_ptr<ShopRectEntity> shopArg(ByteReader &r)
+    {
+        auto pos = r.readPos();
+        auto shop = std::dynamic_pointer_cast<ShopRectEntity>(GameManager::getInstance()->getWorld()->getRectEntityAt(pos));
+        if (!shop)
+            throw std::invalid_argument("Malformed command data: no shop at " + std::to_string(pos.getX()) + "," + std::to_string(pos.getY()));
+        return shop;
+    }
+
+    static std::shared_ptr<Player> playerArg(ByteReader &r)
+    {
+        auto uuid = r.readUUID();
+        auto player = GameManager::getInstance()->getWorld()->getPlayerByUUID(uuid);
+        if (!player)
+            throw std::invalid_argument("Malformed command data: no player " + uuids::to_string(uuid));
+        return player;
+    }
+
+    static std::shared_ptr<Enemy> enemyArg(ByteReader &r)
+    {
+        auto uuid = r.readUUID();
+        auto enemy = std::dynamic_pointer_cast<Enemy>(GameManager::getInstance()->getWorld()->getEntityByUUID(uuid));
+        if (!enemy)
+            throw std::invalid_argument("Malformed command data: no enemy " + uuids::to_string(uuid));
+        return enemy;
+    }
+
+    bool Command::operator==(const Command &other) const
+    {
+        return type == other.type && payload == other.payload;
+    }
+
+    CommandLog::Scope::~Scope()
+    {
+        depth()--;
+    }
+
+    void CommandLog::begin(unsigned int seed)
+    {
+        this->seed = seed;
+        commands.clear();
+        finalHashSet = false;
+        if (auto ai = CombatSystem::getInstance()->getEnemyAI())
+            aiOptions = ai->getOptions();
+        else
+            aiOptions.reset();
+        auto previous = reseed(seed);
+        if (!recording)
+            previousIDSource = previous;
+        snapshot = GameManager::getInstance()->toJson().dump();
+        recording = true;
+    }
+
+    void CommandLog::end()
+    {
+        if (!recording)
+            return;
+        recording = false;
+        finalHash = hashState();
+        finalHashSet = true;
+        IDSource::setInstance(previousIDSource);
+        previousIDSource = nullptr;
+    }
+
+    bool CommandLog::isRecording() const
+    {
+        return recording;
+    }
+
+    unsigned int CommandLog::getSeed() const
+    {
+        return seed;
+    }
+
+    const std::string &CommandLog::getSnapshot() const
+    {
+        return snapshot;
+    }
+
+    const std::vector<Command> &CommandLog::getCommands() const
+    {
+        return commands;
+    }
+
+    const std::optional<CombatAIOptions> &CommandLog::getAIOptions() const
+    {
+        return aiOptions;
+    }
+
+    bool CommandLog::hasFinalHash() const
+    {
+        return finalHashSet;
+    }
+
+    uint32_t CommandLog::getFinalHash() const
+    {
+        return finalHash;
+    }
+
+    uint32_t CommandLog::replay() const
+    {
+        GameManager::getInstance()->loadMapFromJson(nlohmann::json::parse(snapshot));
+        auto previous = reseed(seed);
+        std::deque<Command> choices;
+        replayChoices() = &choices;
+        try
+        {
+            for (size_t i = 0; i < commands.size(); i++)
+            {
+                if (commands[i].type == CommandType::EnemyChoice)
+                    continue;
+                // the choices made inside a call are recorded right after it
+                for (auto k = i + 1; k < commands.size() && commands[k].type == CommandType::EnemyChoice; k++)
+                    choices.push_back(commands[k]);
+                apply(commands[i]);
+            }
+        }
+        catch (...)
+        {
+            replayChoices() = nullptr;
+            IDSource::setInstance(previous);
+            throw;
+        }
+        replayChoices() = nullptr;
+        IDSource::setInstance(previous);
+        return hashState();
+    }
+
+    void CommandLog::apply(const Command &command)
+    {
+        auto gameMgr = GameManager::getInstance();
+        auto combatSys = CombatSystem::getInstance();
+        ByteReader r(command.payload);
+        switch (command.type)
+        {
+        case CommandType::BeginRound:
+            gameMgr->beginRound();
+            break;
+        case CommandType::BeginTurn:
+            gameMgr->beginTurn();
+            break;
+        case CommandType::RollAP:
+        {
+            auto uuid = r.readUUID();
+            gameMgr->rollAP(uuid, (int)r.readInt());
+            break;
+        }
+        case CommandType::MovePlayer:
+        {
+            auto uuid = r.readUUID();
+            auto pos = r.readPos();
+            auto retreat = r.readBool();
+            gameMgr->movePlayer(uuid, pos, retreat, r.readBool());
+            break;
+        }
+        case CommandType::MovePlayerTo:
+            gameMgr->movePlayerTo(r.readPos());
+            break;
+        case CommandType::RetreatPlayer:
+            gameMgr->retreatPlayer(r.readUUID());
+            break;
+        case CommandType::EndTurn:
+            gameMgr->endTurn();
+            break;
+        case CommandType::EndRound:
+            gameMgr->endRound();
+            break;
+        case CommandType::EnterShop:
+            gameMgr->enterShop();
+            break;
+        case CommandType::ExitShop:
+            gameMgr->exitShop();
+            break;
+        case CommandType::BeginTeleport:
+            gameMgr->beginTeleport();
+            break;
+        case CommandType::EndTeleport:
+            gameMgr->endTeleport();
+            break;
+        case CommandType::UseItem:
+            gameMgr->useItem(r.readString());
+            break;
+        case CommandType::TriggerBattle:
+        {
+            auto triggerer = r.readUUID();
+            auto pos = r.readPos();
+            auto ambush = r.readBool();
+            gameMgr->triggerBattle(triggerer, pos, ambush, r.readBool());
+            break;
+        }
+        case CommandType::PrepAPRoll:
+            gameMgr->prepAPRoll();
+            break;
+        case CommandType::MarkAPRolled:
+            gameMgr->markAPRolled((size_t)r.readInt());
+            break;
+        case CommandType::MarkInteractionDone:
+            gameMgr->markInteractionDone(r.readBool());
+            break;
+        case CommandType::MarkEntityDead:
+            gameMgr->markEntityDead(r.readUUID());
+            break;
+        case CommandType::MarkPlayerDead:
+            gameMgr->markPlayerDead(r.readUUID());
+            break;
+        case CommandType::RollFocusedDice:
+        {
+            auto uuid = r.readUUID();
+            auto amount = (size_t)r.readInt();
+            auto chance = r.readDouble();
+            auto guarantee = (int)r.readInt();
+            gameMgr->rollFocusedDice(uuid, amount, chance, guarantee, (int)r.readInt());
+            break;
+        }
+        case CommandType::Equip:
+        {
+            auto entityUUID = r.readUUID();
+            gameMgr->equip(entityUUID, r.readUUID());
+            break;
+        }
+        case CommandType::Unequip:
+        {
+            auto entityUUID = r.readUUID();
+            gameMgr->unequip(entityUUID, (EquipmentType)r.readInt());
+            break;
+        }
+        case CommandType::BuyItem:
+        {
+            auto shop = shopArg(r);
+            auto id = r.readString();
+            auto price = (int)r.readInt();
+            shop->buyItem(id, price, (int)r.readInt());
+            break;
+        }
+        case CommandType::BuyEquipment:
+        {
+            auto shop = shopArg(r);
+            auto uuid = r.readUUID();
+            shop->buyEquipment(uuid, (int)r.readInt());
+            break;
+        }
+        case CommandType::BeginBattle:
+        {
+            std::vector<std::shared_ptr<Player>> players(r.readVarint());
+            for (auto &ep : players)
+                ep = playerArg(r);
+            std::vector<std::shared_ptr<Enemy>> enemies(r.readVarint());
+            for (auto &en : enemies)
+                en = enemyArg(r);
+            combatSys->beginBattle(players, enemies, r.readBool());
+            break;
+        }
+        case CommandType::CombatBeginRound:
+            combatSys->beginRound();
+            break;
+        case CommandType::CombatBeginTurn:
+            combatSys->beginTurn();
+            break;
+        case CommandType::ChooseAction:
+            combatSys->chooseAction();
+            break;
+        case CommandType::SelectSkill:
+            combatSys->selectSkill();
+            break;
+        case CommandType::SelectTarget:
+            combatSys->selectTarget();
+            break;
+        case CommandType::RollDice:
+            combatSys->rollDice();
+            break;
+        case CommandType::ResolveActions:
+            combatSys->resolveActions();
+            break;
+        case CommandType::ProcessActions:
+            combatSys->processActions();
+            break;
+        case CommandType::CombatEndTurn:
+            combatSys->endTurn();
+            break;
+        case CommandType::CombatEndRound:
+            combatSys->endRound();
+            break;
+        case CommandType::EndBattle:
+            combatSys->endBattle();
+            break;
+        case CommandType::SetActionSelectionType:
+            combatSys->setActionSelectionType((ActionSelectionType)r.readInt());
+            break;
+        case CommandType::PrepSelectAction:
+            combatSys->prepSelectAction();
+            break;
+        case CommandType::MarkActionSelected:
+            combatSys->markActionSelected(r.readString());
+            break;
+        case CommandType::PrepSelectTarget:
+            combatSys->prepSelectTarget();
+            break;
+        case CommandType::MarkTargetSelected:
+            combatSys->markTargetSelected(r.readUUID());
+            break;
+        case CommandType::ConfirmChoice:
+            combatSys->confirmChoice();
+            break;
+        case CommandType::PrepRollDice:
+            combatSys->prepRollDice();
+            break;
+        case CommandType::MarkDiceRolled:
+            combatSys->markDiceRolled((size_t)r.readInt());
+            break;
+        case CommandType::EnemyChoice:
+            // handed to the call that made it through takeChoice, replay() queues it before applying that call
+            break;
+        default:
+            throw std::invalid_argument("Unknown command type " + std::to_string((int)command.type));
+        }
+    }
+
+    void CommandLog::recordChoice(const std::string &actionID, const uuids::uuid &target)
+    {
+        auto log = getInstance();
+        if (!log->recording)
+            return;
+        Command command{CommandType::EnemyChoice, {}};
+        ByteWriter writer(command.payload);
+        writer.writeString(actionID);
+        writer.writeUUID(target);
+        log->commands.push_back(std::move(command));
+    }
+
+    bool CommandLog::takeChoice(std::string &actionID, uuids::uuid &target)
+    {
+        auto choices = replayChoices();
+        if (!choices || choices->empty())
+            return false;
+        ByteReader r(choices->front().payload);
+        actionID = r.readString();
+        target = r.readUUID();
+        choices->pop_front();
+        return true;
+    }
+
+    std::vector<uint8_t> CommandLog::encode() const
+    {
+        std::vector<uint8_t> data(std::begin(LogMagic), std::end(LogMagic));
+        data.push_back(LogVersion);
+        data.push_back(0);
+        ByteWriter w(data);
+        w.writeU32(seed);
+        w.writeBool(aiOptions.has_value());
+        if (aiOptions)
+        {
+            w.writeInt(aiOptions->timeBudget.count());
+            w.writeVarint(aiOptions->iterations);
+            w.writeVarint(aiOptions->trees);
+            w.writeVarint(aiOptions->workers);
+            w.writeVarint(aiOptions->rolloutTurns);
+            w.writeDouble(aiOptions->exploration);
+        }
+        w.writeString(snapshot);
+        w.writeVarint(commands.size());
+        for (auto &command : commands)
+        {
+            data.push_back((uint8_t)command.type);
+            w.writeBytes(command.payload);
+        }
+        w.writeBool(finalHashSet);
+        w.writeU32(finalHash);
+        return data;
+    }
+
+    std::shared_ptr<CommandLog> CommandLog::decode(const std::vector<uint8_t> &data)
+    {
+        if (data.size() < sizeof(LogMagic) + 2 || std::memcmp(data.data(), LogMagic, sizeof(LogMagic)) || data[sizeof(LogMagic) + 1])
+            throw std::invalid_argument("Not a command log");
+        auto version = data[sizeof(LogMagic)];
+        if (version < 1 || version > LogVersion)
+            throw std::invalid_argument("Unsupported command log version " + std::to_string(version));
+        auto log = std::make_shared<CommandLog>();
+        ByteReader r(data, sizeof(LogMagic) + 2);
+        log->seed = r.readU32();
+        if (version >= 2 && r.readBool())
+        {
+            CombatAIOptions options;
+            options.timeBudget = std::chrono::milliseconds(r.readInt());
+            options.iterations = (size_t)r.readVarint();
+            options.trees = (size_t)r.readVarint();
+            options.workers = (size_t)r.readVarint();
+            options.rolloutTurns = (size_t)r.readVarint();
+            options.exploration = r.readDouble();
+            log->aiOptions = options;
+        }
+        log->snapshot = r.readString();
+        auto count = r.readVarint();
+        for (unsigned long long i = 0; i < count; i++)
+        {
+            Command command;
+            command.type = (CommandType)r.readBytes(1)[0];
+            if (command.type == CommandType::None || command.type >= CommandType::Count)
+                throw std::invalid_argument("Unknown command type " + std::to_string((int)command.type));
+            command.payload = r.readBytes(r.readVarint());
+            log->commands.push_back(std::move(command));
+        }
+        log->finalHashSet = r.readBool();
+        log->finalHash = r.readU32();
+        return log;
+    }
+
+    void CommandLog::save(const std::string &path) const
+    {
+        if (!std::filesystem::exists(path) && std::filesystem::path(path).has_parent_path())
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        auto data = encode();
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write((const char *)data.data(), data.size());
+        ofs.close();
+        if (!ofs)
+            throw std::invalid_argument("Cannot write command log " + path);
+    }
+
+    std::shared_ptr<CommandLog> CommandLog::load(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs)
+            throw std::invalid_argument("Cannot open command log " + path);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        return decode(data);
+    }
+
+    uint32_t CommandLog::hashState()
+    {
+        auto dump = GameManager::getInstance()->toJson().dump();
+        static const auto table = CRC::CRC_32().MakeTable();
+        return CRC::Calculate(dump.data(), dump.size(), table);
+    }
+
+    std::shared_ptr<CommandLog> CommandLog::getInstance()
+    {
+        if (auto session = GameSession::getCurrent())
+            return session->getCommandLog();
+        static const auto instance = std::make_shared<CommandLog>();
+        return instance;
+    }
+
+    void CommandLog::append(const Command &command)
+    {
+        // the GUI re-issues the prep calls every frame until the player acts, one is enough to replay them
+        switch (command.type)
+        {
+        case CommandType::PrepAPRoll:
+        case CommandType::PrepSelectAction:
+        case CommandType::PrepSelectTarget:
+        case CommandType::PrepRollDice:
+            if (!commands.empty() && commands.back() == command)
+                return;
+            break;
+        default:
+            break;
+        }
+        commands.push_back(command);
+    }
+
+    std::shared_ptr<IDSource> CommandLog::reseed(unsigned int seed)
+    {
+        Random::getInstance()->seed(seed);
+        auto previous = IDSource::getInstance();
+        IDSource::setInstance(std::make_shared<SeededIDSource>(seed));
+        return previous;
+    }
+
+    CommandLog *CommandLog::getRecording()
+    {
+        if (depth())
+            return nullptr;
+        auto log = getInstance();
+        return log->recording ? log.get() : nullptr;
+    }
+
+    int &CommandLog::depth()
+    {
+        static thread_local int value = 0;
+        return value;
+    }
+
+    std::deque<Command> *&CommandLog::replayChoices()
+    {
+        static thread_local std::deque<Command> *value = nullptr;
+        return value;
+    }
+} // namespace FTK
@@ -0,0 +1,163 @@
+#ifndef FTK_COMMAND_LOG_H
+#define FTK_COMMAND_LOG_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ByteIO.h"
+#include "CombatAI.h"
+
+namespace FTK
+{
+    class IDSource;
+
+    enum class CommandType : uint8_t
+    {
+        None,
+        // GameManager
+        BeginRound,
+        BeginTurn,
+        RollAP,
+        MovePlayer,
+        MovePlayerTo,
+        RetreatPlayer,
+        EndTurn,
+        EndRound,
+        EnterShop,
+        ExitShop,
+        BeginTeleport,
+        EndTeleport,
+        UseItem,
+        TriggerBattle,
+        PrepAPRoll,
+        MarkAPRolled,
+        MarkInteractionDone,
+        MarkEntityDead,
+        MarkPlayerDead,
+        RollFocusedDice,
+        Equip,
+        Unequip,
+        BuyItem,
+        BuyEquipment,
+        // CombatSystem
+        BeginBattle,
+        CombatBeginRound,
+        CombatBeginTurn,
+        ChooseAction,
+        SelectSkill,
+        SelectTarget,
+        RollDice,
+        ResolveActions,
+        ProcessActions,
+        CombatEndTurn,
+        CombatEndRound,
+        EndBattle,
+        SetActionSelectionType,
+        PrepSelectAction,
+        MarkActionSelected,
+        PrepSelectTarget,
+        MarkTargetSelected,
+        ConfirmChoice,
+        PrepRollDice,
+        MarkDiceRolled,
+        // CombatAI
+        EnemyChoice,
+        Count
+    };
+
+    struct Command
+    {
+        CommandType type = CommandType::None;
+        // the arguments in call order, written by ByteWriter
+        std::vector<uint8_t> payload;
+
+        bool operator==(const Command &other) const;
+    };
+
+    // Records the state-changing GameManager and CombatSystem calls of one game so it can be re-executed.
+    // begin() snapshots the game, then reseeds its Random and IDSource from the log's seed, so a replay that
+    // loads the snapshot and applies the commands in order reaches the same state, uuids included.
+    // end() and the end of replay() put back the IDSource that was installed before.
+    // Only outermost calls are recorded: calls made by another recorded call replay by themselves.
+    // The choices of the enemy AI are the exception, they are recorded after the call that made them and
+    // handed back to it during replay, so a replay never searches and does not depend on the AI's time budget.
+    // The log of the running session is reached through getInstance(), like GameManager.
+    class CommandLog
+    {
+    public:
+        // put at the top of every recorded function, before any state is touched
+        class Scope
+        {
+        public:
+            template <class... Args>
+            explicit Scope(CommandType type, const Args &...args)
+            {
+                if (auto log = getRecording())
+                {
+                    Command command{type, {}};
+                    ByteWriter writer(command.payload);
+                    (writer.write(args), ...);
+                    log->append(command);
+                }
+                depth()++;
+            }
+            Scope(const Scope &other) = delete;
+            ~Scope();
+        };
+
+        void begin(unsigned int seed);
+        void end();
+        bool isRecording() const;
+
+        unsigned int getSeed() const;
+        const std::string &getSnapshot() const;
+        const std::vector<Command> &getCommands() const;
+        // the options of the enemy AI when recording began, none when the enemies chose at random
+        const std::optional<CombatAIOptions> &getAIOptions() const;
+        bool hasFinalHash() const;
+        uint32_t getFinalHash() const;
+
+        // loads the snapshot into the current game and re-executes every command, returns the resulting state hash
+        uint32_t replay() const;
+        static void apply(const Command &command);
+
+        // called by the combat whenever its enemy AI decided, appended to the recording log even inside a recorded call
+        static void recordChoice(const std::string &actionID, const uuids::uuid &target);
+        // the next recorded choice while replaying, false when there is none and the combat decides by itself
+        static bool takeChoice(std::string &actionID, uuids::uuid &target);
+
+        std::vector<uint8_t> encode() const;
+        static std::shared_ptr<CommandLog> decode(const std::vector<uint8_t> &data);
+        void save(const std::string &path) const;
+        static std::shared_ptr<CommandLog> load(const std::string &path);
+
+        // CRC32 of the current game's save document
+        static uint32_t hashState();
+
+        static std::shared_ptr<CommandLog> getInstance();
+
+    private:
+        void append(const Command &command);
+        // installs the seeded IDSource and returns the one it replaced
+        static std::shared_ptr<IDSource> reseed(unsigned int seed);
+
+        static CommandLog *getRecording();
+        static int &depth();
+        static std::deque<Command> *&replayChoices();
+
+        bool recording = false;
+        unsigned int seed = 0;
+        std::shared_ptr<IDSource> previousIDSource;
+        std::optional<CombatAIOptions> aiOptions;
+        std::string snapshot;
+        std::vector<Command> commands;
+        bool finalHashSet = false;
+        uint32_t finalHash = 0;
+    };
+} // namespace FTK
+
+#endif // FTK_COMMAND_LOG_H
@@ -0,0 +1,237 @@
+#include "ComponentTable.h"
+
+#include <stdexcept>
+
+#include "Entity.h"
+
+namespace FTK
+{
+    EntityHandle::EntityHandle(const ComponentTable *table, size_t index) : table(table), index(index)
+    {
+    }
+
+    const uuids::uuid &EntityHandle::getUUID() const
+    {
+        return table->entityUUIDs[index];
+    }
+
+    const Vec2i &EntityHandle::getPos() const
+    {
+        return table->positions[index];
+    }
+
+    double EntityHandle::getHP() const
+    {
+        return table->hp[index];
+    }
+
+    double EntityHandle::getMaxHP() const
+    {
+        return table->maxHP[index];
+    }
+
+    double EntityHandle::getSpeed() const
+    {
+        return table->speed[index];
+    }
+
+    bool EntityHandle::isPlayer() const
+    {
+        return table->flags[index] & ComponentFlag_Player;
+    }
+
+    bool EntityHandle::isDead() const
+    {
+        return table->flags[index] & ComponentFlag_Dead;
+    }
+
+    const std::shared_ptr<Entity> &EntityHandle::get() const
+    {
+        return table->objects[index];
+    }
+
+    Entity *EntityHandle::operator->() const
+    {
+        return table->objects[index].get();
+    }
+
+    size_t EntityHandle::getIndex() const
+    {
+        return index;
+    }
+
+    ComponentTable::~ComponentTable()
+    {
+        clear();
+    }
+
+    void ComponentTable::add(const std::shared_ptr<Entity> &entity, uint8_t flags)
+    {
+        if (contains(entity->uuid))
+            remove(entity->uuid);
+        auto index = objects.size();
+        rows.emplace(entity->uuid, index);
+        entityUUIDs.push_back(entity->uuid);
+        positions.push_back(entity->getPos());
+        hp.push_back(0);
+        maxHP.push_back(0);
+        speed.push_back(0);
+        this->flags.push_back(flags);
+        objects.push_back(entity);
+        insertCell(index);
+        load(index, *entity);
+        entity->componentTable = this;
+    }
+
+    void ComponentTable::remove(const uuids::uuid &uuid)
+    {
+        auto it = rows.find(uuid);
+        if (it == rows.end())
+            return;
+        auto index = it->second;
+        if (objects[index]->componentTable == this)
+            objects[index]->componentTable = nullptr;
+        eraseCell(index);
+        rows.erase(it);
+        // swap-and-pop: only the last row changes its index, so only its row and bucket entries are fixed up
+        if (auto last = objects.size() - 1; index != last)
+            moveRow(last, index);
+        entityUUIDs.pop_back();
+        positions.pop_back();
+        hp.pop_back();
+        maxHP.pop_back();
+        speed.pop_back();
+        flags.pop_back();
+        objects.pop_back();
+    }
+
+    void ComponentTable::clear()
+    {
+        for (auto &e : objects)
+            if (e->componentTable == this)
+                e->componentTable = nullptr;
+        entityUUIDs.clear();
+        positions.clear();
+        hp.clear();
+        maxHP.clear();
+        speed.clear();
+        flags.clear();
+        objects.clear();
+        rows.clear();
+        cells.clear();
+    }
+
+    void ComponentTable::sync(const Entity &entity)
+    {
+        if (auto it = rows.find(entity.uuid); it != rows.end())
+            load(it->second, entity);
+    }
+
+    size_t ComponentTable::size() const
+    {
+        return objects.size();
+    }
+
+    bool ComponentTable::contains(const uuids::uuid &uuid) const
+    {
+        return rows.count(uuid);
+    }
+
+    size_t ComponentTable::indexOf(const uuids::uuid &uuid) const
+    {
+        if (auto it = rows.find(uuid); it != rows.end())
+            return it->second;
+        throw std::invalid_argument("Entity " + uuids::to_string(uuid) + " is not in the component table");
+    }
+
+    EntityHandle ComponentTable::getHandle(size_t index) const
+    {
+        return EntityHandle(this, index);
+    }
+
+    void ComponentTable::queryRadius(const Vec2i &center, int radius, uint8_t mask, uint8_t value, std::vector<EntityHandle> &out) const
+    {
+        out.clear();
+        forEachInRadius(center, radius, mask, value, [&out](const EntityHandle &h)
+                        { out.push_back(h); });
+        auto distance = [&center](const EntityHandle &h)
+        {
+            return std::abs(h.getPos().getX() - center.getX()) + std::abs(h.getPos().getY() - center.getY());
+        };
+        std::sort(out.begin(), out.end(), [&distance](const EntityHandle &a, const EntityHandle &b)
+                  { return std::make_pair(distance(a), a.getIndex()) < std::make_pair(distance(b), b.getIndex()); });
+    }
+
+    void ComponentTable::queryRect(const Vec2i &min, const Vec2i &max, uint8_t mask, uint8_t value, std::vector<EntityHandle> &out) const
+    {
+        out.clear();
+        forEachInRect(min, max, mask, value, [&out](const EntityHandle &h)
+                      { out.push_back(h); });
+        std::sort(out.begin(), out.end(), [](const EntityHandle &a, const EntityHandle &b)
+                  { return a.getIndex() < b.getIndex(); });
+    }
+
+    void ComponentTable::load(size_t index, const Entity &entity)
+    {
+        if (positions[index] != entity.getPos())
+        {
+            eraseCell(index);
+            positions[index] = entity.getPos();
+            insertCell(index);
+        }
+        hp[index] = entity.get("hp");
+        maxHP[index] = entity.get("max_hp");
+        speed[index] = entity.get("speed");
+        if (entity.isDead())
+            flags[index] |= ComponentFlag_Dead;
+        else
+            flags[index] &= ~ComponentFlag_Dead;
+    }
+
+    void ComponentTable::moveRow(size_t from, size_t to)
+    {
+        eraseCell(from);
+        entityUUIDs[to] = entityUUIDs[from];
+        positions[to] = positions[from];
+        hp[to] = hp[from];
+        maxHP[to] = maxHP[from];
+        speed[to] = speed[from];
+        flags[to] = flags[from];
+        objects[to] = std::move(objects[from]);
+        rows[entityUUIDs[to]] = to;
+        insertCell(to);
+    }
+
+    void ComponentTable::insertCell(size_t index)
+    {
+        auto &cell = cells[cellKey(positions[index])];
+        cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+    }
+
+    void ComponentTable::eraseCell(size_t index)
+    {
+        auto it = cells.find(cellKey(positions[index]));
+        if (it == cells.end())
+            return;
+        auto &cell = it->second;
+        if (auto pos = std::lower_bound(cell.begin(), cell.end(), index); pos != cell.end() && *pos == index)
+            cell.erase(pos);
+        if (cell.empty())
+            cells.erase(it);
+    }
+
+    int ComponentTable::cellCoord(int v)
+    {
+        return v >= 0 ? v / CellSize : (v - CellSize + 1) / CellSize;
+    }
+
+    int64_t ComponentTable::cellKey(int cx, int cy)
+    {
+        return (int64_t)((uint64_t)(uint32_t)cx << 32 | (uint32_t)cy);
+    }
+
+    int64_t ComponentTable::cellKey(const Vec2i &pos)
+    {
+        return cellKey(cellCoord(pos.getX()), cellCoord(pos.getY()));
+    }
+} // namespace FTK
@@ -0,0 +1,146 @@
+#ifndef FTK_COMPONENT_TABLE_H
+#define FTK_COMPONENT_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <uuid.h>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    class Entity;
+    class ComponentTable;
+
+    enum ComponentFlag : uint8_t
+    {
+        ComponentFlag_None = 0,
+        ComponentFlag_Player = 1 << 0,
+        ComponentFlag_Dead = 1 << 1
+    };
+
+    // Read-only view of one row of a ComponentTable, the full Entity API is reachable through operator->.
+    // Handles are invalidated when rows are added to or removed from the table.
+    class EntityHandle
+    {
+    public:
+        EntityHandle(const ComponentTable *table, size_t index);
+
+        const uuids::uuid &getUUID() const;
+        const Vec2i &getPos() const;
+        double getHP() const;
+        double getMaxHP() const;
+        double getSpeed() const;
+        bool isPlayer() const;
+        bool isDead() const;
+
+        const std::shared_ptr<Entity> &get() const;
+        Entity *operator->() const;
+
+        size_t getIndex() const;
+
+    private:
+        const ComponentTable *table;
+        size_t index;
+    };
+
+    // Packed copies of the per-entity data that world-wide queries scan (position, hp, speed, flags),
+    // one array per component so a query only touches the arrays it needs.
+    // Rows are kept up to date by the entities themselves: a bound entity pushes its row on every
+    // position or value change. An entity is bound to the table it was most recently added to.
+    // Rows are also bucketed by position on a coarse grid so region queries only visit nearby rows;
+    // each bucket keeps its rows in ascending order, so forEachAt reports rows in row order.
+    // Removing a row moves the last row into its place, so row order is insertion order only until
+    // the first removal; it stays deterministic for the same sequence of adds and removes.
+    class ComponentTable
+    {
+    public:
+        ComponentTable() = default;
+        ComponentTable(const ComponentTable &other) = delete;
+        ~ComponentTable();
+
+        void add(const std::shared_ptr<Entity> &entity, uint8_t flags = ComponentFlag_None);
+        void remove(const uuids::uuid &uuid);
+        void clear();
+
+        void sync(const Entity &entity);
+
+        size_t size() const;
+        bool contains(const uuids::uuid &uuid) const;
+        size_t indexOf(const uuids::uuid &uuid) const;
+        EntityHandle getHandle(size_t index) const;
+
+        template <class Func>
+        void forEachAt(const Vec2i &pos, uint8_t mask, uint8_t value, Func func) const
+        {
+            if (auto it = cells.find(cellKey(pos)); it != cells.end())
+                for (auto i : it->second)
+                    if (positions[i] == pos && (flags[i] & mask) == value)
+                        func(EntityHandle(this, i));
+        }
+
+        // visits the rows inside the inclusive rectangle [min, max] bucket by bucket
+        template <class Func>
+        void forEachInRect(const Vec2i &min, const Vec2i &max, uint8_t mask, uint8_t value, Func func) const
+        {
+            for (int cy = cellCoord(min.getY()); cy <= cellCoord(max.getY()); cy++)
+                for (int cx = cellCoord(min.getX()); cx <= cellCoord(max.getX()); cx++)
+                {
+                    auto it = cells.find(cellKey(cx, cy));
+                    if (it == cells.end())
+                        continue;
+                    for (auto i : it->second)
+                    {
+                        auto &pos = positions[i];
+                        if (pos.getX() >= min.getX() && pos.getX() <= max.getX() && pos.getY() >= min.getY() && pos.getY() <= max.getY() && (flags[i] & mask) == value)
+                            func(EntityHandle(this, i));
+                    }
+                }
+        }
+
+        template <class Func>
+        void forEachInRadius(const Vec2i &center, int radius, uint8_t mask, uint8_t value, Func func) const
+        {
+            forEachInRect(center - Vec2i(radius, radius), center + Vec2i(radius, radius), mask, value, [&](const EntityHandle &h)
+                          {
+                              if (std::abs(h.getPos().getX() - center.getX()) + std::abs(h.getPos().getY() - center.getY()) <= radius)
+                                  func(h); });
+        }
+
+        // both fill `out` after clearing it, so a reused buffer makes them allocation-free
+        // queryRadius orders by Manhattan distance, then by row; queryRect by row
+        void queryRadius(const Vec2i &center, int radius, uint8_t mask, uint8_t value, std::vector<EntityHandle> &out) const;
+        void queryRect(const Vec2i &min, const Vec2i &max, uint8_t mask, uint8_t value, std::vector<EntityHandle> &out) const;
+
+        static constexpr int CellSize = 8;
+
+        std::vector<uuids::uuid> entityUUIDs;
+        std::vector<Vec2i> positions;
+        std::vector<double> hp;
+        std::vector<double> maxHP;
+        std::vector<double> speed;
+        std::vector<uint8_t> flags;
+        std::vector<std::shared_ptr<Entity>> objects;
+
+    private:
+        void load(size_t index, const Entity &entity);
+        void moveRow(size_t from, size_t to);
+
+        void insertCell(size_t index);
+        void eraseCell(size_t index);
+
+        static int cellCoord(int v);
+        static int64_t cellKey(int cx, int cy);
+        static int64_t cellKey(const Vec2i &pos);
+
+        std::unordered_map<uuids::uuid, size_t> rows;
+        std::unordered_map<int64_t, std::vector<size_t>> cells;
+    };
+} // namespace FTK
+
+#endif // FTK_COMPONENT_TABLE_H
@@ -1,6 +1,6 @@
 #include "Dice.h"
 
-#include <effolkronium/random.hpp>
+#include "Random.h"
 
 namespace FTK
 {
@@ -23,7 +23,7 @@ namespace FTK
 
     bool Dice::roll() const
     {
-        return effolkronium::random_static::get<bool>(rollChance);
+        return Random::getInstance()->chance(rollChance);
     }
 
     void Dice::markAlwaysSuccess()
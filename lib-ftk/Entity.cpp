@@ -1,7 +1,11 @@
 #include "Entity.h"
 
 #include "defs.h"
+#include "ComponentTable.h"
+#include "EventBus.h"
+#include "IDSource.h"
 #include "Registry.h"
+#include "utils.h"
 
 static std::string AttrPattern("attr.");
 static std::string StatPattern("stat.");
@@ -66,14 +70,57 @@ namespace FTK
     {
     }
 
-    Entity::Entity(const Entity &other) : Entity(other.uuid, other.id, other.name, other.attributes, other.stats, other.pos, other.prevPos, other.skillCD, other.buffs, other.equipments)
+    Entity::ModifierTransaction::ModifierTransaction(Entity &entity) : entity(entity), active(true)
     {
+        entity.modifierTransactionDepth++;
+    }
+
+    Entity::ModifierTransaction::~ModifierTransaction()
+    {
+        // only reached while active when an exception is unwinding the transaction, the changes queued
+        // before it are still applied but nothing may be thrown from here
+        if (!active)
+            return;
+        active = false;
+        if (--entity.modifierTransactionDepth == 0)
+        {
+            try
+            {
+                entity.commitModifiers();
+            }
+            catch (...)
+            {
+            }
+        }
+    }
+
+    void Entity::ModifierTransaction::commit()
+    {
+        if (!active)
+            return;
+        active = false;
+        if (--entity.modifierTransactionDepth == 0)
+            entity.commitModifiers();
+    }
+
+    Entity::Entity(const Entity &other) : Entity(other.uuid, other.id, other.name, other.attributes, other.stats, other.pos, other.prevPos, {}, other.viewBuffs(), other.equipments)
+    {
+        activeSkillSlots = other.activeSkillSlots;
+        passiveSkillSlots = other.passiveSkillSlots;
+        defaultDamageType = other.defaultDamageType;
+        buffTimers = other.buffTimers;
+        revision = other.revision;
     }
 
     Entity::~Entity()
     {
     }
 
+    std::shared_ptr<Entity> Entity::clone() const
+    {
+        return std::make_shared<Entity>(*this);
+    }
+
     double Entity::operator[](const std::string &key) const
     {
         return get(key);
@@ -96,24 +143,25 @@ namespace FTK
 
     std::map<std::string, int> Entity::getSkillCD() const
     {
-        return skillCD;
+        auto res = getActiveSkillCD();
+        for (auto &slot : passiveSkillSlots)
+            res[slot.id] = slot.cd;
+        return res;
     }
 
     std::map<std::string, int> Entity::getActiveSkillCD() const
     {
         std::map<std::string, int> res;
-        for (auto p : skillCD)
-            if (p.first._Starts_with("active"))
-                res[p.first] = p.second;
+        for (auto &slot : activeSkillSlots)
+            res[slot.id] = slot.cd;
         return res;
     }
 
     std::map<std::string, int> Entity::getPassiveSkillCD() const
     {
         std::map<std::string, int> res;
-        for (auto p : skillCD)
-            if (p.first._Starts_with("passive"))
-                res[p.first] = p.second;
+        for (auto &slot : passiveSkillSlots)
+            res[slot.id] = slot.cd;
         return res;
     }
 
@@ -127,6 +175,36 @@ namespace FTK
         return equipments;
     }
 
+    const std::vector<Entity::SkillSlot> &Entity::viewActiveSkills() const
+    {
+        return activeSkillSlots;
+    }
+
+    const std::vector<Entity::SkillSlot> &Entity::viewPassiveSkills() const
+    {
+        return passiveSkillSlots;
+    }
+
+    const std::multiset<Buff> &Entity::viewBuffs() const
+    {
+        return buffs;
+    }
+
+    const std::map<EquipmentType, std::optional<Equipment>> &Entity::viewEquipments() const
+    {
+        return equipments;
+    }
+
+    const std::vector<Entity::Attribute> &Entity::viewAttributes() const
+    {
+        return attributes;
+    }
+
+    const std::vector<Entity::Stat> &Entity::viewStats() const
+    {
+        return stats;
+    }
+
     double Entity::get(const std::string &key) const
     {
         if (auto it = std::find_if(attributes.begin(), attributes.end(), [&key](const Attribute &attr)
@@ -150,6 +228,11 @@ namespace FTK
         return getAsInt("hp") <= 0;
     }
 
+    uint64_t Entity::getRevision() const
+    {
+        return revision;
+    }
+
     int Entity::getWeaponDiceRoll() const
     {
         if (equipments.at(EquipmentType::Weapon))
@@ -157,17 +240,26 @@ namespace FTK
         return 1;
     }
 
-    Math::Context Entity::getMathContext(const std::string &key, const Math::Context &base) const
-    {
-        Math::Context res = base;
-        res[key] = Math::Context();
-        for (auto a : attributes)
-            res[key][a.name] = a.get();
-        for (auto s : stats)
-            res[key][s.name] = s.get();
-        res[key]["atk"] = getDamageType() == DamageType::Physical ? get("p_atk") : getDamageType() == DamageType::Magical ? get("m_atk")
-                                                                                                                          : 0;
-        return res;
+    void Entity::bindMathContext(const std::string &key, Math::Bindings &bindings) const
+    {
+        bindings.bind(key, [key, weak = weak_from_this()](const std::string &field) -> cparse::packToken
+                      {
+                          auto self = weak.lock();
+                          if (!self)
+                              throw std::invalid_argument("The entity bound to " + key + " no longer exists");
+                          auto &stats = self->stats;
+                          auto &attributes = self->attributes;
+                          if (field == "atk")
+                              return self->getDamageType() == DamageType::Physical ? self->get("p_atk") : self->getDamageType() == DamageType::Magical ? self->get("m_atk")
+                                                                                                                                                      : 0;
+                          // stats shadow attributes of the same name
+                          for (auto &s : stats)
+                              if (s.name == field)
+                                  return s.get();
+                          for (auto &a : attributes)
+                              if (a.name == field)
+                                  return a.get();
+                          return cparse::packToken::None(); });
     }
 
     bool Entity::isEnemy() const
@@ -182,23 +274,34 @@ namespace FTK
 
     void Entity::setSkillCD(const std::string &skillID, int newCD)
     {
-        if (skillCD.count(skillID))
-            skillCD[skillID] = newCD;
+        if (auto slot = findSkill(skillID))
+        {
+            slot->cd = newCD;
+            touch();
+        }
     }
 
     void Entity::resetSkillCD(const std::string &skillID)
     {
-        if (skillID._Starts_with("active"))
-            setSkillCD(skillID, MainRegistry::getInstance()->activeSkills->get(skillID).baseCooldown);
-        if (skillID._Starts_with("passive"))
-            setSkillCD(skillID, MainRegistry::getInstance()->passiveSkills->get(skillID).baseCooldown);
+        auto slot = findSkill(skillID);
+        if (!slot)
+            return;
+        if (slot->kind == SkillKind::Active)
+            slot->cd = MainRegistry::getInstance()->activeSkills->getByHandle(slot->handle).baseCooldown;
+        else
+            slot->cd = MainRegistry::getInstance()->passiveSkills->getByHandle(slot->handle).baseCooldown;
+        touch();
     }
 
     void Entity::updateSkillCD()
     {
-        for (auto &p : skillCD)
-            if (p.second > 0)
-                p.second--;
+        for (auto &slot : activeSkillSlots)
+            if (slot.cd > 0)
+                slot.cd--;
+        for (auto &slot : passiveSkillSlots)
+            if (slot.cd > 0)
+                slot.cd--;
+        touch();
     }
 
     void Entity::addBuff(const Buff &buff)
@@ -208,13 +311,16 @@ namespace FTK
                                    { return buff == b; });
             it != buffs.end())
         {
-            if (it->getTurns() <= buff.getTurns())
+            if (buffTimers.get(it->uuid) <= buff.getTurns())
             {
+                buffTimers.set(it->uuid, buff.getTurns());
                 it->setTurns(buff.getTurns());
+                touch();
                 return;
             }
         }
 
+        ModifierTransaction transaction(*this);
         if (auto it = buffs.begin(); it != buffs.end())
         {
             while (it != buffs.end())
@@ -232,7 +338,7 @@ namespace FTK
         auto toBeInserted = buff;
         for (auto p : toBeInserted.getModifierData())
         {
-            if (p.first._Starts_with(AttrPattern))
+            if (startsWith(p.first, AttrPattern))
             {
                 auto realPath = p.first.substr(AttrPattern.size());
                 for (auto mod : p.second)
@@ -241,7 +347,7 @@ namespace FTK
                     toBeInserted.markAttached(p.first, mod.uuid);
                 }
             }
-            else if (p.first._Starts_with(StatPattern))
+            else if (startsWith(p.first, StatPattern))
             {
                 auto realPath = p.first.substr(AttrPattern.size());
                 for (auto mod : p.second)
@@ -252,73 +358,74 @@ namespace FTK
             }
         }
         buffs.insert(toBeInserted);
-        updateValues();
+        buffTimers.add(toBeInserted.uuid, toBeInserted.getTurns());
+        EventBus::getInstance()->publish(BuffAddedEvent{uuid, toBeInserted.uuid, toBeInserted.id});
+        transaction.commit();
     }
 
     void Entity::removeBuff(const uuids::uuid &buffUUID)
     {
-        if (auto it = std::find_if(buffs.begin(), buffs.end(), [buffUUID](Buff b)
-                                   { return b.uuid == buffUUID; });
-            it != buffs.end())
+        removeBuffs({buffUUID});
+    }
+
+    void Entity::removeBuffs(const std::set<uuids::uuid> &buffUUIDs)
+    {
+        // nothing to remove means no commit, so no stat change is published and the revision stays
+        if (std::none_of(buffs.begin(), buffs.end(), [&buffUUIDs](const Buff &buff)
+                         { return buffUUIDs.count(buff.uuid); }))
+            return;
+        ModifierTransaction transaction(*this);
+        auto it = buffs.begin();
+        while (it != buffs.end())
         {
+            if (!buffUUIDs.count(it->uuid))
+            {
+                it++;
+                continue;
+            }
             auto modsToRemove = it->getAttachedModifiers();
 
             for (auto p : modsToRemove)
             {
-                if (p.first._Starts_with(AttrPattern))
+                if (startsWith(p.first, AttrPattern))
                 {
                     auto realPath = p.first.substr(AttrPattern.size());
                     for (auto modUUID : p.second)
                         removeModifierFromAttr(realPath, modUUID);
                 }
-                else if (p.first._Starts_with(StatPattern))
+                else if (startsWith(p.first, StatPattern))
                 {
                     auto realPath = p.first.substr(AttrPattern.size());
                     for (auto modUUID : p.second)
                         removeModifierFromStat(realPath, modUUID);
                 }
             }
-            buffs.erase(it);
+            EventBus::getInstance()->publish(BuffRemovedEvent{uuid, it->uuid});
+            it = buffs.erase(it);
         }
-        updateValues();
+        buffTimers.remove(buffUUIDs);
+        transaction.commit();
     }
 
     void Entity::clearBuffs()
     {
-        std::vector<uuids::uuid> markedRemoved;
-        for (auto b : buffs)
-            markedRemoved.push_back(b.uuid);
-        for (auto uuid : markedRemoved)
-            removeBuff(uuid);
+        std::set<uuids::uuid> markedRemoved;
+        for (auto &b : buffs)
+            markedRemoved.insert(b.uuid);
+        removeBuffs(markedRemoved);
     }
 
     void Entity::checkBuffs(int threshold)
     {
-        std::vector<uuids::uuid> markedRemoved;
-        if (auto it = buffs.begin(); it != buffs.end())
-        {
-            while (it != buffs.end())
-            {
-                if (it->expired(threshold))
-                    markedRemoved.push_back(it->uuid);
-                it++;
-            }
-        }
-        for (auto uuid : markedRemoved)
-            removeBuff(uuid);
+        auto expired = buffTimers.expired(threshold);
+        removeBuffs({expired.begin(), expired.end()});
     }
 
     void Entity::updateBuffs()
     {
-        if (auto it = buffs.begin(); it != buffs.end())
-        {
-            while (it != buffs.end())
-            {
-                it->decTurns();
-                it++;
-            }
-        }
-        checkBuffs();
+        auto expired = buffTimers.tick();
+        syncBuffTurns();
+        removeBuffs({expired.begin(), expired.end()});
     }
 
     void Entity::addEquipment(const std::optional<Equipment> &equipment)
@@ -328,10 +435,11 @@ namespace FTK
         auto equipData = MainRegistry::getInstance()->equipmentTemplates->get(equipment->id);
         if (equipments.at(equipData.equipmentType))
             throw std::invalid_argument("Already has an equipment of the same type");
+        ModifierTransaction transaction(*this);
         auto toBeEquipped = *equipment;
         for (auto p : toBeEquipped.getModifierData())
         {
-            if (p.first._Starts_with(AttrPattern))
+            if (startsWith(p.first, AttrPattern))
             {
                 auto realPath = p.first.substr(AttrPattern.size());
                 for (auto mod : p.second)
@@ -340,7 +448,7 @@ namespace FTK
                     toBeEquipped.markModAttached(p.first, mod.uuid);
                 }
             }
-            else if (p.first._Starts_with(StatPattern))
+            else if (startsWith(p.first, StatPattern))
             {
                 auto realPath = p.first.substr(AttrPattern.size());
                 for (auto mod : p.second)
@@ -353,7 +461,7 @@ namespace FTK
         addSkills(equipData.skills);
         equipments.erase(equipData.equipmentType);
         equipments.emplace(equipData.equipmentType, toBeEquipped);
-        updateValues();
+        transaction.commit();
     }
 
     std::optional<Equipment> Entity::removeEquipment(EquipmentType slot)
@@ -361,10 +469,11 @@ namespace FTK
         auto res = equipments.at(slot);
         if (res)
         {
+            ModifierTransaction transaction(*this);
             auto modsToRemove = res->getAttachedModifiers();
             for (auto p : modsToRemove)
             {
-                if (p.first._Starts_with(AttrPattern))
+                if (startsWith(p.first, AttrPattern))
                 {
                     auto realPath = p.first.substr(AttrPattern.size());
                     for (auto modUUID : p.second)
@@ -373,7 +482,7 @@ namespace FTK
                         res->markModDetached(p.first, modUUID);
                     }
                 }
-                else if (p.first._Starts_with(StatPattern))
+                else if (startsWith(p.first, StatPattern))
                 {
                     auto realPath = p.first.substr(AttrPattern.size());
                     for (auto modUUID : p.second)
@@ -385,7 +494,7 @@ namespace FTK
             }
             equipments.at(slot).reset();
             removeSkills(MainRegistry::getInstance()->equipmentTemplates->get(res->id).skills);
-            updateValues();
+            transaction.commit();
         }
         return res;
     }
@@ -418,17 +527,24 @@ namespace FTK
 
     void Entity::setPos(const Vec2i &newPos, bool retreat)
     {
+        auto from = pos;
         if (!retreat)
             prevPos = pos;
         pos = newPos;
+        touch();
+        if (componentTable)
+            componentTable->sync(*this);
+        EventBus::getInstance()->publish(EntityMovedEvent{uuid, from, newPos});
     }
 
-    Entity::Entity(const std::string &id, const std::string &name, const Vec2i &pos) : Entity(uuids::uuid_system_generator{}(), id, name, {}, {}, pos, pos, {}, {}, {})
+    Entity::Entity(const std::string &id, const std::string &name, const Vec2i &pos) : Entity(IDSource::generate(), id, name, {}, {}, pos, pos, {}, {}, {})
     {
     }
 
-    Entity::Entity(const uuids::uuid uuid, const std::string &id, const std::string &name, const std::vector<Attribute> &attributes, const std::vector<Stat> &stats, const Vec2i &pos, const Vec2i &prevPos, const std::map<std::string, int> &skillCD, const std::multiset<Buff> &buffs, const std::map<EquipmentType, std::optional<Equipment>> &equipments) : uuid(uuid), id(id), name(name), attributes(attributes), stats(stats), pos(pos), prevPos(prevPos), skillCD(skillCD), buffs(buffs), equipments(equipments)
+    Entity::Entity(const uuids::uuid uuid, const std::string &id, const std::string &name, const std::vector<Attribute> &attributes, const std::vector<Stat> &stats, const Vec2i &pos, const Vec2i &prevPos, const std::map<std::string, int> &skillCD, const std::multiset<Buff> &buffs, const std::map<EquipmentType, std::optional<Equipment>> &equipments) : uuid(uuid), id(id), name(name), attributes(attributes), stats(stats), pos(pos), prevPos(prevPos), buffs(buffs), equipments(equipments), revision(nextRevision())
     {
+        for (auto &b : buffs)
+            buffTimers.add(b.uuid, b.getTurns());
         for (auto attr : GeneralAttributeDefs)
             createAttributeIfMissing(attr.name, attr.defaultValue);
         createStatIfMissing("hp", get("max_hp"));
@@ -438,7 +554,9 @@ namespace FTK
         this->equipments.try_emplace(EquipmentType::Armor);
         this->equipments.try_emplace(EquipmentType::Accessory);
 
-        this->skillCD.try_emplace("active:basic_attack", 0);
+        for (auto &p : skillCD)
+            addSkill(p.first, p.second);
+        addSkill("active:basic_attack");
     }
 
     Entity::Attribute &Entity::findAttr(const std::string &key)
@@ -469,6 +587,7 @@ namespace FTK
 
     void Entity::initEquipments()
     {
+        ModifierTransaction transaction(*this);
         auto equipList = MainRegistry::getInstance()->equipmentTemplates;
         std::vector<std::string> tmp;
         for (auto &p : equipments)
@@ -480,28 +599,79 @@ namespace FTK
 
         for (auto e : tmp)
             addEquipment(equipList->get(e).build());
+        transaction.commit();
     }
 
     void Entity::initBuffs()
     {
+        ModifierTransaction transaction(*this);
         auto buffList = MainRegistry::getInstance()->buffTemplates;
         std::vector<std::pair<std::string, int>> tmp;
-        for (auto buff : buffs)
-            tmp.push_back({buff.id, buff.getTurns()});
+        for (auto &buff : buffs)
+            tmp.push_back({buff.id, buffTimers.get(buff.uuid)});
         clearBuffs();
         for (auto p : tmp)
             addBuff(buffList->get(p.first).build(p.second));
+        transaction.commit();
     }
 
     void Entity::updateValues()
     {
         _set("hp", std::max(0.0, std::min(get("max_hp"), get("hp"))));
+        touch();
+        if (componentTable)
+            componentTable->sync(*this);
+        EventBus::getInstance()->publish(StatChangedEvent{uuid});
+    }
+
+    void Entity::touch()
+    {
+        revision = nextRevision();
+    }
+
+    std::vector<Entity::SkillSlot> &Entity::getSkillSlots(SkillKind kind)
+    {
+        return kind == SkillKind::Active ? activeSkillSlots : passiveSkillSlots;
+    }
+
+    Entity::SkillSlot *Entity::findSkill(const std::string &skillID)
+    {
+        for (auto kind : {SkillKind::Active, SkillKind::Passive})
+        {
+            auto &slots = getSkillSlots(kind);
+            if (auto it = std::find_if(slots.begin(), slots.end(), [&skillID](const SkillSlot &slot)
+                                       { return slot.id == skillID; });
+                it != slots.end())
+                return &*it;
+        }
+        return nullptr;
+    }
+
+    void Entity::addSkill(const std::string &skillID, int cd)
+    {
+        // the kind comes from the registry that defines the skill, it is kept with the handle from then on
+        auto registry = MainRegistry::getInstance();
+        SkillKind kind;
+        if (registry->activeSkills->contains(skillID))
+            kind = SkillKind::Active;
+        else if (registry->passiveSkills->contains(skillID))
+            kind = SkillKind::Passive;
+        else
+            throw std::invalid_argument("Unknown skill " + skillID);
+        auto &slots = getSkillSlots(kind);
+        // slots stay sorted by id so skills are listed and triggered in the same order as before
+        auto it = std::lower_bound(slots.begin(), slots.end(), skillID, [](const SkillSlot &slot, const std::string &id)
+                                   { return slot.id < id; });
+        if (it != slots.end() && it->id == skillID)
+            return;
+        auto handle = kind == SkillKind::Active ? registry->activeSkills->getHandle(skillID) : registry->passiveSkills->getHandle(skillID);
+        slots.insert(it, SkillSlot{kind, handle, skillID, cd});
     }
 
     void Entity::addSkills(const std::vector<std::string> &skillIDs)
     {
         for (auto s : skillIDs)
-            skillCD.try_emplace(s, 0);
+            addSkill(s);
     }
 
     void Entity::removeSkills(const std::vector<std::string> &skillIDs)
@@ -514,12 +684,23 @@ namespace FTK
                     allocatedSkills.insert(s);
         for (auto s : skillIDs)
             if (!allocatedSkills.count(s))
-                skillCD.erase(s);
+                for (auto kind : {SkillKind::Active, SkillKind::Passive})
+                {
+                    auto &slots = getSkillSlots(kind);
+                    slots.erase(std::remove_if(slots.begin(), slots.end(), [&s](const SkillSlot &slot)
+                                               { return slot.id == s; }),
+                                slots.end());
+                }
     }
 
     void Entity::addModifierToAttr(const std::string &key, const Modifier &mod)
     {
         auto &attr = findAttr(key);
+        if (modifierTransactionDepth)
+        {
+            pendingAttrModifiers[key].added.emplace(mod.uuid, mod);
+            return;
+        }
         attr.addModifier(mod);
         updateValues();
     }
@@ -527,6 +708,13 @@ namespace FTK
     void Entity::removeModifierFromAttr(const std::string &key, const uuids::uuid modUUID)
     {
         auto &attr = findAttr(key);
+        if (modifierTransactionDepth)
+        {
+            auto &pending = pendingAttrModifiers[key];
+            if (!pending.added.erase(modUUID))
+                pending.removed.push_back(modUUID);
+            return;
+        }
         attr.removeModifier(modUUID);
         updateValues();
     }
@@ -534,6 +722,11 @@ namespace FTK
     void Entity::addModifierToStat(const std::string &key, const Modifier &mod)
     {
         auto &stat = findStat(key);
+        if (modifierTransactionDepth)
+        {
+            pendingStatModifiers[key].added.emplace(mod.uuid, mod);
+            return;
+        }
         stat.addModifier(mod);
         updateValues();
     }
@@ -541,10 +734,45 @@ namespace FTK
     void Entity::removeModifierFromStat(const std::string &key, const uuids::uuid modUUID)
     {
         auto &stat = findStat(key);
+        if (modifierTransactionDepth)
+        {
+            auto &pending = pendingStatModifiers[key];
+            if (!pending.added.erase(modUUID))
+                pending.removed.push_back(modUUID);
+            return;
+        }
         stat.removeModifier(modUUID);
         updateValues();
     }
 
+    void Entity::syncBuffTurns()
+    {
+        for (auto &b : buffs)
+            b.setTurns(buffTimers.get(b.uuid));
+    }
+
+    void Entity::commitModifiers()
+    {
+        auto flatten = [](const PendingModifiers &pending)
+        {
+            std::vector<Modifier> res;
+            res.reserve(pending.added.size());
+            for (auto &p : pending.added)
+                res.push_back(p.second);
+            return res;
+        };
+        // taken out first so a commit that throws does not leave them to be applied again
+        auto attrModifiers = std::move(pendingAttrModifiers);
+        auto statModifiers = std::move(pendingStatModifiers);
+        pendingAttrModifiers.clear();
+        pendingStatModifiers.clear();
+        for (auto &p : attrModifiers)
+            findAttr(p.first).updateModifiers(flatten(p.second), p.second.removed);
+        for (auto &p : statModifiers)
+            findStat(p.first).updateModifiers(flatten(p.second), p.second.removed);
+        updateValues();
+    }
+
     std::string Entity::getSerialType() const
     {
         return "entity";
@@ -567,8 +795,14 @@ namespace FTK
             stats.push_back(Stat(key, defaultValue));
     }
 
-    Player::Player(const Player &other) : Player(other.uuid, other.id, other.name, other.attributes, other.stats, other.pos, other.prevPos, other.skillCD, other.buffs, other.equipments)
+    // the entity copy takes the skill slots as they are, nothing is looked up in the registry again
+    Player::Player(const Player &other) : Entity(other)
+    {
+    }
+
+    std::shared_ptr<Entity> Player::clone() const
     {
+        return std::make_shared<Player>(*this);
     }
 
     bool Player::isPlayer() const
@@ -594,9 +828,9 @@ namespace FTK
         createStatIfMissing("max_ap", 0);
         createStatIfMissing("ap", 0);
 
-        skillCD.try_emplace("active:flee", 0);
-        skillCD.try_emplace("active:dummy_buff", 0);
-        skillCD.try_emplace("active:seppuku");
+        addSkill("active:flee");
+        addSkill("active:dummy_buff");
+        addSkill("active:seppuku");
     }
 
     Player::Player(const uuids::uuid uuid, const std::string &id, const std::string &name, const std::vector<Attribute> &attributes, const std::vector<Stat> &stats, const Vec2i &pos, const Vec2i &prevPos, const std::map<std::string, int> &skillCD, const std::multiset<Buff> &buffs, const std::map<EquipmentType, std::optional<Equipment>> &equipments) : Player(Entity(uuid, id, name, attributes, stats, pos, prevPos, skillCD, buffs, equipments))
@@ -615,8 +849,14 @@ namespace FTK
         return "player";
     }
 
-    Enemy::Enemy(const Enemy &other) : Enemy(other.uuid, other.id, other.name, other.attributes, other.stats, other.pos, other.prevPos, other.skillCD, other.buffs, other.equipments)
+    // the entity copy takes the skill slots as they are, nothing is looked up in the registry again
+    Enemy::Enemy(const Enemy &other) : Entity(other)
+    {
+    }
+
+    std::shared_ptr<Entity> Enemy::clone() const
     {
+        return std::make_shared<Enemy>(*this);
     }
 
     bool Enemy::isEnemy() const
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <set>
 
 #include <nlohmann/adl_serializer.hpp>
@@ -16,7 +17,9 @@
 
 namespace FTK
 {
-    class Entity
+    class ComponentTable;
+
+    class Entity : public std::enable_shared_from_this<Entity>
     {
     public:
         class Attribute : private NamedModifiableValue
@@ -30,6 +33,7 @@ namespace FTK
 
             using NamedModifiableValue::addModifier;
             using NamedModifiableValue::removeModifier;
+            using NamedModifiableValue::updateModifiers;
 
             using NamedModifiableValue::name;
 
@@ -57,6 +61,7 @@ namespace FTK
 
             using NamedModifiableValue::addModifier;
             using NamedModifiableValue::removeModifier;
+            using NamedModifiableValue::updateModifiers;
 
             using NamedModifiableValue::name;
 
@@ -67,10 +72,45 @@ namespace FTK
             friend nlohmann::adl_serializer<Stat>;
         };
 
+        // queues modifier changes made through the entity until the outermost transaction ends,
+        // then re-evaluates each touched value once and calls updateValues once;
+        // call commit() at the end, the destructor only commits when unwinding and swallows errors there
+        class ModifierTransaction
+        {
+        public:
+            explicit ModifierTransaction(Entity &entity);
+            ModifierTransaction(const ModifierTransaction &other) = delete;
+            ~ModifierTransaction();
+
+            void commit();
+
+        private:
+            Entity &entity;
+            bool active;
+        };
+
+        // a skill owned by the entity, resolved against the active or passive skill registry
+        enum class SkillKind
+        {
+            Active,
+            Passive
+        };
+
+        struct SkillSlot
+        {
+            SkillKind kind;
+            size_t handle;
+            std::string id;
+            int cd;
+        };
+
         Entity(const std::string &id, const std::string &name, const Vec2i &pos);
         Entity(const Entity &other);
         virtual ~Entity();
 
+        // a copy of the same dynamic type that shares nothing mutable with this entity
+        virtual std::shared_ptr<Entity> clone() const;
+
         double operator[](const std::string &key) const;
 
         Vec2i getPos() const;
@@ -82,14 +122,48 @@ namespace FTK
         std::multiset<Buff> getBuffs() const;
         std::map<EquipmentType, std::optional<Equipment>> getEquipments() const;
 
+        const std::vector<SkillSlot> &viewActiveSkills() const;
+        const std::vector<SkillSlot> &viewPassiveSkills() const;
+        const std::multiset<Buff> &viewBuffs() const;
+        const std::map<EquipmentType, std::optional<Equipment>> &viewEquipments() const;
+        const std::vector<Attribute> &viewAttributes() const;
+        const std::vector<Stat> &viewStats() const;
+
+        template <class Func>
+        void forEachActiveSkillCD(Func func) const
+        {
+            for (auto &slot : activeSkillSlots)
+                func(slot.id, slot.cd);
+        }
+
+        template <class Func>
+        void forEachPassiveSkillCD(Func func) const
+        {
+            for (auto &slot : passiveSkillSlots)
+                func(slot.id, slot.cd);
+        }
+
+        template <class Func>
+        void forEachEquipped(Func func) const
+        {
+            for (auto &p : equipments)
+                if (p.second)
+                    func(p.first, *p.second);
+        }
+
         double get(const std::string &key) const;
         int getAsInt(const std::string &key) const;
 
         bool isDead() const;
 
+        // changes whenever anything observable about the entity does, copies start at the same revision
+        uint64_t getRevision() const;
+
         int getWeaponDiceRoll() const;
 
-        Math::Context getMathContext(const std::string &key, const Math::Context &base = Math::Context::default_global()) const;
+        // binds key to this entity's attributes, stats and atk, read when an expression asks for them;
+        // the entity must be owned by a shared_ptr, the bindings only keep a weak reference to it
+        void bindMathContext(const std::string &key, Math::Bindings &bindings) const;
 
         virtual bool isEnemy() const;
         virtual bool isPlayer() const;
@@ -132,8 +206,16 @@ namespace FTK
         void initEquipments();
         void initBuffs();
 
+        void removeBuffs(const std::set<uuids::uuid> &buffUUIDs);
+        // copies the timers into the buffs after a tick, const accessors never write
+        void syncBuffTurns();
+
         virtual void updateValues();
+        void touch();
 
+        std::vector<SkillSlot> &getSkillSlots(SkillKind kind);
+        SkillSlot *findSkill(const std::string &skillID);
+        void addSkill(const std::string &skillID, int cd = 0);
         void addSkills(const std::vector<std::string> &skillIDs);
         void removeSkills(const std::vector<std::string> &skillIDs);
 
@@ -151,13 +233,31 @@ namespace FTK
         Vec2i pos;
         Vec2i prevPos;
         DamageType defaultDamageType = DamageType::Physical;
-        std::map<std::string, int> skillCD;
+        std::vector<SkillSlot> activeSkillSlots;
+        std::vector<SkillSlot> passiveSkillSlots;
         std::multiset<Buff> buffs;
+        BuffTimers buffTimers;
         std::map<EquipmentType, std::optional<Equipment>> equipments;
 
+        struct PendingModifiers
+        {
+            std::map<uuids::uuid, Modifier> added;
+            std::vector<uuids::uuid> removed;
+        };
+
+        void commitModifiers();
+
+        int modifierTransactionDepth = 0;
+        std::map<std::string, PendingModifiers> pendingAttrModifiers;
+        std::map<std::string, PendingModifiers> pendingStatModifiers;
+
+        ComponentTable *componentTable = nullptr;
+        uint64_t revision;
+
         virtual std::string getSerialType() const;
 
         friend class GameManager;
+        friend class ComponentTable;
 
         friend class Player;
         friend class Enemy;
@@ -171,6 +271,8 @@ namespace FTK
     public:
         Player(const Player &other);
 
+        std::shared_ptr<Entity> clone() const override;
+
         bool isPlayer() const override;
 
         int getAP() const;
@@ -196,6 +298,8 @@ namespace FTK
     public:
         Enemy(const Enemy &other);
 
+        std::shared_ptr<Entity> clone() const override;
+
         bool isEnemy() const override;
 
     private:
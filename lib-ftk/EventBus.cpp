@@ -0,0 +1,91 @@
+#include "EventBus.h"
+
+#include <algorithm>
+
+#include "GameSession.h"
+
+namespace FTK
+{
+    size_t EventBus::subscribe(const Listener &listener)
+    {
+        listeners.emplace_back(nextID, listener);
+        return nextID++;
+    }
+
+    void EventBus::unsubscribe(size_t id)
+    {
+        listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [id](auto &p)
+                                       { return p.first == id; }),
+                        listeners.end());
+        if (listeners.empty())
+            clear();
+    }
+
+    bool EventBus::hasSubscribers() const
+    {
+        return !listeners.empty();
+    }
+
+    void EventBus::publish(const Event &event)
+    {
+        if (listeners.empty())
+            return;
+        if (auto moved = std::get_if<EntityMovedEvent>(&event))
+        {
+            if (auto it = pendingMoves.find(moved->entity); it != pendingMoves.end())
+            {
+                std::get<EntityMovedEvent>(pending[it->second]).to = moved->to;
+                return;
+            }
+            pendingMoves.emplace(moved->entity, pending.size());
+        }
+        else if (auto changed = std::get_if<StatChangedEvent>(&event))
+        {
+            if (pendingStatChanges.count(changed->entity))
+                return;
+            pendingStatChanges.emplace(changed->entity, pending.size());
+        }
+        else if (auto state = std::get_if<CombatStateChangedEvent>(&event))
+        {
+            if (pendingCombatState)
+            {
+                std::get<CombatStateChangedEvent>(pending[*pendingCombatState]).to = state->to;
+                return;
+            }
+            pendingCombatState = pending.size();
+        }
+        pending.push_back(event);
+    }
+
+    void EventBus::flush()
+    {
+        // listeners may publish while being notified, those events go out on the next flush
+        auto events = std::move(pending);
+        clear();
+        auto current = listeners;
+        for (auto &e : events)
+            for (auto &p : current)
+                p.second(e);
+    }
+
+    void EventBus::clear()
+    {
+        pending.clear();
+        pendingMoves.clear();
+        pendingStatChanges.clear();
+        pendingCombatState.reset();
+    }
+
+    size_t EventBus::getPendingCount() const
+    {
+        return pending.size();
+    }
+
+    std::shared_ptr<EventBus> EventBus::getInstance()
+    {
+        if (auto session = GameSession::getCurrent())
+            return session->getEventBus();
+        static auto instance = std::shared_ptr<EventBus>(new EventBus());
+        return instance;
+    }
+} // namespace FTK
@@ -0,0 +1,109 @@
+#ifndef FTK_EVENT_BUS_H
+#define FTK_EVENT_BUS_H
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <uuid.h>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    enum class CombatState;
+
+    struct EntityMovedEvent
+    {
+        uuids::uuid entity;
+        Vec2i from;
+        Vec2i to;
+    };
+
+    struct StatChangedEvent
+    {
+        uuids::uuid entity;
+    };
+
+    struct BuffAddedEvent
+    {
+        uuids::uuid entity;
+        uuids::uuid buff;
+        std::string buffID;
+    };
+
+    struct BuffRemovedEvent
+    {
+        uuids::uuid entity;
+        uuids::uuid buff;
+    };
+
+    struct CombatStateChangedEvent
+    {
+        CombatState from;
+        CombatState to;
+    };
+
+    struct ItemUsedEvent
+    {
+        uuids::uuid user;
+        std::string itemID;
+    };
+
+    struct RectRevealedEvent
+    {
+        Vec2i pos;
+    };
+
+    using Event = std::variant<EntityMovedEvent, StatChangedEvent, BuffAddedEvent, BuffRemovedEvent, CombatStateChangedEvent, ItemUsedEvent, RectRevealedEvent>;
+
+    // Queues game state changes and hands them to subscribers on flush(), which front-ends call once per frame.
+    // Events are coalesced while queued: repeated moves of one entity collapse into a single move from the
+    // first origin to the last destination, repeated stat changes of one entity into one, and combat state
+    // changes into one from the first state to the last. Nothing is queued while there are no subscribers.
+    class EventBus
+    {
+    public:
+        using Listener = std::function<void(const Event &)>;
+
+        size_t subscribe(const Listener &listener);
+
+        template <class T>
+        size_t subscribe(const std::function<void(const T &)> &listener)
+        {
+            return subscribe([listener](const Event &e)
+                             {
+                                 if (auto p = std::get_if<T>(&e))
+                                     listener(*p); });
+        }
+
+        void unsubscribe(size_t id);
+        bool hasSubscribers() const;
+
+        void publish(const Event &event);
+        void flush();
+        void clear();
+
+        size_t getPendingCount() const;
+
+        static std::shared_ptr<EventBus> getInstance();
+
+    private:
+        EventBus() = default;
+        friend class GameSession;
+
+        std::vector<std::pair<size_t, Listener>> listeners;
+        size_t nextID = 0;
+
+        std::vector<Event> pending;
+        std::unordered_map<uuids::uuid, size_t> pendingMoves;
+        std::unordered_map<uuids::uuid, size_t> pendingStatChanges;
+        std::optional<size_t> pendingCombatState;
+    };
+} // namespace FTK
+
+#endif // FTK_EVENT_BUS_H
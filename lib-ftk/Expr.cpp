@@ -1,15 +1,100 @@
 #define FTK_MATH_EXPR_STARTUP
 #include "Expr.h"
+#undef FTK_MATH_EXPR_STARTUP
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <mutex>
 #include <stdexcept>
 
+#include "Formula.h"
+
 namespace FTK::Math
 {
-    Expr::Expr(const std::string &rawExpr) : rawExpr(rawExpr), calc(rawExpr.c_str())
+    bool Variable::operator==(const Variable &other) const
     {
+        return name == other.name && field == other.field;
     }
 
-    Expr::Expr(const Expr &other) : Expr(other.rawExpr)
+    static cparse::packToken lookup(const Context &context, const Variable &variable)
+    {
+        auto token = context.find(variable.name);
+        if (!token)
+            return cparse::packToken::None();
+        if (variable.field.empty())
+            return *token;
+        if ((*token)->type != cparse::MAP)
+            return cparse::packToken::None();
+        auto field = token->asMap().find(variable.field);
+        return field ? *field : cparse::packToken::None();
+    }
+
+    Bindings::Bindings(const Context &base) : values(const_cast<Context &>(base).getChild())
+    {
+    }
+
+    cparse::packToken &Bindings::operator[](const std::string &name)
+    {
+        return values[name];
+    }
+
+    void Bindings::bind(const std::string &scope, const Resolver &resolver)
+    {
+        resolvers[scope] = resolver;
+    }
+
+    bool Bindings::isBound(const std::string &scope) const
+    {
+        return resolvers.count(scope);
+    }
+
+    Context Bindings::resolve(const std::vector<Variable> &variables) const
+    {
+        Context res = const_cast<Context &>(values);
+        bool scoped = false;
+        for (auto &v : variables)
+        {
+            if (v.field.empty())
+                continue;
+            auto it = resolvers.find(v.name);
+            if (it == resolvers.end())
+                continue;
+            if (!scoped)
+            {
+                res = res.getChild();
+                scoped = true;
+            }
+            if (!res.map().count(v.name))
+                res[v.name] = Context();
+            res[v.name][v.field] = it->second(v.field);
+        }
+        return res;
+    }
+
+    cparse::packToken Bindings::get(const Variable &variable) const
+    {
+        if (!variable.field.empty())
+        {
+            auto it = resolvers.find(variable.name);
+            if (it != resolvers.end())
+                return it->second(variable.field);
+        }
+        return lookup(values, variable);
+    }
+
+    // function statics, expressions are also constructed during static initialization
+    static std::mutex &getInternMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    Expr::Expr(const std::string &rawExpr) : compiled(intern(rawExpr))
+    {
+    }
+
+    Expr::Expr(const Expr &other) : compiled(other.compiled)
     {
     }
 
@@ -19,24 +104,183 @@ namespace FTK::Math
 
     std::string Expr::getRawExpr() const
     {
-        return rawExpr;
+        return compiled->rawExpr;
+    }
+
+    const std::vector<Variable> &Expr::getVariables() const
+    {
+        return compiled->variables;
+    }
+
+    size_t Expr::getInternedCount()
+    {
+        std::lock_guard lock(getInternMutex());
+        auto &table = getInternTable();
+        return std::count_if(table.begin(), table.end(), [](auto &p)
+                             { return !p.second.expired(); });
+    }
+
+    std::shared_ptr<const Expr::Compiled> Expr::intern(const std::string &rawExpr)
+    {
+        auto &formulas = FormulaRegistry::getInstance();
+        auto source = rawExpr;
+        const NativeFormula *native = nullptr;
+        if (rawExpr.rfind(FormulaRegistry::Prefix, 0) == 0)
+        {
+            native = formulas.findByID(rawExpr.substr(std::strlen(FormulaRegistry::Prefix)));
+            if (!native)
+                throw std::invalid_argument("Unknown formula '" + rawExpr + "'");
+            // still parsed, cparse takes over whenever the native cannot
+            source = native->source;
+        }
+        else
+            native = formulas.findBySource(rawExpr);
+
+        std::lock_guard lock(getInternMutex());
+        auto &table = getInternTable();
+        auto &entry = table[rawExpr];
+        if (auto res = entry.lock())
+            return res;
+        // parsed under the lock so two threads never compile the same text twice
+        auto res = std::shared_ptr<const Compiled>(new Compiled{rawExpr, cparse::calculator(source.c_str()), findVariables(source), native});
+        entry = res;
+        if (table.size() % 64 == 0)
+        {
+            for (auto it = table.begin(); it != table.end();)
+                it = it->second.expired() ? table.erase(it) : std::next(it);
+        }
+        return res;
+    }
+
+    std::map<std::string, std::weak_ptr<const Expr::Compiled>> &Expr::getInternTable()
+    {
+        static std::map<std::string, std::weak_ptr<const Compiled>> table;
+        return table;
+    }
+
+    std::vector<Variable> Expr::findVariables(const std::string &rawExpr)
+    {
+        std::vector<Variable> res;
+        auto isWordChar = [](char c)
+        { return std::isalnum((unsigned char)c) || c == '_'; };
+        auto readWord = [&rawExpr, &isWordChar](size_t &i)
+        {
+            auto begin = i;
+            while (i < rawExpr.size() && isWordChar(rawExpr[i]))
+                i++;
+            return rawExpr.substr(begin, i - begin);
+        };
+        auto skipSpaces = [&rawExpr](size_t &i)
+        {
+            while (i < rawExpr.size() && std::isspace((unsigned char)rawExpr[i]))
+                i++;
+        };
+
+        size_t i = 0;
+        while (i < rawExpr.size())
+        {
+            auto c = rawExpr[i];
+            if (c == '"' || c == '\'')
+            {
+                for (i++; i < rawExpr.size() && rawExpr[i] != c; i++)
+                    if (rawExpr[i] == '\\')
+                        i++;
+                i++;
+            }
+            else if (std::isdigit((unsigned char)c))
+            {
+                // numbers, exponents included
+                while (i < rawExpr.size() && (isWordChar(rawExpr[i]) || rawExpr[i] == '.'))
+                    i++;
+            }
+            else if (isWordChar(c))
+            {
+                Variable v{readWord(i), {}};
+                auto next = i;
+                skipSpaces(next);
+                if (next < rawExpr.size() && rawExpr[next] == '(')
+                    continue;
+                if (next < rawExpr.size() && rawExpr[next] == '.')
+                {
+                    next++;
+                    skipSpaces(next);
+                    if (next < rawExpr.size() && isWordChar(rawExpr[next]) && !std::isdigit((unsigned char)rawExpr[next]))
+                    {
+                        v.field = readWord(next);
+                        i = next;
+                        // only the first member is resolved, deeper ones are read from it
+                        while (i < rawExpr.size() && (rawExpr[i] == '.' || isWordChar(rawExpr[i])))
+                            i++;
+                    }
+                }
+                if (std::find(res.begin(), res.end(), v) == res.end())
+                    res.push_back(v);
+            }
+            else
+                i++;
+        }
+        return res;
+    }
+
+    // false when the expression has no native formula, or one of its inputs is not a number
+    template <typename Lookup>
+    static bool evalNative(const NativeFormula *native, const Lookup &lookup, double &res)
+    {
+        if (!native || !native->isEnabled())
+            return false;
+        double args[NativeFormula::MaxInputs];
+        for (size_t i = 0; i < native->inputs.size(); i++)
+        {
+            auto token = lookup(native->inputs[i]);
+            if (token->type != cparse::INT && token->type != cparse::REAL)
+                return false;
+            args[i] = token.asDouble();
+        }
+        res = native->eval(args);
+        return true;
     }
 
     bool Expr::evalBool(const Context &context) const
     {
-        return calc.eval(context).asBool();
+        double res;
+        if (evalNative(compiled->native, [&context](const Variable &v)
+                       { return lookup(context, v); }, res))
+            return res != 0;
+        return compiled->calc.eval(context).asBool();
     }
 
     double Expr::evalDouble(const Context &context) const
     {
-        return calc.eval(context).asDouble();
+        double res;
+        if (evalNative(compiled->native, [&context](const Variable &v)
+                       { return lookup(context, v); }, res))
+            return res;
+        return compiled->calc.eval(context).asDouble();
+    }
+
+    bool Expr::evalBool(const Bindings &bindings) const
+    {
+        double res;
+        if (evalNative(compiled->native, [&bindings](const Variable &v)
+                       { return bindings.get(v); }, res))
+            return res != 0;
+        return compiled->calc.eval(bindings.resolve(compiled->variables)).asBool();
+    }
+
+    double Expr::evalDouble(const Bindings &bindings) const
+    {
+        double res;
+        if (evalNative(compiled->native, [&bindings](const Variable &v)
+                       { return bindings.get(v); }, res))
+            return res;
+        return compiled->calc.eval(bindings.resolve(compiled->variables)).asDouble();
     }
 
     Expression::Expression(const std::string &rawExpr) : Expr(rawExpr)
     {
     }
 
-    Expression::Expression(const Expression &other) : Expression(other.rawExpr)
+    Expression::Expression(const Expression &other) : Expr(other)
     {
     }
 
@@ -54,11 +298,70 @@ namespace FTK::Math
         return evalDouble(context);
     }
 
+    double Expression::eval(const Bindings &bindings) const
+    {
+        return evalDouble(bindings);
+    }
+
+    void Expression::evalEach(Bindings &bindings, const std::string &scope, size_t count, const std::function<void(size_t lane, Bindings &bindings)> &bindLane, double *out) const
+    {
+        if (!count)
+            return;
+        auto &variables = compiled->variables;
+        if (std::none_of(variables.begin(), variables.end(), [&scope](const Variable &v)
+                         { return v.name == scope; }))
+        {
+            bindLane(count - 1, bindings);
+            std::fill(out, out + count, eval(bindings));
+            return;
+        }
+
+        auto native = compiled->native;
+        if (native && native->isEnabled())
+        {
+            auto &inputs = native->inputs;
+            std::vector<std::vector<double>> columns(inputs.size(), std::vector<double>(count));
+            bool numbers = true;
+            for (size_t lane = 0; lane < count && numbers; lane++)
+            {
+                bindLane(lane, bindings);
+                for (size_t i = 0; i < inputs.size() && numbers; i++)
+                {
+                    // unscoped inputs are read once and repeated
+                    if (inputs[i].name != scope && lane)
+                    {
+                        columns[i][lane] = columns[i][0];
+                        continue;
+                    }
+                    auto token = bindings.get(inputs[i]);
+                    numbers = token->type == cparse::INT || token->type == cparse::REAL;
+                    if (numbers)
+                        columns[i][lane] = token.asDouble();
+                }
+            }
+            if (numbers)
+            {
+                std::vector<const double *> pointers;
+                for (auto &c : columns)
+                    pointers.push_back(c.data());
+                native->evalBatch(pointers.data(), count, out);
+                bindLane(count - 1, bindings);
+                return;
+            }
+        }
+
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            bindLane(lane, bindings);
+            out[lane] = eval(bindings);
+        }
+    }
+
     Condition::Condition(const std::string &rawExpr) : Expr(rawExpr)
     {
     }
 
-    Condition::Condition(const Condition &other) : Condition(other.rawExpr)
+    Condition::Condition(const Condition &other) : Expr(other)
     {
     }
 
@@ -76,4 +379,9 @@ namespace FTK::Math
         return evalBool(context);
     }
 
+    bool Condition::eval(const Bindings &bindings) const
+    {
+        return evalBool(bindings);
+    }
+
 } // namespace FTK::Math
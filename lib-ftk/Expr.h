@@ -2,10 +2,13 @@
 #define FTK_MATH_EXPR_H
 
 #include <any>
+#include <functional>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <variant>
+#include <vector>
 
 #include <shunting-yard.h>
 
@@ -15,6 +18,45 @@ namespace FTK::Math
 {
     using Context = cparse::TokenMap;
 
+    // a name read by an expression, `self.hp` is {"self", "hp"} and `rolled_result` is {"rolled_result", ""}
+    struct Variable
+    {
+        std::string name;
+        std::string field;
+
+        bool operator==(const Variable &other) const;
+    };
+
+    // The variables of an evaluation. Plain values are stored as they are set, scopes such as self, target
+    // and skill are bound to a resolver that is only asked for the fields an expression reads.
+    // Values are written into a child of the base context, never into the base itself.
+    class Bindings
+    {
+    public:
+        using Resolver = std::function<cparse::packToken(const std::string &field)>;
+
+        explicit Bindings(const Context &base = Context::default_global());
+
+        cparse::packToken &operator[](const std::string &name);
+
+        void bind(const std::string &scope, const Resolver &resolver);
+        bool isBound(const std::string &scope) const;
+
+        // a context holding the given variables of the bound scopes, on top of the plain values
+        Context resolve(const std::vector<Variable> &variables) const;
+        // one variable, None when it is not set
+        cparse::packToken get(const Variable &variable) const;
+
+    private:
+        Context values;
+        std::map<std::string, Resolver> resolvers;
+    };
+
+    class NativeFormula;
+
+    // An expression is a handle to an immutable compiled form. Compiled forms are interned by source text,
+    // so every copy and every identical formula across the gamedata share one parse.
+    // Sources of a registered native formula, and "formula:<id>", are computed by the native when they can be.
     class Expr
     {
     public:
@@ -23,13 +65,33 @@ namespace FTK::Math
         virtual ~Expr() = 0;
 
         std::string getRawExpr()const;
+        // every variable the expression reads, in order of first appearance, found when it is compiled
+        const std::vector<Variable> &getVariables() const;
+
+        // distinct source texts currently compiled
+        static size_t getInternedCount();
 
     protected:
         bool evalBool(const Context &context = {}) const;
         double evalDouble(const Context &context = {}) const;
+        bool evalBool(const Bindings &bindings) const;
+        double evalDouble(const Bindings &bindings) const;
 
-        std::string rawExpr;
-        cparse::calculator calc;
+        struct Compiled
+        {
+            std::string rawExpr;
+            cparse::calculator calc;
+            std::vector<Variable> variables;
+            const NativeFormula *native;
+        };
+
+        std::shared_ptr<const Compiled> compiled;
+
+    private:
+        static std::shared_ptr<const Compiled> intern(const std::string &rawExpr);
+        // entries are weak, a formula no longer held anywhere is parsed again on its next use
+        static std::map<std::string, std::weak_ptr<const Compiled>> &getInternTable();
+        static std::vector<Variable> findVariables(const std::string &rawExpr);
     };
 
     class Expression : public Expr
@@ -42,6 +104,11 @@ namespace FTK::Math
         double operator()(const Context &context = Context::default_global()) const;
 
         double eval(const Context &context = Context::default_global()) const;
+        double eval(const Bindings &bindings) const;
+        // One value per lane, bindLane binds the lane's scope before it is read. A native formula is computed
+        // over all lanes in one pass, an expression not reading the scope at all is evaluated once.
+        // The bindings are left bound to the last lane.
+        void evalEach(Bindings &bindings, const std::string &scope, size_t count, const std::function<void(size_t lane, Bindings &bindings)> &bindLane, double *out) const;
 
         friend nlohmann::adl_serializer<Expression>;
     };
@@ -56,6 +123,7 @@ namespace FTK::Math
         bool operator()(const Context &context = Context::default_global()) const;
 
         bool eval(const Context &context = Context::default_global()) const;
+        bool eval(const Bindings &bindings) const;
 
         friend nlohmann::adl_serializer<Condition>;
     };
@@ -0,0 +1,212 @@
+#include "Formula.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace FTK::Math
+{
+    static constexpr double absorption(double def)
+    {
+        return def / (def + 50);
+    }
+
+    static constexpr double ratio(double a, double b)
+    {
+        return a / b;
+    }
+
+    static constexpr double equal(double a, double b)
+    {
+        return a == b;
+    }
+
+    static constexpr double isZero(double a)
+    {
+        return a == 0;
+    }
+
+    static constexpr double isPositive(double a)
+    {
+        return a > 0;
+    }
+
+    static_assert(absorption(50) == 0.5);
+    static_assert(ratio(3, 4) == 0.75);
+
+    template <double (*F)(double)>
+    struct Unary
+    {
+        static double eval(const double *args)
+        {
+            return F(args[0]);
+        }
+
+        static void evalBatch(const double *const *columns, size_t count, double *out)
+        {
+            auto a = columns[0];
+            for (size_t i = 0; i < count; i++)
+                out[i] = F(a[i]);
+        }
+    };
+
+    template <double (*F)(double, double)>
+    struct Binary
+    {
+        static double eval(const double *args)
+        {
+            return F(args[0], args[1]);
+        }
+
+        static void evalBatch(const double *const *columns, size_t count, double *out)
+        {
+            auto a = columns[0];
+            auto b = columns[1];
+            for (size_t i = 0; i < count; i++)
+                out[i] = F(a[i], b[i]);
+        }
+    };
+
+    NativeFormula::NativeFormula(const std::string &id, const std::string &source, const std::vector<Variable> &inputs, Function function, BatchFunction batchFunction, const std::vector<std::vector<double>> &samples)
+        : id(id), source(source), inputs(inputs), function(function), batchFunction(batchFunction), samples(samples)
+    {
+        if (inputs.size() > MaxInputs)
+            throw std::invalid_argument("Too many inputs for formula " + id);
+    }
+
+    bool NativeFormula::isEnabled() const
+    {
+        std::call_once(verified, [this]()
+                       { enabled = verify(); });
+        return enabled;
+    }
+
+    double NativeFormula::eval(const double *args) const
+    {
+        return function(args);
+    }
+
+    void NativeFormula::evalBatch(const double *const *columns, size_t count, double *out) const
+    {
+        batchFunction(columns, count, out);
+    }
+
+    bool NativeFormula::verify() const
+    {
+        try
+        {
+            cparse::calculator calc(source.c_str());
+            std::vector<double> scalar;
+            for (auto &sample : samples)
+            {
+                for (auto asInt : {false, true})
+                {
+                    if (asInt && std::any_of(sample.begin(), sample.end(), [](double v)
+                                             { return v != std::trunc(v); }))
+                        continue;
+                    auto context = Context::default_global().getChild();
+                    for (size_t i = 0; i < inputs.size(); i++)
+                    {
+                        auto value = asInt ? cparse::packToken((int64_t)sample[i]) : cparse::packToken(sample[i]);
+                        auto &v = inputs[i];
+                        if (v.field.empty())
+                            context[v.name] = value;
+                        else
+                        {
+                            if (!context.map().count(v.name))
+                                context[v.name] = Context();
+                            context[v.name][v.field] = value;
+                        }
+                    }
+                    auto expected = calc.eval(context);
+                    auto actual = function(sample.data());
+                    if (!asInt)
+                        scalar.push_back(actual);
+                    if (expected->type == cparse::BOOL)
+                    {
+                        if (expected.asBool() != (actual != 0))
+                            return false;
+                    }
+                    else
+                    {
+                        auto value = expected.asDouble();
+                        if (std::memcmp(&value, &actual, sizeof(double)))
+                            return false;
+                    }
+                }
+            }
+
+            // the batch over all samples at once must agree with the single rows
+            std::vector<std::vector<double>> columns(inputs.size());
+            for (auto &sample : samples)
+                for (size_t i = 0; i < inputs.size(); i++)
+                    columns[i].push_back(sample[i]);
+            std::vector<const double *> pointers;
+            for (auto &c : columns)
+                pointers.push_back(c.data());
+            std::vector<double> batch(samples.size());
+            batchFunction(pointers.data(), samples.size(), batch.data());
+            return !std::memcmp(batch.data(), scalar.data(), batch.size() * sizeof(double));
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+
+    template <typename Impl>
+    void FormulaRegistry::add(const std::string &id, const std::string &source, const std::vector<Variable> &inputs, const std::vector<std::vector<double>> &samples)
+    {
+        auto &formula = byID[id] = std::make_unique<NativeFormula>(id, source, inputs, &Impl::eval, &Impl::evalBatch, samples);
+        bySource[normalize(source)] = formula.get();
+    }
+
+    FormulaRegistry::FormulaRegistry()
+    {
+        add<Unary<absorption>>("physical_absorption", "target.p_def/(target.p_def+50)", {{"target", "p_def"}}, {{0}, {1}, {7}, {50}, {123.25}, {-10}});
+        add<Unary<absorption>>("magical_absorption", "target.m_def/(target.m_def+50)", {{"target", "m_def"}}, {{0}, {1}, {7}, {50}, {123.25}, {-10}});
+        add<Binary<ratio>>("dice_mult", "rolled_result/dice_rolls", {{"rolled_result", ""}, {"dice_rolls", ""}}, {{0, 3}, {1, 3}, {2, 3}, {3, 3}, {5, 7}});
+        add<Binary<equal>>("critical_success", "rolled_result==dice_rolls", {{"rolled_result", ""}, {"dice_rolls", ""}}, {{0, 3}, {2, 3}, {3, 3}});
+        add<Unary<isZero>>("critical_fail", "rolled_result==0", {{"rolled_result", ""}}, {{0}, {1}, {3}});
+        add<Unary<isPositive>>("any_success", "rolled_result>0", {{"rolled_result", ""}}, {{0}, {1}, {3}});
+    }
+
+    std::string FormulaRegistry::normalize(const std::string &source)
+    {
+        std::string res;
+        for (auto c : source)
+            if (!std::isspace((unsigned char)c))
+                res.push_back(c);
+        return res;
+    }
+
+    const NativeFormula *FormulaRegistry::findByID(const std::string &id) const
+    {
+        auto it = byID.find(id);
+        return it == byID.end() ? nullptr : it->second.get();
+    }
+
+    const NativeFormula *FormulaRegistry::findBySource(const std::string &source) const
+    {
+        auto it = bySource.find(normalize(source));
+        return it == bySource.end() ? nullptr : it->second;
+    }
+
+    std::vector<std::string> FormulaRegistry::getIDs() const
+    {
+        std::vector<std::string> res;
+        for (auto &[id, formula] : byID)
+            res.push_back(id);
+        return res;
+    }
+
+    const FormulaRegistry &FormulaRegistry::getInstance()
+    {
+        // function static, the formulas of Action.cpp are interned during static initialization
+        static FormulaRegistry instance;
+        return instance;
+    }
+} // namespace FTK::Math
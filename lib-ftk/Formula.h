@@ -0,0 +1,77 @@
+#ifndef FTK_MATH_FORMULA_H
+#define FTK_MATH_FORMULA_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+
+namespace FTK::Math
+{
+    // A built-in formula computed in C++ instead of by cparse. Expressions whose text is the formula's source,
+    // or that name it as "formula:<id>", dispatch to it as long as every input is a number.
+    // Before its first use the formula is checked against cparse on its samples, given once as reals and
+    // once as integers; one differing result in any bit keeps it on cparse for the rest of the run.
+    class NativeFormula
+    {
+    public:
+        static constexpr size_t MaxInputs = 4;
+
+        using Function = double (*)(const double *args);
+        // one column per input, count values each
+        using BatchFunction = void (*)(const double *const *columns, size_t count, double *out);
+
+        NativeFormula(const std::string &id, const std::string &source, const std::vector<Variable> &inputs, Function function, BatchFunction batchFunction, const std::vector<std::vector<double>> &samples);
+        NativeFormula(const NativeFormula &other) = delete;
+
+        bool isEnabled() const;
+        // the inputs in order, conditions return 1 or 0
+        double eval(const double *args) const;
+        // the same as eval on every row, in a loop the compiler can vectorize
+        void evalBatch(const double *const *columns, size_t count, double *out) const;
+
+        const std::string id;
+        const std::string source;
+        const std::vector<Variable> inputs;
+
+    private:
+        bool verify() const;
+
+        Function function;
+        BatchFunction batchFunction;
+        std::vector<std::vector<double>> samples;
+
+        mutable std::once_flag verified;
+        mutable bool enabled = false;
+    };
+
+    class FormulaRegistry
+    {
+    public:
+        static constexpr const char *Prefix = "formula:";
+
+        FormulaRegistry(const FormulaRegistry &other) = delete;
+
+        const NativeFormula *findByID(const std::string &id) const;
+        // spaces are ignored, `target.p_def / (target.p_def + 50)` is the physical absorption as well
+        const NativeFormula *findBySource(const std::string &source) const;
+        std::vector<std::string> getIDs() const;
+
+        static const FormulaRegistry &getInstance();
+
+    private:
+        FormulaRegistry();
+
+        template <typename Impl>
+        void add(const std::string &id, const std::string &source, const std::vector<Variable> &inputs, const std::vector<std::vector<double>> &samples);
+        static std::string normalize(const std::string &source);
+
+        std::map<std::string, std::unique_ptr<NativeFormula>> byID;
+        std::map<std::string, const NativeFormula *> bySource;
+    };
+} // namespace FTK::Math
+
+#endif // FTK_MATH_FORMULA_H
@@ -2,10 +2,15 @@
 
 #include <fstream>
 
-#include <effolkronium/random.hpp>
-
 #include "utils.h"
+#include "AllocTracker.h"
+#include "CommandLog.h"
 #include "Dice.h"
+#include "EventBus.h"
+#include "GameSession.h"
+#include "MapLoader.h"
+#include "SaveContainer.h"
+#include "Random.h"
 #include "combat.h"
 #include "Serializer.h"
 
@@ -75,8 +80,22 @@ namespace FTK
         return getInteractableType(getCurrentPlayer()->getPos());
     }
 
+    std::vector<Vec2i> GameManager::getReachableCells() const
+    {
+        if (gameState != GameState::Explore || exploreState != ExploreState::Move)
+            return {};
+        auto ep = getCurrentPlayer();
+        return world->getPathfinder()->getReachable(ep->getPos(), ep->getAP());
+    }
+
+    std::vector<Vec2i> GameManager::getPathTo(const Vec2i &target) const
+    {
+        return world->getPathfinder()->findPath(getCurrentPlayer()->getPos(), target);
+    }
+
     void GameManager::beginTurn()
     {
+        CommandLog::Scope logScope(CommandType::BeginTurn);
         if (exploreState == ExploreState::BeginTurn)
         {
             if (getCurrentPlayer()->isDead())
@@ -91,6 +110,7 @@ namespace FTK
 
     void GameManager::rollAP(const uuids::uuid uuid, int focusUsed)
     {
+        CommandLog::Scope logScope(CommandType::RollAP, uuid, focusUsed);
         if (exploreState == ExploreState::RollAP)
         {
             auto ep = world->getPlayerByUUID(uuid);
@@ -108,6 +128,7 @@ namespace FTK
 
     bool GameManager::movePlayer(const uuids::uuid &uuid, const Vec2i &newPos, bool retreat, bool ignoreAdjacent)
     {
+        CommandLog::Scope logScope(CommandType::MovePlayer, uuid, newPos, retreat, ignoreAdjacent);
         if (exploreState != ExploreState::Move)
             return false;
         if (!isPosTraversable(newPos))
@@ -146,12 +167,8 @@ namespace FTK
             ep->setPos(newPos);
             interactionFlags = InteractionFlag_None;
 
-            for (auto off : ManhattanDistanceOffsets)
-            {
-                auto tgt = newPos + off;
-                if (world->inBound(tgt))
-                    world->getRectAt(tgt)->markVisible();
-            }
+            world->clearVisibilityChanges();
+            world->reveal(newPos);
 
             if (getInteractableType(newPos) != InteractableType::None)
             {
@@ -166,11 +183,13 @@ namespace FTK
 
     bool GameManager::retreatPlayer(const uuids::uuid &uuid)
     {
+        CommandLog::Scope logScope(CommandType::RetreatPlayer, uuid);
         return movePlayer(uuid, world->getPlayerByUUID(uuid)->getPrevPos(), true, true);
     }
 
     void GameManager::endTurn()
     {
+        CommandLog::Scope logScope(CommandType::EndTurn);
         if (exploreState == ExploreState::EndTurn)
         {
             currentPlayerIndex++;
@@ -191,6 +210,24 @@ namespace FTK
         return movePlayer(getCurrentPlayerUUID(), newPos, retreat, ignoreAdjacent);
     }
 
+    bool GameManager::movePlayerTo(const Vec2i &target)
+    {
+        CommandLog::Scope logScope(CommandType::MovePlayerTo, target);
+        if (gameState != GameState::Explore || exploreState != ExploreState::Move)
+            return false;
+        auto path = getPathTo(target);
+        if (path.empty() || (int)path.size() > getCurrentPlayer()->getAP())
+            return false;
+        for (auto &step : path)
+        {
+            if (!movePlayer(step))
+                return false;
+            if (gameState != GameState::Explore || exploreState != ExploreState::Move)
+                break;
+        }
+        return true;
+    }
+
     bool GameManager::retreatPlayer()
     {
         return retreatPlayer(getCurrentPlayerUUID());
@@ -198,6 +235,7 @@ namespace FTK
 
     void GameManager::beginRound()
     {
+        CommandLog::Scope logScope(CommandType::BeginRound);
         if (exploreState == ExploreState::BeginRound)
         {
             round++;
@@ -208,6 +246,7 @@ namespace FTK
 
     void GameManager::endRound()
     {
+        CommandLog::Scope logScope(CommandType::EndRound);
         if (exploreState == ExploreState::EndRound)
         {
             exploreState = ExploreState::BeginRound;
@@ -216,6 +255,7 @@ namespace FTK
 
     void GameManager::enterShop()
     {
+        CommandLog::Scope logScope(CommandType::EnterShop);
         if (gameState == GameState::Interact)
         {
             gameState = GameState::Shop;
@@ -224,6 +264,7 @@ namespace FTK
 
     void GameManager::exitShop()
     {
+        CommandLog::Scope logScope(CommandType::ExitShop);
         if (gameState == GameState::Shop)
         {
             gameState = GameState::Interact;
@@ -233,17 +274,20 @@ namespace FTK
 
     void GameManager::beginTeleport()
     {
+        CommandLog::Scope logScope(CommandType::BeginTeleport);
         gameState = GameState::Teleport;
     }
 
     void GameManager::endTeleport()
     {
+        CommandLog::Scope logScope(CommandType::EndTeleport);
         gameState = GameState::Interact;
         markInteractionDone();
     }
 
     void GameManager::useItem(const std::string &itemID)
     {
+        CommandLog::Scope logScope(CommandType::UseItem, itemID);
         auto itemData = MainRegistry::getInstance()->itemTemplates->get(itemID);
         if (itemID == "item:teleport_scroll")
         {
@@ -251,63 +295,42 @@ namespace FTK
             return;
         }
         ActionContext ctx;
-        ctx.mathContext = getCurrentPlayer()->getMathContext("target", getCurrentPlayer()->getMathContext("self", ctx.mathContext));
+        getCurrentPlayer()->bindMathContext("self", ctx.bindings);
+        getCurrentPlayer()->bindMathContext("target", ctx.bindings);
         for (auto act : itemData.actionsOnUse)
         {
             act->apply(getCurrentPlayer(), getCurrentPlayer(), ctx);
         }
         inventory->removeItem(itemID);
+        EventBus::getInstance()->publish(ItemUsedEvent{getCurrentPlayerUUID(), itemID});
     }
 
     void GameManager::triggerBattle(const uuids::uuid &triggerer, const Vec2i &pos, bool ambush, bool ambushFailed)
     {
+        CommandLog::Scope logScope(CommandType::TriggerBattle, triggerer, pos, ambush, ambushFailed);
         std::vector<uuids::uuid> playersToBattle;
         std::vector<uuids::uuid> enemiesToBattle;
         playersToBattle.push_back(triggerer);
 
-        [this, &playersToBattle, pos]()
+        std::vector<EntityHandle> nearby;
+        world->getPlayersInRadius(pos, BattleRadius, nearby);
+        for (auto &h : nearby)
         {
-            for (auto offset : ManhattanDistanceOffsets)
-            {
-                if (auto eps = world->getPlayersAt(pos + offset); eps.size())
-                {
-                    for (auto ep : eps)
-                    {
-                        if (!ep->isPlayer())
-                            continue;
-                        if (std::find(playersToBattle.begin(), playersToBattle.end(), ep->uuid) != playersToBattle.end())
-                            continue;
-                        while (playersToBattle.size() > 3)
-                            playersToBattle.pop_back();
-                        if (playersToBattle.size() == 3)
-                            return;
-                        playersToBattle.push_back(ep->uuid);
-                    }
-                }
-            }
-        }();
+            if (playersToBattle.size() == 3)
+                break;
+            if (h.getUUID() != triggerer)
+                playersToBattle.push_back(h.getUUID());
+        }
 
-        [this, &enemiesToBattle, pos, ambush]()
+        size_t enemyLimit = ambush ? 1 : 3;
+        world->getEntitiesInRadius(pos, BattleRadius, nearby);
+        for (auto &h : nearby)
         {
-            for (auto offset : ManhattanDistanceOffsets)
-            {
-                if (auto ents = world->getEntitiesAt(pos + offset); ents.size())
-                {
-                    for (auto ent : ents)
-                    {
-                        if (!ent->isEnemy())
-                            continue;
-                        if (std::find(enemiesToBattle.begin(), enemiesToBattle.end(), ent->uuid) != enemiesToBattle.end())
-                            continue;
-                        while ((ambush && enemiesToBattle.size() > 1) || enemiesToBattle.size() > 3)
-                            enemiesToBattle.pop_back();
-                        if ((ambush && enemiesToBattle.size() == 1) || enemiesToBattle.size() == 3)
-                            return;
-                        enemiesToBattle.push_back(ent->uuid);
-                    }
-                }
-            }
-        }();
+            if (enemiesToBattle.size() == enemyLimit)
+                break;
+            if (h->isEnemy())
+                enemiesToBattle.push_back(h.getUUID());
+        }
 
         gameState = GameState::Battle;
         CombatSystem::getInstance()->beginBattle(
@@ -325,6 +348,7 @@ namespace FTK
 
     void GameManager::prepAPRoll()
     {
+        CommandLog::Scope logScope(CommandType::PrepAPRoll);
         if (exploreState == ExploreState::RollAP)
         {
             auto ep = world->getPlayerByUUID(getCurrentPlayerUUID());
@@ -334,6 +358,7 @@ namespace FTK
 
     void GameManager::markAPRolled(size_t rolledAmount)
     {
+        CommandLog::Scope logScope(CommandType::MarkAPRolled, rolledAmount);
         if (exploreState == ExploreState::RollAP)
         {
             auto ep = world->getPlayerByUUID(getCurrentPlayerUUID());
@@ -347,6 +372,7 @@ namespace FTK
 
     void GameManager::markInteractionDone(bool all)
     {
+        CommandLog::Scope logScope(CommandType::MarkInteractionDone, all);
         if (gameState == GameState::Interact || gameState == GameState::Battle)
         {
             if (getExploreState() == ExploreState::EndTurn)
@@ -375,22 +401,40 @@ namespace FTK
 
     void GameManager::markEntityDead(const uuids::uuid &entityUUID)
     {
+        CommandLog::Scope logScope(CommandType::MarkEntityDead, entityUUID);
         world->removeEntity(entityUUID);
     }
 
     void GameManager::markPlayerDead(const uuids::uuid &playerUUID)
     {
+        CommandLog::Scope logScope(CommandType::MarkPlayerDead, playerUUID);
         if (getCurrentPlayerUUID() == playerUUID)
             exploreState = ExploreState::EndTurn;
     }
 
-    void GameManager::saveMap(const std::string &path)
+    size_t GameManager::rollFocusedDice(const uuids::uuid &uuid, size_t amount, double chance, int guarantee, int focusUsed)
+    {
+        CommandLog::Scope logScope(CommandType::RollFocusedDice, uuid, amount, chance, guarantee, focusUsed);
+        auto ep = world->getPlayerByUUID(uuid);
+        focusUsed = std::max(0, std::min(focusUsed, ep->getAsInt("focus")));
+        ep->dec("focus", focusUsed);
+        return Dice::rollUniformDices(amount, std::max(0.0, std::min(1.0, chance * ep->get("dice_chance_mult"))), guarantee + focusUsed);
+    }
+
+    void GameManager::equip(const uuids::uuid &entityUUID, const uuids::uuid &equipmentUUID)
+    {
+        CommandLog::Scope logScope(CommandType::Equip, entityUUID, equipmentUUID);
+        world->getPlayerByUUID(entityUUID)->addEquipment(inventory->removeEquipment(equipmentUUID));
+    }
+
+    void GameManager::unequip(const uuids::uuid &entityUUID, EquipmentType slot)
+    {
+        CommandLog::Scope logScope(CommandType::Unequip, entityUUID, slot);
+        inventory->addEquipment(world->getPlayerByUUID(entityUUID)->removeEquipment(slot));
+    }
+
+    nlohmann::ordered_json GameManager::toJson() const
     {
-        if (!std::filesystem::exists(path))
-        {
-            std::filesystem::create_directories(std::filesystem::path(path).parent_path());
-        }
-        std::ofstream ofs(path);
         nlohmann::ordered_json j;
         j["world"] = world;
         j["game_state"] = gameState;
@@ -401,10 +445,32 @@ namespace FTK
         j["interaction_flags"] = interactionFlags;
         j["inventory"] = inventory;
         j["combat_state"] = CombatSystem::getInstance()->saveState();
-        std::stringstream ss;
-        effolkronium::random_static::serialize(ss);
-        j["random_state"] = ss.str();
-        ofs << std::setw(4) << j;
+        j["random_state"] = Random::getInstance()->serialize();
+        return j;
+    }
+
+    void GameManager::saveMap(const std::string &path)
+    {
+        AllocTracker::Scope allocScope(AllocTag::Save);
+        if (!std::filesystem::exists(path))
+        {
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        }
+        if (SaveContainer::hasExtension(path))
+        {
+            auto j = toJson();
+            SaveContainer container;
+            container.put("world", j["world"].dump());
+            j.erase("world");
+            container.put("state", j.dump());
+            container.save(path);
+        }
+        else
+        {
+            std::ofstream ofs(path);
+            ofs << std::setw(4) << toJson();
+        }
+        AllocTracker::completeInterval(AllocTag::Save);
     }
 
     void GameManager::saveMap(const char *path)
@@ -414,11 +480,34 @@ namespace FTK
 
     void GameManager::loadMap(const std::string &path)
     {
+        AllocTracker::Scope allocScope(AllocTag::Load);
         reset();
-        std::ifstream ifs(path);
-        nlohmann::json j;
-        ifs >> j;
-        world = j["world"].get<std::shared_ptr<World>>();
+        if (SaveContainer::isContainer(path))
+        {
+            auto container = SaveContainer::load(path);
+            auto state = container.has("state") ? nlohmann::json::parse(container.get("state")) : nlohmann::json::object();
+            loadMap(MapLoader::loadWorldFromText(container.get("world")), state);
+            return;
+        }
+        auto loaded = MapLoader::load(path);
+        loadMap(loaded.world, loaded.state);
+    }
+
+    void GameManager::loadMap(const char *path)
+    {
+        loadMap(std::string(path));
+    }
+
+    void GameManager::loadMapFromJson(const nlohmann::json &j)
+    {
+        AllocTracker::Scope allocScope(AllocTag::Load);
+        reset();
+        loadMap(j["world"].get<std::shared_ptr<World>>(), j);
+    }
+
+    void GameManager::loadMap(const std::shared_ptr<World> &loadedWorld, const nlohmann::json &j)
+    {
+        world = loadedWorld;
 
         if (j.contains("game_state"))
         {
@@ -430,8 +519,7 @@ namespace FTK
             interactionFlags = j["interaction_flags"].get<InteractionFlags>();
             inventory = j["inventory"].get<std::shared_ptr<Inventory>>();
             CombatSystem::getInstance()->retoreState(j["combat_state"]);
-            std::stringstream ss(j["random_state"].get<std::string>());
-            effolkronium::random_static::deserialize(ss);
+            Random::getInstance()->deserialize(j["random_state"].get<std::string>());
         }
         else
         {
@@ -449,11 +537,7 @@ namespace FTK
         if (!inventory)
             inventory = std::make_shared<Inventory>();
         restore(gameState == GameState::None);
-    }
-
-    void GameManager::loadMap(const char *path)
-    {
-        loadMap(std::string(path));
+        AllocTracker::completeInterval(AllocTag::Load);
     }
 
     void GameManager::initGame()
@@ -471,7 +555,7 @@ namespace FTK
                          { return p1->get("speed") > p2->get("speed"); });
         playerTurnOrder = map<uuids::uuid>(eps, [](auto ep)
                                            { return ep->uuid; });
-        effolkronium::random_static::reseed();
+        Random::getInstance()->reseed();
         gameState = GameState::Explore;
         exploreState = ExploreState::BeginRound;
     }
@@ -497,6 +581,8 @@ namespace FTK
 
     const std::shared_ptr<GameManager> GameManager::getInstance()
     {
+        if (auto session = GameSession::getCurrent())
+            return session->getGameManager();
         static const auto instance = std::shared_ptr<GameManager>(new GameManager());
         return instance;
     }
@@ -78,6 +78,9 @@ namespace FTK
         InteractableType getInteractableType(const Vec2i &pos) const;
         InteractableType getCurrentInteractableType() const;
 
+        std::vector<Vec2i> getReachableCells() const;
+        std::vector<Vec2i> getPathTo(const Vec2i &target) const;
+
         void beginTurn();
         void rollAP(const uuids::uuid uuid, int focusUsed);
         bool movePlayer(const uuids::uuid &uuid, const Vec2i &newPos, bool retreat = false, bool ignoreAdjacent = false);
@@ -86,6 +89,7 @@ namespace FTK
 
         void rollAP(int focusUsed);
         bool movePlayer(const Vec2i &newPos, bool retreat = false, bool ignoreAdjacent = false);
+        bool movePlayerTo(const Vec2i &target);
         bool retreatPlayer();
 
         void beginRound();
@@ -110,11 +114,19 @@ namespace FTK
         void markEntityDead(const uuids::uuid &entityUUID);
         void markPlayerDead(const uuids::uuid &playerUUID);
 
+        size_t rollFocusedDice(const uuids::uuid &uuid, size_t amount, double chance, int guarantee, int focusUsed);
+
+        void equip(const uuids::uuid &entityUUID, const uuids::uuid &equipmentUUID);
+        void unequip(const uuids::uuid &entityUUID, EquipmentType slot);
+
+        nlohmann::ordered_json toJson() const;
+
         void saveMap(const std::string &path);
         void saveMap(const char *path);
 
         void loadMap(const std::string &path);
         void loadMap(const char *path);
+        void loadMapFromJson(const nlohmann::json &j);
 
         void initGame();
         void restore(bool shouldInit = false);
@@ -124,6 +136,11 @@ namespace FTK
 
     private:
         GameManager() = default;
+        friend class GameSession;
+        friend class GameSnapshot;
+
+        // state is the rest of the map file, the game state of a save
+        void loadMap(const std::shared_ptr<World> &loadedWorld, const nlohmann::json &state);
 
         bool isPosTraversable(const Vec2i &pos);
 
@@ -0,0 +1,88 @@
+#include "GameSession.h"
+
+#include "CommandLog.h"
+#include "EventBus.h"
+#include "GameManager.h"
+#include "IDSource.h"
+#include "Random.h"
+#include "Registry.h"
+#include "combat.h"
+
+namespace FTK
+{
+    thread_local GameSession *GameSession::current = nullptr;
+
+    GameSession::Scope::Scope(GameSession &session) : previous(current)
+    {
+        current = &session;
+    }
+
+    GameSession::Scope::~Scope()
+    {
+        current = previous;
+    }
+
+    GameSession::GameSession() : GameSession(std::make_shared<Random>())
+    {
+    }
+
+    GameSession::GameSession(unsigned int seed) : GameSession(std::make_shared<Random>(seed))
+    {
+    }
+
+    std::shared_ptr<GameManager> GameSession::getGameManager() const
+    {
+        return gameManager;
+    }
+
+    std::shared_ptr<CombatSystem> GameSession::getCombatSystem() const
+    {
+        return combatSystem;
+    }
+
+    std::shared_ptr<EventBus> GameSession::getEventBus() const
+    {
+        return eventBus;
+    }
+
+    std::shared_ptr<Random> GameSession::getRandom() const
+    {
+        return random;
+    }
+
+    std::shared_ptr<CommandLog> GameSession::getCommandLog() const
+    {
+        return commandLog;
+    }
+
+    std::shared_ptr<IDSource> GameSession::getIDSource() const
+    {
+        return idSource;
+    }
+
+    void GameSession::setIDSource(const std::shared_ptr<IDSource> &source)
+    {
+        idSource = source;
+    }
+
+    std::shared_ptr<MainRegistry> GameSession::getRegistry() const
+    {
+        return registry;
+    }
+
+    void GameSession::setRegistry(const std::shared_ptr<MainRegistry> &registry)
+    {
+        this->registry = registry;
+    }
+
+    GameSession *GameSession::getCurrent()
+    {
+        return current;
+    }
+
+    GameSession::GameSession(const std::shared_ptr<Random> &random)
+        : gameManager(new GameManager()), combatSystem(new CombatSystem()), eventBus(new EventBus()), random(random),
+          commandLog(std::make_shared<CommandLog>())
+    {
+    }
+} // namespace FTK
@@ -0,0 +1,67 @@
+#ifndef FTK_GAME_SESSION_H
+#define FTK_GAME_SESSION_H
+
+#include <memory>
+
+namespace FTK
+{
+    class GameManager;
+    class CombatSystem;
+    class EventBus;
+    class Random;
+    class IDSource;
+    class CommandLog;
+    class MainRegistry;
+
+    // One game: its GameManager (world, inventory, turn state), CombatSystem, EventBus, Random and CommandLog,
+    // plus an optional IDSource.
+    // While a Scope is alive on a thread, the getInstance() of those classes resolve to this session,
+    // outside of any scope they resolve to the process-wide instances the single-game front-ends use.
+    // A session must only be entered by one thread at a time.
+    class GameSession
+    {
+    public:
+        class Scope
+        {
+        public:
+            explicit Scope(GameSession &session);
+            Scope(const Scope &other) = delete;
+            ~Scope();
+
+        private:
+            GameSession *previous;
+        };
+
+        GameSession();
+        explicit GameSession(unsigned int seed);
+        GameSession(const GameSession &other) = delete;
+
+        std::shared_ptr<GameManager> getGameManager() const;
+        std::shared_ptr<CombatSystem> getCombatSystem() const;
+        std::shared_ptr<EventBus> getEventBus() const;
+        std::shared_ptr<Random> getRandom() const;
+        std::shared_ptr<CommandLog> getCommandLog() const;
+        std::shared_ptr<IDSource> getIDSource() const;
+        void setIDSource(const std::shared_ptr<IDSource> &source);
+        // the registry snapshot pinned by MainRegistry::pin, null when none is
+        std::shared_ptr<MainRegistry> getRegistry() const;
+        void setRegistry(const std::shared_ptr<MainRegistry> &registry);
+
+        static GameSession *getCurrent();
+
+    private:
+        GameSession(const std::shared_ptr<Random> &random);
+
+        std::shared_ptr<GameManager> gameManager;
+        std::shared_ptr<CombatSystem> combatSystem;
+        std::shared_ptr<EventBus> eventBus;
+        std::shared_ptr<Random> random;
+        std::shared_ptr<CommandLog> commandLog;
+        std::shared_ptr<IDSource> idSource;
+        std::shared_ptr<MainRegistry> registry;
+
+        static thread_local GameSession *current;
+    };
+} // namespace FTK
+
+#endif // FTK_GAME_SESSION_H
@@ -0,0 +1,208 @@
+#include "GameSnapshot.h"
+
+#include <unordered_map>
+
+#include "utils.h"
+
+namespace FTK
+{
+    std::shared_ptr<const GameSnapshot> GameSnapshot::capture(const std::shared_ptr<const GameSnapshot> &previous)
+    {
+        auto gameMgr = GameManager::getInstance();
+        auto combatSys = CombatSystem::getInstance();
+        auto res = std::shared_ptr<GameSnapshot>(new GameSnapshot());
+
+        if (auto world = gameMgr->world)
+        {
+            res->hasWorld = true;
+            res->dimension = world->dimension;
+            res->visibility = std::make_shared<VisibilityMap>(world->visibility);
+            res->terrainVersion = world->terrainVersion;
+
+            std::unordered_map<uuids::uuid, std::shared_ptr<const Entity>> frozen;
+            if (previous)
+            {
+                for (auto &e : previous->entities)
+                    frozen.emplace(e->uuid, e);
+                for (auto &ep : previous->players)
+                    frozen.emplace(ep->uuid, ep);
+            }
+            auto freeze = [&frozen, &res](const std::shared_ptr<Entity> &e) -> std::shared_ptr<const Entity>
+            {
+                if (auto it = frozen.find(e->uuid); it != frozen.end() && it->second->getRevision() == e->getRevision())
+                {
+                    res->sharedEntities++;
+                    return it->second;
+                }
+                return e->clone();
+            };
+            res->entities.reserve(world->entities.size());
+            for (auto &e : world->entities)
+                res->entities.push_back(freeze(e));
+            res->players.reserve(world->players.size());
+            for (auto &ep : world->players)
+                res->players.push_back(freeze(ep));
+
+            bool reuseChunks = previous && previous->hasWorld && previous->dimension == world->dimension;
+            res->chunks.reserve(world->getChunkCount());
+            for (size_t i = 0; i < world->getChunkCount(); i++)
+            {
+                if (reuseChunks && previous->chunks[i]->revision == world->chunkRevisions[i])
+                {
+                    res->chunks.push_back(previous->chunks[i]);
+                    res->sharedChunks++;
+                    continue;
+                }
+                auto chunk = std::make_shared<Chunk>();
+                chunk->revision = world->chunkRevisions[i];
+                for (auto index : world->getChunkRectIndices(i))
+                    chunk->rects.push_back(world->rects[index]->clone());
+                res->chunks.push_back(chunk);
+            }
+        }
+
+        res->gameState = gameMgr->gameState;
+        res->round = gameMgr->round;
+        res->playerTurnOrder = gameMgr->playerTurnOrder;
+        res->currentPlayerIndex = gameMgr->currentPlayerIndex;
+        res->exploreState = gameMgr->exploreState;
+        res->interactionFlags = gameMgr->interactionFlags;
+        if (gameMgr->inventory)
+            res->inventory = std::make_shared<Inventory>(*gameMgr->inventory);
+
+        res->combatState = combatSys->combatState;
+        if (combatSys->combatState != CombatState::None)
+        {
+            res->combatRound = combatSys->round;
+            res->combatTurn = combatSys->turn;
+            res->actionSelectionType = combatSys->actionSelectionType;
+            res->actionCandidates = combatSys->actionCandidates;
+            res->selectedActionID = combatSys->selectedActionID;
+            res->targetCandidates = combatSys->targetCandidates;
+            res->selectedTarget = combatSys->selectedTarget;
+            res->diceRollResult = combatSys->diceRollResult;
+            res->playerDeaths = combatSys->playerDeaths;
+            res->playersEscaped = combatSys->playersEscaped;
+            res->enemyDeaths = combatSys->enemyDeaths;
+            res->actionPerformed = combatSys->actionPerformed;
+            res->priorities = combatSys->priorities;
+            res->combatPlayers = map<uuids::uuid>(combatSys->players, [](auto ep)
+                                                  { return ep->uuid; });
+            res->combatEnemies = map<uuids::uuid>(combatSys->enemies, [](auto en)
+                                                  { return en->uuid; });
+        }
+
+        res->engine = Random::getInstance()->engine;
+        return res;
+    }
+
+    void GameSnapshot::restore() const
+    {
+        auto gameMgr = GameManager::getInstance();
+        auto combatSys = CombatSystem::getInstance();
+        auto live = gameMgr->world;
+
+        std::shared_ptr<World> world;
+        if (hasWorld)
+        {
+            std::unordered_map<uuids::uuid, std::shared_ptr<Entity>> current;
+            if (live)
+            {
+                for (auto &e : live->entities)
+                    current.emplace(e->uuid, e);
+                for (auto &ep : live->players)
+                    current.emplace(ep->uuid, ep);
+            }
+            auto thaw = [&current](const std::shared_ptr<const Entity> &e)
+            {
+                if (auto it = current.find(e->uuid); it != current.end() && it->second->getRevision() == e->getRevision())
+                    return it->second;
+                return e->clone();
+            };
+            std::vector<std::shared_ptr<Entity>> liveEntities;
+            liveEntities.reserve(entities.size());
+            for (auto &e : entities)
+                liveEntities.push_back(thaw(e));
+            std::vector<std::shared_ptr<Player>> livePlayers;
+            livePlayers.reserve(players.size());
+            for (auto &ep : players)
+                livePlayers.push_back(std::static_pointer_cast<Player>(thaw(ep)));
+
+            bool keepChunks = live && live->dimension == dimension;
+            std::vector<std::shared_ptr<Rect>> rects((size_t)dimension.getX() * dimension.getY());
+            std::vector<uint64_t> chunkRevisions(chunks.size());
+            for (size_t i = 0; i < chunks.size(); i++)
+            {
+                chunkRevisions[i] = chunks[i]->revision;
+                auto indices = World::getChunkRectIndices(dimension, i);
+                if (keepChunks && live->chunkRevisions[i] == chunks[i]->revision)
+                {
+                    for (auto index : indices)
+                        rects[index] = live->rects[index];
+                    continue;
+                }
+                for (size_t k = 0; k < indices.size(); k++)
+                    rects[indices[k]] = chunks[i]->rects[k]->clone();
+            }
+
+            world = std::shared_ptr<World>(new World(dimension, rects, liveEntities, livePlayers, *visibility));
+            world->chunkRevisions = chunkRevisions;
+            // a different terrain must never reuse the version a cache was built against
+            world->terrainVersion = live ? std::max(live->terrainVersion, terrainVersion) + 1 : terrainVersion;
+        }
+
+        gameMgr->world = world;
+        gameMgr->gameState = gameState;
+        gameMgr->round = round;
+        gameMgr->playerTurnOrder = playerTurnOrder;
+        gameMgr->currentPlayerIndex = currentPlayerIndex;
+        gameMgr->exploreState = exploreState;
+        gameMgr->interactionFlags = interactionFlags;
+        gameMgr->inventory = inventory ? std::make_shared<Inventory>(*inventory) : nullptr;
+
+        combatSys->reset();
+        if (combatState != CombatState::None)
+        {
+            combatSys->round = combatRound;
+            combatSys->turn = combatTurn;
+            combatSys->actionSelectionType = actionSelectionType;
+            combatSys->actionCandidates = actionCandidates;
+            combatSys->selectedActionID = selectedActionID;
+            combatSys->targetCandidates = targetCandidates;
+            combatSys->selectedTarget = selectedTarget;
+            combatSys->diceRollResult = diceRollResult;
+            combatSys->playerDeaths = playerDeaths;
+            combatSys->playersEscaped = playersEscaped;
+            combatSys->enemyDeaths = enemyDeaths;
+            combatSys->actionPerformed = actionPerformed;
+            combatSys->priorities = priorities;
+            for (auto &uuid : combatPlayers)
+                combatSys->players.push_back(world->getPlayerByUUID(uuid));
+            for (auto &uuid : combatEnemies)
+                combatSys->enemies.push_back(std::static_pointer_cast<Enemy>(world->getEntityByUUID(uuid)));
+            combatSys->setCombatState(combatState);
+        }
+
+        Random::getInstance()->engine = engine;
+    }
+
+    size_t GameSnapshot::getEntityCount() const
+    {
+        return entities.size() + players.size();
+    }
+
+    size_t GameSnapshot::getChunkCount() const
+    {
+        return chunks.size();
+    }
+
+    size_t GameSnapshot::getSharedEntityCount() const
+    {
+        return sharedEntities;
+    }
+
+    size_t GameSnapshot::getSharedChunkCount() const
+    {
+        return sharedChunks;
+    }
+} // namespace FTK
@@ -0,0 +1,81 @@
+#ifndef FTK_GAME_SNAPSHOT_H
+#define FTK_GAME_SNAPSHOT_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "GameManager.h"
+#include "Random.h"
+#include "combat.h"
+
+namespace FTK
+{
+    // A frozen copy of the current game: world, inventory, explore state, combat state and random engine.
+    // Entities and rect chunks are stamped with revisions, a capture shares every one whose revision is
+    // unchanged since the previous snapshot and a restore keeps every live one already at the snapshot's
+    // revision, so both only copy what changed in between. This makes undo stacks and search trees cheap;
+    // for a what-if fork, restore the snapshot inside another GameSession.
+    class GameSnapshot
+    {
+    public:
+        static std::shared_ptr<const GameSnapshot> capture(const std::shared_ptr<const GameSnapshot> &previous = nullptr);
+
+        void restore() const;
+
+        size_t getEntityCount() const;
+        size_t getChunkCount() const;
+        // entities and chunks taken over from the previous snapshot
+        size_t getSharedEntityCount() const;
+        size_t getSharedChunkCount() const;
+
+    private:
+        GameSnapshot() = default;
+
+        struct Chunk
+        {
+            uint64_t revision;
+            std::vector<std::shared_ptr<const Rect>> rects;
+        };
+
+        bool hasWorld = false;
+        Vec2i dimension;
+        std::vector<std::shared_ptr<const Entity>> entities;
+        std::vector<std::shared_ptr<const Entity>> players;
+        std::vector<std::shared_ptr<const Chunk>> chunks;
+        std::shared_ptr<const VisibilityMap> visibility;
+        size_t terrainVersion = 0;
+        size_t sharedEntities = 0;
+        size_t sharedChunks = 0;
+
+        GameState gameState = GameState::None;
+        size_t round = 0;
+        std::vector<uuids::uuid> playerTurnOrder;
+        size_t currentPlayerIndex = 0;
+        ExploreState exploreState = ExploreState::None;
+        InteractionFlags interactionFlags = InteractionFlag_None;
+        std::shared_ptr<const Inventory> inventory;
+
+        CombatState combatState = CombatState::None;
+        size_t combatRound = 0;
+        size_t combatTurn = 0;
+        ActionSelectionType actionSelectionType = ActionSelectionType::Skill;
+        std::vector<std::string> actionCandidates;
+        std::string selectedActionID;
+        std::vector<uuids::uuid> targetCandidates;
+        uuids::uuid selectedTarget;
+        size_t diceRollResult = 0;
+        std::set<uuids::uuid> playerDeaths;
+        std::set<uuids::uuid> playersEscaped;
+        std::set<uuids::uuid> enemyDeaths;
+        std::map<uuids::uuid, size_t> actionPerformed;
+        std::vector<uuids::uuid> priorities;
+        std::vector<uuids::uuid> combatPlayers;
+        std::vector<uuids::uuid> combatEnemies;
+
+        Random::Engine engine;
+    };
+} // namespace FTK
+
+#endif // FTK_GAME_SNAPSHOT_H
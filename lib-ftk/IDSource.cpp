@@ -0,0 +1,71 @@
+#include "IDSource.h"
+
+#include <array>
+
+#include "GameSession.h"
+
+namespace FTK
+{
+    uuids::uuid IDSource::generate()
+    {
+        return getInstance()->next();
+    }
+
+    uuids::uuid IDSource::fromBits(unsigned long long high, unsigned long long low)
+    {
+        std::array<uint8_t, 16> bytes;
+        for (size_t k = 0; k < 8; k++)
+        {
+            bytes[k] = (uint8_t)(high >> (k * 8));
+            bytes[k + 8] = (uint8_t)(low >> (k * 8));
+        }
+        // stamp version 4 / variant 1 so the result is indistinguishable from a random uuid
+        bytes[6] = (bytes[6] & 0x0F) | 0x40;
+        bytes[8] = (bytes[8] & 0x3F) | 0x80;
+        return uuids::uuid(bytes.begin(), bytes.end());
+    }
+
+    const std::shared_ptr<IDSource> IDSource::getInstance()
+    {
+        if (auto session = GameSession::getCurrent(); session && session->getIDSource())
+            return session->getIDSource();
+        return instance();
+    }
+
+    void IDSource::setInstance(const std::shared_ptr<IDSource> &source)
+    {
+        if (auto session = GameSession::getCurrent())
+            session->setIDSource(source);
+        else
+            instance() = source ? source : std::make_shared<SystemIDSource>();
+    }
+
+    std::shared_ptr<IDSource> &IDSource::instance()
+    {
+        static std::shared_ptr<IDSource> current = std::make_shared<SystemIDSource>();
+        return current;
+    }
+
+    uuids::uuid SystemIDSource::next()
+    {
+        return uuids::uuid_system_generator{}();
+    }
+
+    SeededIDSource::SeededIDSource(unsigned long long seed) : state(seed)
+    {
+    }
+
+    uuids::uuid SeededIDSource::next()
+    {
+        auto s = state.fetch_add(2 * 0x9E3779B97F4A7C15ull, std::memory_order_relaxed);
+        return fromBits(mix(s + 0x9E3779B97F4A7C15ull), mix(s + 2 * 0x9E3779B97F4A7C15ull));
+    }
+
+    unsigned long long SeededIDSource::mix(unsigned long long state)
+    {
+        auto z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+} // namespace FTK
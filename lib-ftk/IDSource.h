@@ -0,0 +1,54 @@
+#ifndef FTK_ID_SOURCE_H
+#define FTK_ID_SOURCE_H
+
+#include <atomic>
+#include <memory>
+
+#include <uuid.h>
+
+namespace FTK
+{
+    // Where freshly constructed modifiers, buffs, equipment, entities and rects get their uuid from.
+    // The system source is the default, simulations and benchmarks can install a seeded one so that
+    // template instantiation does not touch the OS entropy pool and runs are reproducible.
+    // Inside a GameSession::Scope, getInstance and setInstance act on the session's source, which falls back to the
+    // process-wide one until set. The process-wide source is expected to be set before any worker threads start.
+    class IDSource
+    {
+    public:
+        virtual ~IDSource() = default;
+
+        virtual uuids::uuid next() = 0;
+
+        static uuids::uuid generate();
+        static uuids::uuid fromBits(unsigned long long high, unsigned long long low);
+
+        static const std::shared_ptr<IDSource> getInstance();
+        static void setInstance(const std::shared_ptr<IDSource> &source);
+
+    private:
+        static std::shared_ptr<IDSource> &instance();
+    };
+
+    class SystemIDSource : public IDSource
+    {
+    public:
+        uuids::uuid next() override;
+    };
+
+    // splitmix64 over an atomic counter, every call is one fetch_add plus a few multiplies
+    class SeededIDSource : public IDSource
+    {
+    public:
+        explicit SeededIDSource(unsigned long long seed);
+
+        uuids::uuid next() override;
+
+        static unsigned long long mix(unsigned long long state);
+
+    private:
+        std::atomic<unsigned long long> state;
+    };
+} // namespace FTK
+
+#endif // FTK_ID_SOURCE_H
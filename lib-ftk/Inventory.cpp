@@ -37,6 +37,16 @@ namespace FTK
         return equipments;
     }
 
+    const std::multiset<ItemData> &Inventory::viewItems() const
+    {
+        return items;
+    }
+
+    const std::multiset<Equipment> &Inventory::viewEquipments() const
+    {
+        return equipments;
+    }
+
     int Inventory::getItemAmount(const std::string &itemID)
     {
         for (auto i : items)
@@ -17,6 +17,9 @@ namespace FTK
         std::multiset<ItemData> getItems() const;
         std::multiset<Equipment> getEquipments() const;
 
+        const std::multiset<ItemData> &viewItems() const;
+        const std::multiset<Equipment> &viewEquipments() const;
+
         int getItemAmount(const std::string &itemID);
 
         void setGold(int newValue);
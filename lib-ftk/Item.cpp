@@ -1,6 +1,7 @@
 #include "Item.h"
 
 #include "utils.h"
+#include "IDSource.h"
 #include "Action.h"
 
 namespace FTK
@@ -39,7 +40,7 @@ namespace FTK
         }
     }
 
-    Equipment::Equipment(const std::string &id, const std::map<std::string, std::multiset<Modifier>> &modifierData) : Equipment(uuids::uuid_system_generator{}(), id, {}, modifierData)
+    Equipment::Equipment(const std::string &id, const std::map<std::string, std::multiset<Modifier>> &modifierData) : Equipment(IDSource::generate(), id, {}, modifierData)
     {
     }
 
@@ -0,0 +1,315 @@
+#include "MapLoader.h"
+
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "Serializer.h"
+
+namespace FTK
+{
+    class MapLoader::Handler : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        explicit Handler(bool worldOnly = false) : next(worldOnly ? State::World : State::Document)
+        {
+        }
+
+        bool null() override
+        {
+            return value(nullptr);
+        }
+
+        bool boolean(bool val) override
+        {
+            return value(val);
+        }
+
+        bool number_integer(number_integer_t val) override
+        {
+            return value(val);
+        }
+
+        bool number_unsigned(number_unsigned_t val) override
+        {
+            return value(val);
+        }
+
+        bool number_float(number_float_t val, const string_t &s) override
+        {
+            return value(val);
+        }
+
+        bool string(string_t &val) override
+        {
+            if (!routeToSink() && currentState() == State::Pattern)
+            {
+                pattern.push_back(std::move(val));
+                return true;
+            }
+            return value(std::move(val));
+        }
+
+        bool binary(binary_t &val) override
+        {
+            return value(nlohmann::json::binary(std::move(val)));
+        }
+
+        bool start_object(std::size_t elements) override
+        {
+            if (routeToSink())
+                return beginCapture(nlohmann::json::object());
+            return enter(true);
+        }
+
+        bool key(string_t &val) override
+        {
+            if (!stack.empty())
+            {
+                capturedKey = val;
+                return true;
+            }
+            switch (currentState())
+            {
+            case State::Document:
+                if (val == "world")
+                    next = State::World;
+                else
+                    sink = [this, val](nlohmann::json &&v)
+                    { result.state[val] = std::move(v); };
+                break;
+            case State::World:
+                if (val == "pattern")
+                    next = State::Pattern;
+                else if (val == "key")
+                    next = State::Key;
+                else if (val == "entities")
+                {
+                    next = State::List;
+                    elementSink = [this](nlohmann::json &&v)
+                    { entities.push_back(v.get<std::shared_ptr<Entity>>()); };
+                }
+                else if (val == "players")
+                {
+                    next = State::List;
+                    elementSink = [this](nlohmann::json &&v)
+                    { players.push_back(v.get<std::shared_ptr<Player>>()); };
+                }
+                else if (val == "rect_entities")
+                {
+                    next = State::List;
+                    elementSink = [this](nlohmann::json &&v)
+                    { rectEntities.push_back(v.get<std::shared_ptr<RectEntity>>()); };
+                }
+                else
+                    sink = [this, val](nlohmann::json &&v)
+                    { worldFields[val] = std::move(v); };
+                break;
+            case State::Key:
+                sink = [this, val](nlohmann::json &&v)
+                {
+                    // the pattern has one byte per rect, longer symbols can never match
+                    if (val.size() == 1)
+                        symbols.set(val[0], v.get<Rect>());
+                };
+                break;
+            default:
+                throw std::invalid_argument("Unexpected key '" + val + "' in map");
+            }
+            return true;
+        }
+
+        bool end_object() override
+        {
+            return leave();
+        }
+
+        bool start_array(std::size_t elements) override
+        {
+            if (routeToSink())
+                return beginCapture(nlohmann::json::array());
+            return enter(false);
+        }
+
+        bool end_array() override
+        {
+            return leave();
+        }
+
+        bool parse_error(std::size_t position, const std::string &lastToken, const nlohmann::detail::exception &ex) override
+        {
+            throw std::invalid_argument("Map parse error at byte " + std::to_string(position) + ": " + ex.what());
+        }
+
+        LoadedMap finish()
+        {
+            if (next != State::End)
+                throw std::invalid_argument("Incomplete map data");
+            if (!worldFields.contains("dimension"))
+                throw std::invalid_argument("Map has no world");
+            const auto dimension = worldFields["dimension"].get<Vec2i>();
+            const auto visibility = worldFields.contains("visibility_rle")
+                                        ? VisibilityMap::decode(dimension, worldFields["visibility_rle"].get<std::vector<size_t>>())
+                                    : worldFields.contains("visibility")
+                                        ? VisibilityMap::fromRows(dimension, worldFields["visibility"].get<std::vector<std::string>>())
+                                        : VisibilityMap(dimension);
+
+            auto rects = symbols.build(dimension, pattern);
+            pattern.clear();
+            for (auto &re : rectEntities)
+                rects[re->pos.getY() * dimension.getX() + re->pos.getX()]->attachRectEntity(re);
+
+            result.world = std::shared_ptr<World>(new World(dimension, rects, entities, players, visibility));
+            return std::move(result);
+        }
+
+    private:
+        enum class State
+        {
+            None,
+            Document,
+            World,
+            Pattern,
+            Key,
+            List,
+            End
+        };
+
+        using Sink = std::function<void(nlohmann::json &&)>;
+
+        State currentState() const
+        {
+            return states.empty() ? State::None : states.back();
+        }
+
+        // whether the coming value is read into json, every element of a list is
+        bool routeToSink()
+        {
+            if (!stack.empty() || sink)
+                return true;
+            if (currentState() == State::List)
+            {
+                sink = elementSink;
+                return true;
+            }
+            return false;
+        }
+
+        bool value(nlohmann::json &&v)
+        {
+            if (!routeToSink())
+                throw std::invalid_argument("Unexpected value in map");
+            if (stack.empty())
+            {
+                auto s = std::move(sink);
+                sink = nullptr;
+                s(std::move(v));
+                return true;
+            }
+            auto &top = *stack.back();
+            if (top.is_array())
+                top.push_back(std::move(v));
+            else
+                top[capturedKey] = std::move(v);
+            return true;
+        }
+
+        bool beginCapture(nlohmann::json &&container)
+        {
+            if (stack.empty())
+            {
+                captured = std::move(container);
+                stack.push_back(&captured);
+                return true;
+            }
+            auto &top = *stack.back();
+            if (top.is_array())
+            {
+                top.push_back(std::move(container));
+                stack.push_back(&top.back());
+            }
+            else
+                stack.push_back(&(top[capturedKey] = std::move(container)));
+            return true;
+        }
+
+        bool enter(bool object)
+        {
+            auto state = next;
+            next = State::None;
+            auto isObject = state == State::Document || state == State::World || state == State::Key;
+            auto isArray = state == State::Pattern || state == State::List;
+            if ((object && !isObject) || (!object && !isArray))
+                throw std::invalid_argument("Unexpected structure in map");
+            states.push_back(state);
+            return true;
+        }
+
+        bool leave()
+        {
+            if (!stack.empty())
+            {
+                stack.pop_back();
+                if (stack.empty())
+                {
+                    auto s = std::move(sink);
+                    sink = nullptr;
+                    s(std::move(captured));
+                    captured = nullptr;
+                }
+                return true;
+            }
+            states.pop_back();
+            if (states.empty())
+                next = State::End;
+            return true;
+        }
+
+        LoadedMap result;
+        std::vector<State> states;
+        State next;
+
+        Sink sink;
+        Sink elementSink;
+        nlohmann::json captured;
+        std::vector<nlohmann::json *> stack;
+        std::string capturedKey;
+
+        nlohmann::json worldFields = nlohmann::json::object();
+        std::vector<std::string> pattern;
+        RectSymbolTable symbols;
+        std::vector<std::shared_ptr<Entity>> entities;
+        std::vector<std::shared_ptr<Player>> players;
+        std::vector<std::shared_ptr<RectEntity>> rectEntities;
+    };
+
+    LoadedMap MapLoader::load(std::istream &is)
+    {
+        Handler handler;
+        nlohmann::json::sax_parse(is, &handler);
+        return handler.finish();
+    }
+
+    std::shared_ptr<World> MapLoader::loadWorld(std::istream &is)
+    {
+        Handler handler(true);
+        nlohmann::json::sax_parse(is, &handler);
+        return handler.finish().world;
+    }
+
+    std::shared_ptr<World> MapLoader::loadWorldFromText(const std::string &text)
+    {
+        Handler handler(true);
+        nlohmann::json::sax_parse(text.begin(), text.end(), &handler);
+        return handler.finish().world;
+    }
+
+    LoadedMap MapLoader::load(const std::string &path)
+    {
+        std::ifstream ifs(path);
+        if (!ifs)
+            throw std::invalid_argument("Cannot open map " + path);
+        return load(ifs);
+    }
+} // namespace FTK
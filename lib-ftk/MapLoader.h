@@ -0,0 +1,39 @@
+#ifndef FTK_MAP_LOADER_H
+#define FTK_MAP_LOADER_H
+
+#include <istream>
+#include <memory>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "World.h"
+
+namespace FTK
+{
+    struct LoadedMap
+    {
+        std::shared_ptr<World> world;
+        // every field of the file besides "world", the game state of a save
+        nlohmann::json state = nlohmann::json::object();
+    };
+
+    // Reads maps and saves through nlohmann's SAX interface instead of parsing them into one document.
+    // Pattern rows are kept as plain strings and the key as a RectSymbolTable. Entities, players and rect
+    // entities are built as soon as each one has been read, and only that one is held as json meanwhile.
+    class MapLoader
+    {
+    public:
+        static LoadedMap load(std::istream &is);
+        static LoadedMap load(const std::string &path);
+        // a document that is the world object itself
+        static std::shared_ptr<World> loadWorld(std::istream &is);
+        // the same from text already in memory, parsed in place without copying it into a stream
+        static std::shared_ptr<World> loadWorldFromText(const std::string &text);
+
+    private:
+        class Handler;
+    };
+} // namespace FTK
+
+#endif // FTK_MAP_LOADER_H
@@ -1,8 +1,10 @@
 #include "Modifier.h"
 
+#include "IDSource.h"
+
 namespace FTK
 {
-    Modifier::Modifier(const std::string &name, ModifierType type, double value) : Modifier(uuids::uuid_system_generator{}(), name, type, value)
+    Modifier::Modifier(const std::string &name, ModifierType type, double value) : Modifier(IDSource::generate(), name, type, value)
     {
     }
 
@@ -117,6 +119,18 @@ namespace FTK
         }
     }
 
+    void ModifiableValue::updateModifiers(const std::vector<Modifier> &added, const std::vector<uuids::uuid> &removed)
+    {
+        for (auto &uuid : removed)
+            if (auto it = std::find_if(modifiers.begin(), modifiers.end(), [&uuid](const Modifier &mod)
+                                       { return mod.uuid == uuid; });
+                it != modifiers.end())
+                modifiers.erase(it);
+        for (auto &mod : added)
+            modifiers.insert(mod);
+        eval();
+    }
+
     void ModifiableValue::eval()
     {
         double res = base;
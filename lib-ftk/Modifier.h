@@ -80,6 +80,7 @@ namespace FTK
 
         virtual void addModifier(const Modifier &mod);
         virtual void removeModifier(const uuids::uuid &uuid);
+        virtual void updateModifiers(const std::vector<Modifier> &added, const std::vector<uuids::uuid> &removed);
 
     protected:
         virtual void eval();
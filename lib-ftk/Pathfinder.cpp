@@ -0,0 +1,197 @@
+#include "Pathfinder.h"
+
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <tuple>
+
+#include "defs.h"
+#include "World.h"
+
+namespace FTK
+{
+    Pathfinder::Pathfinder(const World &world) : world(world), version(0)
+    {
+    }
+
+    const std::vector<int> &Pathfinder::getDistanceField(const Vec2i &origin)
+    {
+        refresh();
+        auto from = toIndex(origin);
+        if (auto it = fields.find(from); it != fields.end())
+            return it->second;
+        if (fields.size() >= MaxCachedFields)
+            fields.clear();
+
+        auto &field = fields[from];
+        field.assign(passable.size(), Unreachable);
+        if (from < 0 || !passable[from])
+            return field;
+
+        std::deque<int> open{from};
+        field[from] = 0;
+        while (!open.empty())
+        {
+            auto cur = open.front();
+            open.pop_front();
+            if (!canLeave(cur, from))
+                continue;
+            auto pos = toPos(cur);
+            for (auto dir : Directions)
+            {
+                auto next = toIndex(pos + dir);
+                if (next < 0 || !passable[next] || field[next] != Unreachable)
+                    continue;
+                field[next] = field[cur] + 1;
+                open.push_back(next);
+            }
+        }
+        return field;
+    }
+
+    int Pathfinder::getDistance(const Vec2i &from, const Vec2i &to)
+    {
+        auto target = toIndex(to);
+        if (target < 0)
+            return Unreachable;
+        return getDistanceField(from)[target];
+    }
+
+    std::vector<Vec2i> Pathfinder::getReachable(const Vec2i &origin, int maxSteps)
+    {
+        std::vector<Vec2i> res;
+        auto &field = getDistanceField(origin);
+        for (int i = 0; i < (int)field.size(); i++)
+            if (field[i] > 0 && field[i] <= maxSteps)
+                res.push_back(toPos(i));
+        return res;
+    }
+
+    std::vector<Vec2i> Pathfinder::findPath(const Vec2i &from, const Vec2i &to)
+    {
+        refresh();
+        auto start = toIndex(from);
+        auto goal = toIndex(to);
+        if (start < 0 || goal < 0 || !passable[start] || !passable[goal])
+            return {};
+        if (auto it = fields.find(start); it != fields.end())
+            return tracePath(it->second, start, goal);
+        return searchPath(start, goal);
+    }
+
+    void Pathfinder::invalidate()
+    {
+        fields.clear();
+        version = world.getTerrainVersion();
+        auto width = world.dimension.getX();
+        auto height = world.dimension.getY();
+        passable.assign(width * height, 0);
+        stops.assign(width * height, 0);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+            {
+                auto rect = world.getRectAt(x, y);
+                passable[y * width + x] = rect->traversable();
+                stops[y * width + x] = rect->hasRectEntity();
+            }
+        for (auto &e : world.entities)
+            if (auto index = toIndex(e->getPos()); index >= 0)
+                stops[index] = 1;
+    }
+
+    void Pathfinder::refresh()
+    {
+        if (version != world.getTerrainVersion() || passable.size() != (size_t)(world.dimension.getX() * world.dimension.getY()))
+            invalidate();
+    }
+
+    bool Pathfinder::canLeave(int index, int origin) const
+    {
+        return index == origin || !stops[index];
+    }
+
+    int Pathfinder::toIndex(const Vec2i &pos) const
+    {
+        if (!world.inBound(pos))
+            return -1;
+        return pos.getY() * world.dimension.getX() + pos.getX();
+    }
+
+    Vec2i Pathfinder::toPos(int index) const
+    {
+        return Vec2i(index % world.dimension.getX(), index / world.dimension.getX());
+    }
+
+    std::vector<Vec2i> Pathfinder::tracePath(const std::vector<int> &field, int from, int to) const
+    {
+        if (field[to] == Unreachable)
+            return {};
+        std::vector<Vec2i> res;
+        auto cur = to;
+        while (cur != from)
+        {
+            res.push_back(toPos(cur));
+            auto pos = toPos(cur);
+            for (auto dir : Directions)
+            {
+                auto prev = toIndex(pos + dir);
+                if (prev >= 0 && field[prev] == field[cur] - 1 && canLeave(prev, from))
+                {
+                    cur = prev;
+                    break;
+                }
+            }
+        }
+        std::reverse(res.begin(), res.end());
+        return res;
+    }
+
+    // A* with the Manhattan distance as heuristic, ties are broken by insertion order so results are stable
+    std::vector<Vec2i> Pathfinder::searchPath(int from, int to) const
+    {
+        auto target = toPos(to);
+        auto heuristic = [&target, this](int index)
+        {
+            auto d = toPos(index) - target;
+            return std::abs(d.getX()) + std::abs(d.getY());
+        };
+
+        using Entry = std::tuple<int, size_t, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        std::vector<int> cost(passable.size(), Unreachable);
+        std::vector<int> parent(passable.size(), -1);
+        size_t counter = 0;
+
+        cost[from] = 0;
+        open.emplace(heuristic(from), counter++, from);
+        while (!open.empty())
+        {
+            auto [f, order, cur] = open.top();
+            open.pop();
+            if (cur == to)
+                break;
+            if (f - heuristic(cur) > cost[cur] || !canLeave(cur, from))
+                continue;
+            auto pos = toPos(cur);
+            for (auto dir : Directions)
+            {
+                auto next = toIndex(pos + dir);
+                if (next < 0 || !passable[next])
+                    continue;
+                if (cost[next] != Unreachable && cost[next] <= cost[cur] + 1)
+                    continue;
+                cost[next] = cost[cur] + 1;
+                parent[next] = cur;
+                open.emplace(cost[next] + heuristic(next), counter++, next);
+            }
+        }
+        if (cost[to] == Unreachable)
+            return {};
+
+        std::vector<Vec2i> res;
+        for (auto cur = to; cur != from; cur = parent[cur])
+            res.push_back(toPos(cur));
+        std::reverse(res.begin(), res.end());
+        return res;
+    }
+} // namespace FTK
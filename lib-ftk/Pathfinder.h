@@ -0,0 +1,51 @@
+#ifndef FTK_PATHFINDER_H
+#define FTK_PATHFINDER_H
+
+#include <map>
+#include <vector>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    class World;
+
+    // Movement queries over a world's rects, one step costs one AP.
+    // Rocks are impassable; cells holding an enemy or a rect entity can be entered but not
+    // passed through, since entering them starts an interaction. The origin is always left freely.
+    // Distance fields are cached per origin and dropped whenever the world's terrain version changes.
+    class Pathfinder
+    {
+    public:
+        explicit Pathfinder(const World &world);
+        Pathfinder(const Pathfinder &other) = delete;
+
+        const std::vector<int> &getDistanceField(const Vec2i &origin);
+        int getDistance(const Vec2i &from, const Vec2i &to);
+
+        std::vector<Vec2i> getReachable(const Vec2i &origin, int maxSteps);
+        std::vector<Vec2i> findPath(const Vec2i &from, const Vec2i &to);
+
+        void invalidate();
+
+        static constexpr int Unreachable = -1;
+        static constexpr size_t MaxCachedFields = 16;
+
+    private:
+        void refresh();
+        bool canLeave(int index, int origin) const;
+        int toIndex(const Vec2i &pos) const;
+        Vec2i toPos(int index) const;
+
+        std::vector<Vec2i> tracePath(const std::vector<int> &field, int from, int to) const;
+        std::vector<Vec2i> searchPath(int from, int to) const;
+
+        const World &world;
+        size_t version;
+        std::vector<char> passable;
+        std::vector<char> stops;
+        std::map<int, std::vector<int>> fields;
+    };
+} // namespace FTK
+
+#endif // FTK_PATHFINDER_H
@@ -0,0 +1,58 @@
+#include "Random.h"
+
+#include <sstream>
+
+#include "GameSession.h"
+
+namespace FTK
+{
+    Random::Random()
+    {
+        reseed();
+    }
+
+    Random::Random(Engine::result_type seed) : engine(seed)
+    {
+    }
+
+    bool Random::chance(double probability)
+    {
+        return std::bernoulli_distribution(probability)(engine);
+    }
+
+    Random::Engine::result_type Random::next()
+    {
+        return engine();
+    }
+
+    void Random::seed(Engine::result_type seed)
+    {
+        engine.seed(seed);
+    }
+
+    void Random::reseed()
+    {
+        engine.seed(std::random_device()());
+    }
+
+    std::string Random::serialize() const
+    {
+        std::stringstream ss;
+        ss << engine;
+        return ss.str();
+    }
+
+    void Random::deserialize(const std::string &state)
+    {
+        std::stringstream ss(state);
+        ss >> engine;
+    }
+
+    const std::shared_ptr<Random> Random::getInstance()
+    {
+        if (auto session = GameSession::getCurrent())
+            return session->getRandom();
+        static const auto instance = std::make_shared<Random>();
+        return instance;
+    }
+} // namespace FTK
@@ -0,0 +1,48 @@
+#ifndef FTK_RANDOM_H
+#define FTK_RANDOM_H
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace FTK
+{
+    // The game's random source. Each GameSession owns one; getInstance() resolves to the session running
+    // on the calling thread, or to a process-wide source outside of any session.
+    // Draws use the same engine and distributions as the random library this replaced, so older saves keep their sequences.
+    class Random
+    {
+    public:
+        using Engine = std::mt19937;
+
+        Random();
+        explicit Random(Engine::result_type seed);
+        Random(const Random &other) = delete;
+
+        bool chance(double probability);
+        Engine::result_type next();
+
+        template <class Container>
+        void shuffle(Container &container)
+        {
+            std::shuffle(std::begin(container), std::end(container), engine);
+        }
+
+        void seed(Engine::result_type seed);
+        void reseed();
+
+        std::string serialize() const;
+        void deserialize(const std::string &state);
+
+        static const std::shared_ptr<Random> getInstance();
+
+    private:
+        Engine engine;
+
+        friend class GameSnapshot;
+    };
+} // namespace FTK
+
+#endif // FTK_RANDOM_H
@@ -1,10 +1,12 @@
 #include "Rect.h"
 
+#include "CommandLog.h"
+#include "IDSource.h"
 #include "Registry.h"
 #include "GameManager.h"
 namespace FTK
 {
-    RectEntity::RectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos) : RectEntity(uuids::uuid_system_generator{}(), id, name, type, pos)
+    RectEntity::RectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos) : RectEntity(IDSource::generate(), id, name, type, pos)
     {
     }
 
@@ -12,6 +14,11 @@ namespace FTK
     {
     }
 
+    std::shared_ptr<RectEntity> RectEntity::clone() const
+    {
+        return std::shared_ptr<RectEntity>(new RectEntity(uuid, id, name, type, pos));
+    }
+
     void RectEntity::onInteract(const std::shared_ptr<Player> &ep)
     {
     }
@@ -26,7 +33,7 @@ namespace FTK
         return "rect_entity";
     }
 
-    ShopRectEntity::ShopRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::shared_ptr<Inventory> inventory) : ShopRectEntity(uuids::uuid_system_generator{}(), id, name, type, pos, inventory)
+    ShopRectEntity::ShopRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::shared_ptr<Inventory> inventory) : ShopRectEntity(IDSource::generate(), id, name, type, pos, inventory)
     {
     }
 
@@ -34,6 +41,11 @@ namespace FTK
     {
     }
 
+    std::shared_ptr<RectEntity> ShopRectEntity::clone() const
+    {
+        return std::shared_ptr<RectEntity>(new ShopRectEntity(uuid, id, name, type, pos, std::make_shared<Inventory>(*inventory)));
+    }
+
     void ShopRectEntity::onInteract(const std::shared_ptr<Player> &ep)
     {
     }
@@ -45,21 +57,25 @@ namespace FTK
 
     void ShopRectEntity::buyItem(const std::string &id, int price, int amount)
     {
+        CommandLog::Scope logScope(CommandType::BuyItem, pos, id, price, amount);
         auto inv = GameManager::getInstance()->getInventory();
         if (inv->getGold() < price * amount)
             return;
         inv->decreaseGold(price * amount);
         inventory->removeItem(id, amount);
         inv->addItem(id, amount);
+        GameManager::getInstance()->getWorld()->markRectChanged(pos);
     }
 
     void ShopRectEntity::buyEquipment(const uuids::uuid &uuid, int price)
     {
+        CommandLog::Scope logScope(CommandType::BuyEquipment, pos, uuid, price);
         auto inv = GameManager::getInstance()->getInventory();
         if (inv->getGold() < price)
             return;
         inv->decreaseGold(price);
         inv->addEquipment(inventory->removeEquipment(uuid));
+        GameManager::getInstance()->getWorld()->markRectChanged(pos);
     }
 
     ShopRectEntity::ShopRectEntity(const uuids::uuid &uuid, const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::shared_ptr<Inventory> inventory)
@@ -87,7 +103,7 @@ namespace FTK
         return "shop_rect_entity";
     }
 
-    RestRectEntity::RestRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::vector<std::shared_ptr<Action>> &restActions, const Math::Condition &restCondition) : RestRectEntity(uuids::uuid_system_generator{}(), id, name, type, pos, restActions, restCondition)
+    RestRectEntity::RestRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::vector<std::shared_ptr<Action>> &restActions, const Math::Condition &restCondition) : RestRectEntity(IDSource::generate(), id, name, type, pos, restActions, restCondition)
     {
     }
 
@@ -95,6 +111,11 @@ namespace FTK
     {
     }
 
+    std::shared_ptr<RectEntity> RestRectEntity::clone() const
+    {
+        return std::make_shared<RestRectEntity>(*this);
+    }
+
     void RestRectEntity::onInteract(const std::shared_ptr<Player> &ep)
     {
     }
@@ -109,41 +130,67 @@ namespace FTK
         return "rest_rect_entity";
     }
 
-    Rect::Rect(const std::string &id, int metadata) : Rect(id, metadata, false)
+    Rect::Rect(const std::string &id, int metadata) : id(id), metadata(metadata)
     {
     }
 
-    Rect::Rect(const std::string &id, int metadata, bool visible) : id(id), metadata(metadata), visible(visible)
+    Rect::Rect(const Rect &other) : Rect(other.id, other.metadata)
     {
     }
 
-    Rect::Rect(const Rect &other) : Rect(other.id, other.metadata, other.visible)
+    std::shared_ptr<Rect> Rect::clone() const
     {
+        auto res = std::make_shared<Rect>(*this);
+        if (rectEntity)
+            res->rectEntity = rectEntity->clone();
+        return res;
     }
 
-    std::string Rect::getID() const
+    void RectSymbolTable::set(char symbol, const Rect &rect)
     {
-        return id;
+        rects[(unsigned char)symbol].emplace(rect);
     }
 
-    int Rect::getMetadata() const
+    const Rect *RectSymbolTable::find(char symbol) const
     {
-        return metadata;
+        auto &rect = rects[(unsigned char)symbol];
+        return rect ? &*rect : nullptr;
     }
 
-    bool Rect::isVisible() const
+    std::vector<std::shared_ptr<Rect>> RectSymbolTable::build(const Vec2i &dimension, const std::vector<std::string> &pattern) const
     {
-        return visible;
+        std::vector<std::shared_ptr<Rect>> res;
+        if (pattern.size() != dimension.getY())
+            throw std::invalid_argument("Rect data row dimension not match\nrequired: " + std::to_string(dimension.getY()) + " found:" + std::to_string(pattern.size()));
+        res.reserve((size_t)dimension.getX() * dimension.getY());
+        for (int i = 0; i < dimension.getY(); i++)
+        {
+            if (pattern[i].size() != dimension.getX())
+                throw std::invalid_argument("Rect data column dimension not match at row " + std::to_string(i) + "\nrequired: " + std::to_string(dimension.getX()) + " found:" + std::to_string(pattern[i].size()));
+            for (int j = 0; j < dimension.getX(); j++)
+            {
+                auto rect = find(pattern[i][j]);
+                if (!rect)
+                    throw std::invalid_argument("Invalid symbol '" + std::string(1, pattern[i][j]) + "'at position (" + std::to_string(j) + ", " + std::to_string(i) + ") in Rect data");
+                res.push_back(std::make_shared<Rect>(*rect));
+            }
+        }
+        return res;
     }
 
-    std::shared_ptr<RectEntity> Rect::getRectEntity() const
+    std::string Rect::getID() const
     {
-        return rectEntity;
+        return id;
     }
 
-    void Rect::markVisible()
+    int Rect::getMetadata() const
     {
-        visible = true;
+        return metadata;
+    }
+
+    std::shared_ptr<RectEntity> Rect::getRectEntity() const
+    {
+        return rectEntity;
     }
 
     bool Rect::traversable() const
@@ -1,8 +1,11 @@
 #ifndef FTK_RECT_H
 #define FTK_RECT_H
 
+#include <array>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include <nlohmann/adl_serializer.hpp>
 
@@ -37,6 +40,9 @@ namespace FTK
         RectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos);
         RectEntity(const RectEntity &other);
 
+        // a copy with the same uuid that shares nothing mutable with this one
+        virtual std::shared_ptr<RectEntity> clone() const;
+
         virtual void onInteract(const std::shared_ptr<Player> &ep);
 
         const uuids::uuid uuid;
@@ -57,6 +63,7 @@ namespace FTK
     public:
         ShopRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::shared_ptr<Inventory> inventory);
         ShopRectEntity(const ShopRectEntity &other);
+        std::shared_ptr<RectEntity> clone() const override;
         void onInteract(const std::shared_ptr<Player> &ep) override;
 
         std::shared_ptr<Inventory> getInventory() const;
@@ -79,6 +86,7 @@ namespace FTK
     public:
         RestRectEntity(const std::string &id, const std::string &name, RectEntityType type, const Vec2i &pos, const std::vector<std::shared_ptr<Action>> &restActions, const Math::Condition &restCondition);
         RestRectEntity(const RestRectEntity &other);
+        std::shared_ptr<RectEntity> clone() const override;
         void onInteract(const std::shared_ptr<Player> &ep) override;
 
     private:
@@ -96,16 +104,15 @@ namespace FTK
     {
     public:
         Rect(const std::string &id, int metadata);
-        Rect(const std::string &id, int metadata, bool visible);
         Rect(const Rect &other);
 
+        // unlike the copy constructor, keeps the rect entity
+        std::shared_ptr<Rect> clone() const;
+
         std::string getID() const;
         int getMetadata() const;
-        bool isVisible() const;
         std::shared_ptr<RectEntity> getRectEntity() const;
 
-        void markVisible();
-
         bool traversable() const;
         bool hasRectEntity() const;
 
@@ -117,11 +124,24 @@ namespace FTK
     private:
         std::string id;
         int metadata;
-        bool visible;
         std::shared_ptr<RectEntity> rectEntity;
 
         friend nlohmann::adl_serializer<Rect>;
     };
+
+    // The `key` of a world pattern, indexed by the symbol byte.
+    class RectSymbolTable
+    {
+    public:
+        void set(char symbol, const Rect &rect);
+        const Rect *find(char symbol) const;
+
+        // the rects of a pattern in row-major order, throws on a size mismatch or an unknown symbol
+        std::vector<std::shared_ptr<Rect>> build(const Vec2i &dimension, const std::vector<std::string> &pattern) const;
+
+    private:
+        std::array<std::optional<Rect>, 256> rects;
+    };
 } // namespace FTK
 
 #endif // FTK_RECT_H
@@ -1,5 +1,8 @@
 #include "Registry.h"
 
+#include <atomic>
+
+#include "GameSession.h"
 #include "Serializer.h"
 
 namespace FTK
@@ -13,9 +16,80 @@ namespace FTK
         save<EquipmentTemplate>(targetPath + "/equipment_templates.json", equipmentTemplates);
     }
 
+    static thread_local std::shared_ptr<MainRegistry> scoped;
+
+    MainRegistry::Scope::Scope(const std::shared_ptr<MainRegistry> &registry) : previous(scoped)
+    {
+        if (registry)
+            scoped = registry;
+    }
+
+    MainRegistry::Scope::~Scope()
+    {
+        scoped = previous;
+    }
+
+    static std::shared_ptr<MainRegistry> pinned;
+
     const std::shared_ptr<MainRegistry> MainRegistry::getInstance()
     {
-        static const auto instance = std::shared_ptr<MainRegistry>(new MainRegistry());
+        if (scoped)
+            return scoped;
+        if (auto session = GameSession::getCurrent())
+        {
+            if (auto registry = session->getRegistry())
+                return registry;
+        }
+        else if (pinned)
+            return pinned;
+        return getLatest();
+    }
+
+    const std::shared_ptr<MainRegistry> MainRegistry::getLatest()
+    {
+        return std::atomic_load(&current());
+    }
+
+    void MainRegistry::pin(const std::shared_ptr<MainRegistry> &registry)
+    {
+        if (auto session = GameSession::getCurrent())
+            session->setRegistry(registry);
+        else
+            pinned = registry;
+    }
+
+    std::shared_ptr<MainRegistry> MainRegistry::reloaded(const std::string &file) const
+    {
+        if (file == "active_skills.json")
+            return std::shared_ptr<MainRegistry>(new MainRegistry(activeSkills->reload(read<ActiveSkill>(file)), passiveSkills, buffTemplates, itemTemplates, equipmentTemplates));
+        if (file == "passive_skills.json")
+            return std::shared_ptr<MainRegistry>(new MainRegistry(activeSkills, passiveSkills->reload(read<PassiveSkill>(file)), buffTemplates, itemTemplates, equipmentTemplates));
+        if (file == "buff_templates.json")
+            return std::shared_ptr<MainRegistry>(new MainRegistry(activeSkills, passiveSkills, buffTemplates->reload(read<BuffTemplate>(file)), itemTemplates, equipmentTemplates));
+        if (file == "item_templates.json")
+            return std::shared_ptr<MainRegistry>(new MainRegistry(activeSkills, passiveSkills, buffTemplates, itemTemplates->reload(read<ItemTemplate>(file)), equipmentTemplates));
+        if (file == "equipment_templates.json")
+            return std::shared_ptr<MainRegistry>(new MainRegistry(activeSkills, passiveSkills, buffTemplates, itemTemplates, equipmentTemplates->reload(read<EquipmentTemplate>(file))));
+        return nullptr;
+    }
+
+    bool MainRegistry::reload(const std::string &file)
+    {
+        auto previous = getLatest();
+        while (true)
+        {
+            auto next = previous->reloaded(file);
+            if (!next)
+                return false;
+            // another reload published in between, read this file over its snapshot instead
+            if (std::atomic_compare_exchange_strong(&current(), &previous, next))
+                return true;
+        }
+    }
+
+    std::shared_ptr<MainRegistry> &MainRegistry::current()
+    {
+        static auto instance = std::shared_ptr<MainRegistry>(new MainRegistry());
 
         return instance;
     }
@@ -30,4 +104,17 @@ namespace FTK
     {
     }
 
+    MainRegistry::MainRegistry(const std::shared_ptr<Registry<ActiveSkill>> &activeSkills,
+                               const std::shared_ptr<Registry<PassiveSkill>> &passiveSkills,
+                               const std::shared_ptr<Registry<BuffTemplate>> &buffTemplates,
+                               const std::shared_ptr<Registry<ItemTemplate>> &itemTemplates,
+                               const std::shared_ptr<Registry<EquipmentTemplate>> &equipmentTemplates)
+        : activeSkills(activeSkills),
+          passiveSkills(passiveSkills),
+          buffTemplates(buffTemplates),
+          itemTemplates(itemTemplates),
+          equipmentTemplates(equipmentTemplates)
+    {
+    }
+
 } // namespace FTK
@@ -2,9 +2,11 @@
 #define FTK_REGISTRY_H
 
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 
@@ -22,7 +24,59 @@ namespace FTK
     class Registry : private std::vector<T>
     {
     public:
-        Registry(const Registry<T> &other) : std::vector<T>(other)
+        // walks the entries that can be found by id, in the order they were read
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T *;
+            using reference = const T &;
+
+            const_iterator(const Registry<T> *registry, std::vector<size_t>::const_iterator it) : registry(registry), it(it)
+            {
+            }
+
+            reference operator*() const
+            {
+                return registry->getByHandle(*it);
+            }
+
+            pointer operator->() const
+            {
+                return &registry->getByHandle(*it);
+            }
+
+            const_iterator &operator++()
+            {
+                ++it;
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                auto res = *this;
+                ++it;
+                return res;
+            }
+
+            bool operator==(const const_iterator &other) const
+            {
+                return it == other.it;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return it != other.it;
+            }
+
+        private:
+            const Registry<T> *registry;
+            std::vector<size_t>::const_iterator it;
+        };
+
+        Registry(const Registry<T> &other) : std::vector<T>(other), index(other.index), live(other.live)
         {
         }
 
@@ -35,29 +89,121 @@ namespace FTK
 
         T get(const std::string &id) const
         {
-            if (auto it = std::find_if(begin(), end(), [id](T v)
-                                       { return v.id == id; });
-                it != end())
-                return *it;
+            return getByHandle(getHandle(id));
+        }
+
+        // handles are positions in the registry, stable for as long as the registry lives
+        // and carried over to the registries reloaded from it
+        size_t getHandle(const std::string &id) const
+        {
+            if (auto it = index.find(id); it != index.end())
+                return it->second;
             throw std::invalid_argument("Object with id " + id + " not found.");
         }
 
-        using std::vector<T>::begin;
-        using std::vector<T>::empty;
-        using std::vector<T>::end;
-        using std::vector<T>::size;
+        const T &getByHandle(size_t handle) const
+        {
+            return std::vector<T>::at(handle);
+        }
+
+        bool contains(const std::string &id) const
+        {
+            return index.count(id);
+        }
+
+        // the registry read anew from values: known ids keep their handle and new ids get new ones;
+        // ids missing from values are removed, they are no longer found or iterated, only the handles
+        // live entities still hold resolve to their last definition
+        std::shared_ptr<Registry<T>> reload(const std::vector<T> &values) const
+        {
+            std::unordered_map<std::string, size_t> incoming;
+            for (size_t i = 0; i < values.size(); i++)
+                incoming.try_emplace(values[i].id, i);
+            std::vector<T> entries;
+            entries.reserve(std::vector<T>::size() + values.size());
+            for (auto &entry : static_cast<const std::vector<T> &>(*this))
+            {
+                auto it = incoming.find(entry.id);
+                entries.push_back(it != incoming.end() ? values[it->second] : entry);
+            }
+            std::unordered_map<std::string, size_t> reloadedIndex;
+            std::vector<size_t> reloadedLive;
+            for (auto &value : values)
+            {
+                if (reloadedIndex.count(value.id))
+                    continue;
+                size_t handle;
+                if (auto it = index.find(value.id); it != index.end())
+                    handle = it->second;
+                else
+                {
+                    handle = entries.size();
+                    entries.push_back(value);
+                }
+                reloadedIndex.emplace(value.id, handle);
+                reloadedLive.push_back(handle);
+            }
+            return std::shared_ptr<Registry<T>>(new Registry<T>(std::move(entries), std::move(reloadedIndex), std::move(reloadedLive)));
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, live.begin());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, live.end());
+        }
+
+        size_t size() const
+        {
+            return live.size();
+        }
+
+        bool empty() const
+        {
+            return live.empty();
+        }
 
     private:
         Registry(const std::vector<T> &values) : std::vector<T>(values)
+        {
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                index.try_emplace(values[i].id, i);
+                live.push_back(i);
+            }
+        }
+
+        Registry(std::vector<T> &&entries, std::unordered_map<std::string, size_t> &&index, std::vector<size_t> &&live)
+            : std::vector<T>(std::move(entries)), index(std::move(index)), live(std::move(live))
         {
         }
 
+        std::unordered_map<std::string, size_t> index;
+        // handles of the entries found by id, removed ones stay addressable by handle only
+        std::vector<size_t> live;
+
         friend nlohmann::adl_serializer<Registry<T>>;
     };
 
     class MainRegistry
     {
     public:
+        // makes getInstance() return registry on the calling thread, for work on a combat of another
+        // thread or session that must see the snapshot of that combat's turn; a null registry changes nothing
+        class Scope
+        {
+        public:
+            explicit Scope(const std::shared_ptr<MainRegistry> &registry);
+            Scope(const Scope &other) = delete;
+            ~Scope();
+
+        private:
+            std::shared_ptr<MainRegistry> previous;
+        };
+
         void exportAll(const std::string &targetPath) const;
 
         const std::shared_ptr<Registry<ActiveSkill>> activeSkills;
@@ -68,16 +214,49 @@ namespace FTK
         // const std::shared_ptr<Registry<PlayerTemplate>> playerTemplates;
         // const std::shared_ptr<Registry<EnemyTemplate>> enemyTemplates;
 
+        static constexpr const char *Directory = "assets/gamedata/";
+
+        // the snapshot of the innermost Scope on this thread, else the one pinned in the current session
+        // (or the process outside of sessions), else the latest one
         static const std::shared_ptr<MainRegistry> getInstance();
+        static const std::shared_ptr<MainRegistry> getLatest();
+        // keeps getInstance() on registry in the current session, or the process outside of sessions,
+        // until a null registry releases it; a combat pins the snapshot of its turn
+        static void pin(const std::shared_ptr<MainRegistry> &registry);
+
+        // this snapshot with one file of the gamedata directory read anew, sharing every other registry;
+        // null when the file holds no registry, throws when it does not parse
+        std::shared_ptr<MainRegistry> reloaded(const std::string &file) const;
+        // reloaded() of the latest snapshot, published as the latest; false when the file holds no registry,
+        // throws and keeps the current snapshot when it does not parse
+        static bool reload(const std::string &file);
 
     private:
         MainRegistry();
+        MainRegistry(const std::shared_ptr<Registry<ActiveSkill>> &activeSkills,
+                     const std::shared_ptr<Registry<PassiveSkill>> &passiveSkills,
+                     const std::shared_ptr<Registry<BuffTemplate>> &buffTemplates,
+                     const std::shared_ptr<Registry<ItemTemplate>> &itemTemplates,
+                     const std::shared_ptr<Registry<EquipmentTemplate>> &equipmentTemplates);
+
+        // swapped with std::atomic_load/std::atomic_store, snapshots themselves are never modified
+        static std::shared_ptr<MainRegistry> &current();
+
+        template <typename T>
+        static std::vector<T> read(const std::string &path)
+        {
+            std::ifstream ifs(Directory + path);
+            if (!ifs)
+                throw std::invalid_argument("Cannot open " + std::string(Directory) + path);
+            nlohmann::json j;
+            ifs >> j;
+            return j.get<std::vector<T>>();
+        }
 
         template <typename T>
         static std::shared_ptr<Registry<T>> load(const std::string &path)
         {
-            static const std::string prefix("assets/gamedata/");
-            std::ifstream ifs(prefix + path);
+            std::ifstream ifs(Directory + path);
             nlohmann::json j;
             ifs >> j;
             std::shared_ptr<Registry<T>> res = j;
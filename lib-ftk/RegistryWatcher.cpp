@@ -0,0 +1,139 @@
+#include "RegistryWatcher.h"
+
+#include <set>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace FTK
+{
+    RegistryWatcher::RegistryWatcher(std::chrono::milliseconds interval) : interval(interval)
+    {
+    }
+
+    RegistryWatcher::~RegistryWatcher()
+    {
+        stop();
+    }
+
+    void RegistryWatcher::setListener(const Listener &listener)
+    {
+        this->listener = listener;
+    }
+
+    void RegistryWatcher::start()
+    {
+        if (running)
+            return;
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+            throw std::system_error(errno, std::generic_category(), "inotify_init1");
+        // editors either rewrite the file in place or rename a temporary over it
+        if (inotify_add_watch(inotifyFd, MainRegistry::Directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            auto err = errno;
+            close(inotifyFd);
+            inotifyFd = -1;
+            throw std::system_error(err, std::generic_category(), "Cannot watch " + std::string(MainRegistry::Directory));
+        }
+#else
+        if (!std::filesystem::is_directory(MainRegistry::Directory))
+            throw std::invalid_argument("Cannot watch " + std::string(MainRegistry::Directory));
+        modified = scan();
+#endif
+        running = true;
+        thread = std::thread(&RegistryWatcher::run, this);
+    }
+
+    void RegistryWatcher::stop()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+#ifdef __linux__
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+        inotifyFd = -1;
+#endif
+    }
+
+    bool RegistryWatcher::isRunning() const
+    {
+        return running;
+    }
+
+#ifdef __linux__
+    void RegistryWatcher::run()
+    {
+        alignas(inotify_event) char buffer[4096];
+        while (running)
+        {
+            pollfd pfd{inotifyFd, POLLIN, 0};
+            // wakes up every interval to notice stop()
+            if (poll(&pfd, 1, static_cast<int>(interval.count())) <= 0)
+                continue;
+
+            // one save tends to raise several events, each file is parsed once per batch
+            std::set<std::string> changed;
+            ssize_t n;
+            while ((n = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char *p = buffer; p < buffer + n;)
+                {
+                    auto event = reinterpret_cast<inotify_event *>(p);
+                    if (event->len)
+                        changed.insert(event->name);
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            for (auto &file : changed)
+                reload(file);
+        }
+    }
+#else
+    void RegistryWatcher::run()
+    {
+        while (running)
+        {
+            std::this_thread::sleep_for(interval);
+            auto now = scan();
+            for (auto &[file, time] : now)
+                if (auto it = modified.find(file); it == modified.end() || it->second != time)
+                    reload(file);
+            modified = std::move(now);
+        }
+    }
+
+    std::map<std::string, std::filesystem::file_time_type> RegistryWatcher::scan() const
+    {
+        std::map<std::string, std::filesystem::file_time_type> res;
+        std::error_code ec;
+        for (auto &entry : std::filesystem::directory_iterator(MainRegistry::Directory, ec))
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".json")
+                res[entry.path().filename().string()] = entry.last_write_time(ec);
+        return res;
+    }
+#endif
+
+    void RegistryWatcher::reload(const std::string &file)
+    {
+        std::string error;
+        try
+        {
+            if (!MainRegistry::reload(file))
+                return;
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+        }
+        if (listener)
+            listener(file, error);
+    }
+} // namespace FTK
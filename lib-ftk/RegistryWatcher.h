@@ -0,0 +1,53 @@
+#ifndef FTK_REGISTRY_WATCHER_H
+#define FTK_REGISTRY_WATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "Registry.h"
+
+namespace FTK
+{
+    // Reloads a registry file of MainRegistry::Directory into MainRegistry whenever it is written.
+    // Linux is told about writes by inotify, other platforms poll modification times every interval.
+    // Only the changed file is parsed again; a file that fails to parse leaves the current snapshot in place.
+    class RegistryWatcher
+    {
+    public:
+        // called from the watcher thread after every reload, error is empty when it succeeded
+        using Listener = std::function<void(const std::string &file, const std::string &error)>;
+
+        explicit RegistryWatcher(std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+        RegistryWatcher(const RegistryWatcher &other) = delete;
+        ~RegistryWatcher();
+
+        void setListener(const Listener &listener);
+        // throws when the directory cannot be watched
+        void start();
+        void stop();
+        bool isRunning() const;
+
+    private:
+        void run();
+        void reload(const std::string &file);
+
+        std::chrono::milliseconds interval;
+        Listener listener;
+
+        std::thread thread;
+        std::atomic<bool> running = false;
+#ifdef __linux__
+        int inotifyFd = -1;
+#else
+        std::map<std::string, std::filesystem::file_time_type> modified;
+        std::map<std::string, std::filesystem::file_time_type> scan() const;
+#endif
+    };
+} // namespace FTK
+
+#endif // FTK_REGISTRY_WATCHER_H
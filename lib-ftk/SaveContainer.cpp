@@ -0,0 +1,412 @@
+#include "SaveContainer.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <CRC.h>
+
+#include "ByteIO.h"
+
+namespace FTK
+{
+    static const char SaveMagic[8] = {'F', 'T', 'K', 'S', 'A', 'V', 1, 0};
+
+    static constexpr size_t MinMatch = 4;
+    static constexpr size_t MaxOffset = 65535;
+    static constexpr int HashBits = 14;
+
+    static uint32_t crc32(const uint8_t *data, size_t size)
+    {
+        // table-driven, the parameters-only overload computes bit by bit
+        static const auto table = CRC::CRC_32().MakeTable();
+        return CRC::Calculate(data, size, table);
+    }
+
+    static uint32_t load32(const uint8_t *p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // a length past the 4 bits of a token, as LZ4 writes it: 255 while more follows
+    static void writeLength(std::vector<uint8_t> &out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((uint8_t)length);
+    }
+
+    static void writeSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        auto literalBits = std::min<size_t>(literalCount, 15);
+        auto matchBits = matchLength ? std::min<size_t>(matchLength - MinMatch, 15) : 0;
+        out.push_back((uint8_t)(literalBits << 4 | matchBits));
+        if (literalBits == 15)
+            writeLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        if (!matchLength)
+            return;
+        out.push_back((uint8_t)offset);
+        out.push_back((uint8_t)(offset >> 8));
+        if (matchBits == 15)
+            writeLength(out, matchLength - MinMatch - 15);
+    }
+
+    std::vector<uint8_t> SaveContainer::compress(const uint8_t *data, size_t size)
+    {
+        std::vector<uint8_t> out;
+        out.reserve(size / 2 + 16);
+        std::vector<size_t> table((size_t)1 << HashBits, SIZE_MAX);
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + MinMatch <= size)
+        {
+            auto sequence = load32(data + i);
+            auto hash = (sequence * 2654435761u) >> (32 - HashBits);
+            auto candidate = table[hash];
+            table[hash] = i;
+            if (candidate == SIZE_MAX || i - candidate > MaxOffset || load32(data + candidate) != sequence)
+            {
+                i++;
+                continue;
+            }
+            auto length = MinMatch;
+            while (i + length < size && data[candidate + length] == data[i + length])
+                length++;
+            writeSequence(out, data + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+        // the last sequence is literals only, the decoder knows it by reaching the end after them
+        writeSequence(out, data + anchor, size - anchor, 0, 0);
+        return out;
+    }
+
+    std::vector<uint8_t> SaveContainer::decompress(const uint8_t *data, size_t size, uint64_t rawSize)
+    {
+        // a byte of compressed data expands to at most 255 bytes, a larger size is a corrupted header
+        if (rawSize / 256 > size)
+            throw std::invalid_argument("Compressed section claims " + std::to_string(rawSize) + " bytes from " + std::to_string(size));
+        std::vector<uint8_t> out;
+        out.reserve(rawSize);
+        size_t i = 0;
+        auto readLength = [data, size, &i](size_t length)
+        {
+            uint8_t b;
+            do
+            {
+                if (i >= size)
+                    throw std::invalid_argument("Truncated compressed section");
+                b = data[i++];
+                length += b;
+            } while (b == 255);
+            return length;
+        };
+
+        while (i < size)
+        {
+            auto token = data[i++];
+            size_t literalCount = token >> 4;
+            if (literalCount == 15)
+                literalCount = readLength(literalCount);
+            if (literalCount > size - i || out.size() + literalCount > rawSize)
+                throw std::invalid_argument("Corrupted compressed section");
+            out.insert(out.end(), data + i, data + i + literalCount);
+            i += literalCount;
+            if (i == size)
+                break;
+
+            if (size - i < 2)
+                throw std::invalid_argument("Truncated compressed section");
+            size_t offset = data[i] | (size_t)data[i + 1] << 8;
+            i += 2;
+            size_t matchLength = (token & 0xF) + MinMatch;
+            if ((token & 0xF) == 15)
+                matchLength = readLength(matchLength);
+            if (!offset || offset > out.size() || out.size() + matchLength > rawSize)
+                throw std::invalid_argument("Corrupted compressed section");
+            // byte by byte, a match may overlap the bytes it produces
+            auto from = out.size() - offset;
+            for (size_t k = 0; k < matchLength; k++)
+                out.push_back(out[from + k]);
+        }
+        if (out.size() != rawSize)
+            throw std::invalid_argument("Compressed section has the wrong size");
+        return out;
+    }
+
+    void SaveContainer::put(const std::string &name, const std::string &raw)
+    {
+        Section section;
+        section.name = name;
+        section.rawSize = raw.size();
+        auto bytes = (const uint8_t *)raw.data();
+        section.data = compress(bytes, raw.size());
+        section.codec = Codec::LZ;
+        if (section.data.size() >= raw.size())
+        {
+            section.data.assign(bytes, bytes + raw.size());
+            section.codec = Codec::Stored;
+        }
+        section.storedSize = section.data.size();
+        section.crc = crc32(section.data.data(), section.data.size());
+
+        auto it = std::find_if(sections.begin(), sections.end(), [&name](const Section &s)
+                               { return s.name == name; });
+        if (it != sections.end())
+            *it = std::move(section);
+        else
+            sections.push_back(std::move(section));
+    }
+
+    bool SaveContainer::has(const std::string &name) const
+    {
+        return std::any_of(sections.begin(), sections.end(), [&name](const Section &s)
+                           { return s.name == name; });
+    }
+
+    std::string SaveContainer::get(const std::string &name) const
+    {
+        auto it = std::find_if(sections.begin(), sections.end(), [&name](const Section &s)
+                               { return s.name == name; });
+        if (it == sections.end())
+            throw std::invalid_argument("Save has no section " + name);
+        if (it->codec == Codec::Stored)
+            return std::string(it->data.begin(), it->data.end());
+        auto raw = decompress(it->data.data(), it->data.size(), it->rawSize);
+        return std::string(raw.begin(), raw.end());
+    }
+
+    const std::vector<SaveContainer::Section> &SaveContainer::getSections() const
+    {
+        return sections;
+    }
+
+    std::vector<uint8_t> SaveContainer::encode() const
+    {
+        std::vector<uint8_t> data(std::begin(SaveMagic), std::end(SaveMagic));
+        ByteWriter w(data);
+        w.writeVarint(sections.size());
+        for (auto &section : sections)
+        {
+            w.writeString(section.name);
+            data.push_back((uint8_t)section.codec);
+            w.writeVarint(section.rawSize);
+            w.writeVarint(section.storedSize);
+            w.writeU32(section.crc);
+        }
+        w.writeU32(crc32(data.data(), data.size()));
+        for (auto &section : sections)
+            data.insert(data.end(), section.data.begin(), section.data.end());
+        return data;
+    }
+
+    bool SaveContainer::readHeader(const std::vector<uint8_t> &data, uint64_t fileSize, Header &header)
+    {
+        if (data.size() < sizeof(SaveMagic) || std::memcmp(data.data(), SaveMagic, sizeof(SaveMagic)))
+            throw std::invalid_argument("Not a save container");
+        header = {};
+        uint32_t crc = 0;
+        size_t end = 0;
+        try
+        {
+            ByteReader r(data, sizeof(SaveMagic));
+            auto count = r.readVarint();
+            for (unsigned long long i = 0; i < count; i++)
+            {
+                Section section;
+                section.name = r.readString();
+                section.codec = (Codec)r.readBytes(1)[0];
+                section.rawSize = r.readVarint();
+                section.storedSize = r.readVarint();
+                section.crc = r.readU32();
+                header.sections.push_back(std::move(section));
+            }
+            end = r.getOffset();
+            crc = r.readU32();
+            header.payloadOffset = r.getOffset();
+        }
+        catch (const std::invalid_argument &)
+        {
+            if (data.size() < fileSize)
+                return false;
+            throw std::invalid_argument("Truncated save header");
+        }
+        if (crc != crc32(data.data(), end))
+            throw std::invalid_argument("Save header checksum mismatch");
+
+        uint64_t total = header.payloadOffset;
+        for (auto &section : header.sections)
+        {
+            if (section.codec != Codec::Stored && section.codec != Codec::LZ)
+                throw std::invalid_argument("Unknown codec of section " + section.name);
+            if (section.codec == Codec::Stored && section.rawSize != section.storedSize)
+                throw std::invalid_argument("Stored section " + section.name + " has mismatched sizes");
+            // compared before adding, a crafted size must not wrap the total around
+            if (section.storedSize > fileSize - total)
+                throw std::invalid_argument("Truncated save, section " + section.name + " ends past " + std::to_string(fileSize) + " bytes");
+            total += section.storedSize;
+        }
+        return true;
+    }
+
+    SaveContainer SaveContainer::decode(const std::vector<uint8_t> &data)
+    {
+        Header header;
+        readHeader(data, data.size(), header);
+        SaveContainer res;
+        auto offset = header.payloadOffset;
+        for (auto &section : header.sections)
+        {
+            auto begin = data.begin() + offset;
+            section.data.assign(begin, begin + section.storedSize);
+            offset += section.storedSize;
+            if (crc32(section.data.data(), section.data.size()) != section.crc)
+                throw std::invalid_argument("Checksum mismatch in section " + section.name);
+        }
+        res.sections = std::move(header.sections);
+        return res;
+    }
+
+    void SaveContainer::save(const std::string &path) const
+    {
+        if (!std::filesystem::exists(path) && std::filesystem::path(path).has_parent_path())
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+        auto data = encode();
+        auto tmp = path + ".tmp";
+        std::ofstream ofs(tmp, std::ios::binary);
+        ofs.write((const char *)data.data(), data.size());
+        ofs.close();
+        if (!ofs)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            throw std::invalid_argument("Cannot write save " + path);
+        }
+        std::filesystem::rename(tmp, path);
+    }
+
+    SaveContainer SaveContainer::load(const std::string &path)
+    {
+        return decode(readFile(path));
+    }
+
+    bool SaveContainer::isContainer(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        char magic[sizeof(SaveMagic)];
+        return ifs.read(magic, sizeof(magic)) && !std::memcmp(magic, SaveMagic, sizeof(SaveMagic));
+    }
+
+    bool SaveContainer::hasExtension(const std::string &path)
+    {
+        return std::filesystem::path(path).extension() == Extension;
+    }
+
+    std::vector<uint8_t> SaveContainer::readFile(const std::string &path)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs)
+            throw std::invalid_argument("Cannot open save " + path);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    }
+
+    SaveContainer::Header SaveContainer::readFileHeader(const std::string &path, uint64_t &fileSize)
+    {
+        std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+        if (!ifs)
+            throw std::invalid_argument("Cannot open save " + path);
+        fileSize = (uint64_t)ifs.tellg();
+        ifs.seekg(0);
+        // a header is a few dozen bytes per section, the first read is almost always enough
+        std::vector<uint8_t> data;
+        Header header;
+        for (uint64_t want = 4096;; want *= 4)
+        {
+            auto begin = data.size();
+            data.resize((size_t)std::min(want, fileSize));
+            if (!ifs.read((char *)data.data() + begin, data.size() - begin))
+                throw std::invalid_argument("Cannot read save " + path);
+            if (readHeader(data, fileSize, header))
+                return header;
+        }
+    }
+
+    SaveContainer::Report SaveContainer::check(const std::string &path, bool payloads)
+    {
+        Report report;
+        report.path = path;
+        try
+        {
+            if (payloads)
+            {
+                auto data = readFile(path);
+                report.fileSize = data.size();
+                Header header;
+                readHeader(data, data.size(), header);
+                auto offset = header.payloadOffset;
+                for (auto &section : header.sections)
+                {
+                    if (crc32(data.data() + offset, section.storedSize) != section.crc)
+                        throw std::invalid_argument("Checksum mismatch in section " + section.name);
+                    offset += section.storedSize;
+                }
+                report.sections = std::move(header.sections);
+            }
+            else
+                report.sections = readFileHeader(path, report.fileSize).sections;
+            report.valid = true;
+        }
+        catch (const std::exception &e)
+        {
+            report.error = e.what();
+        }
+        return report;
+    }
+
+    SaveContainer::Report SaveContainer::verify(const std::string &path)
+    {
+        return check(path, true);
+    }
+
+    SaveContainer::Report SaveContainer::list(const std::string &path)
+    {
+        return check(path, false);
+    }
+
+    static std::vector<SaveContainer::Report> checkAll(const std::vector<std::string> &paths, size_t jobs, SaveContainer::Report (*check)(const std::string &))
+    {
+        std::vector<SaveContainer::Report> reports(paths.size());
+        std::atomic<size_t> next = 0;
+        auto work = [&]()
+        {
+            for (size_t i; (i = next++) < paths.size();)
+                reports[i] = check(paths[i]);
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(std::max<size_t>(jobs, 1), paths.size()); i++)
+            workers.emplace_back(work);
+        work();
+        for (auto &w : workers)
+            w.join();
+        return reports;
+    }
+
+    std::vector<SaveContainer::Report> SaveContainer::verifyAll(const std::vector<std::string> &paths, size_t jobs)
+    {
+        return checkAll(paths, jobs, &SaveContainer::verify);
+    }
+
+    std::vector<SaveContainer::Report> SaveContainer::listAll(const std::vector<std::string> &paths, size_t jobs)
+    {
+        return checkAll(paths, jobs, &SaveContainer::list);
+    }
+} // namespace FTK
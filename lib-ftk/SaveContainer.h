@@ -0,0 +1,94 @@
+#ifndef FTK_SAVE_CONTAINER_H
+#define FTK_SAVE_CONTAINER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FTK
+{
+    // A binary save file of named sections, each stored LZ-compressed when that makes it smaller.
+    // The header lists every section with its sizes and the CRC32 of its stored bytes, and ends with a CRC32
+    // of its own, so a corrupted or truncated file is found by checksums alone, without decompressing or
+    // parsing anything. Saves written by GameManager hold a "world" and a "state" section of json.
+    class SaveContainer
+    {
+    public:
+        static constexpr const char *Extension = ".ftksave";
+
+        enum class Codec : uint8_t
+        {
+            Stored,
+            LZ
+        };
+
+        struct Section
+        {
+            std::string name;
+            Codec codec = Codec::Stored;
+            uint64_t rawSize = 0;
+            uint64_t storedSize = 0;
+            uint32_t crc = 0;
+            std::vector<uint8_t> data;
+        };
+
+        // a file checked by verify or list, sections come without their data
+        struct Report
+        {
+            std::string path;
+            bool valid = false;
+            std::string error;
+            uint64_t fileSize = 0;
+            std::vector<Section> sections;
+        };
+
+        void put(const std::string &name, const std::string &raw);
+        bool has(const std::string &name) const;
+        // throws when the section is missing or does not decompress to its recorded size
+        std::string get(const std::string &name) const;
+        const std::vector<Section> &getSections() const;
+
+        std::vector<uint8_t> encode() const;
+        // throws on a bad header, a truncated file or a section whose CRC does not match
+        static SaveContainer decode(const std::vector<uint8_t> &data);
+        // written next to path first and renamed over it, an existing save survives a failed write
+        void save(const std::string &path) const;
+        static SaveContainer load(const std::string &path);
+
+        // by the magic at the start of the file, whatever its extension
+        static bool isContainer(const std::string &path);
+        static bool hasExtension(const std::string &path);
+
+        // checks the header and the CRC of every section
+        static Report verify(const std::string &path);
+        // checks the header only
+        static Report list(const std::string &path);
+        // in the order of paths, spread over jobs threads
+        static std::vector<Report> verifyAll(const std::vector<std::string> &paths, size_t jobs = std::max(1u, std::thread::hardware_concurrency()));
+        static std::vector<Report> listAll(const std::vector<std::string> &paths, size_t jobs = std::max(1u, std::thread::hardware_concurrency()));
+
+        // an LZ77 codec in the style of LZ4: literal runs and matches of at least 4 bytes within 64 KiB
+        static std::vector<uint8_t> compress(const uint8_t *data, size_t size);
+        static std::vector<uint8_t> decompress(const uint8_t *data, size_t size, uint64_t rawSize);
+
+    private:
+        struct Header
+        {
+            std::vector<Section> sections;
+            size_t payloadOffset = 0;
+        };
+
+        // data is the start of a file of fileSize bytes, false when the header runs past it
+        static bool readHeader(const std::vector<uint8_t> &data, uint64_t fileSize, Header &header);
+        static Report check(const std::string &path, bool payloads);
+        static std::vector<uint8_t> readFile(const std::string &path);
+        // reads only as much of the file as the header takes
+        static Header readFileHeader(const std::string &path, uint64_t &fileSize);
+
+        std::vector<Section> sections;
+    };
+} // namespace FTK
+
+#endif // FTK_SAVE_CONTAINER_H
@@ -6,13 +6,16 @@
 #include <bimap.hpp>
 
 #include "utils.h"
+#include "IDSource.h"
 
 NLOHMANN_JSON_NAMESPACE_BEGIN
 
 NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(uuids::uuid)
 {
     // read from json, or generate a new one
-    return uuids::uuid::from_string(j.get<std::string>()).value_or(uuids::uuid_system_generator{}());
+    if (auto res = uuids::uuid::from_string(j.get<std::string>()))
+        return *res;
+    return FTK::IDSource::generate();
 }
 
 NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(uuids::uuid, uuid)
@@ -38,7 +41,7 @@ NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::Math::Expression)
 
 NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::Math::Expression, expression)
 {
-    j = expression.rawExpr;
+    j = expression.getRawExpr();
 }
 
 NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::Math::Condition)
@@ -48,7 +51,7 @@ NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::Math::Condition)
 
 NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::Math::Condition, condition)
 {
-    j = condition.rawExpr;
+    j = condition.getRawExpr();
 }
 
 NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::Modifier)
@@ -175,10 +178,10 @@ NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::Entity, entity)
     j["stats"] = entity.stats;
     j["pos"] = entity.pos;
     j["prev_pos"] = entity.prevPos;
-    if (entity.skillCD.size())
-        j["skill_cd"] = entity.skillCD;
+    if (auto skillCD = entity.getSkillCD(); skillCD.size())
+        j["skill_cd"] = skillCD;
     if (entity.buffs.size())
-        j["buffs"] = entity.buffs;
+        j["buffs"] = entity.viewBuffs();
     j["equipments"] = entity.equipments;
 }
 
@@ -208,11 +211,11 @@ NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(std::shared_ptr<FTK::Entity>)
 {
     // TODO better ways to deserialize polymorphically
     auto id = j["id"].get<std::string>();
-    if (isSerializedType("enemy") || id._Starts_with("enemy:"))
+    if (isSerializedType("enemy") || FTK::startsWith(id, "enemy:"))
         return j.get<std::shared_ptr<FTK::Enemy>>();
-    if (isSerializedType("player") || id._Starts_with("player:"))
+    if (isSerializedType("player") || FTK::startsWith(id, "player:"))
         return j.get<std::shared_ptr<FTK::Player>>();
-    if (isSerializedType("entity") || id._Starts_with("entity:"))
+    if (isSerializedType("entity") || FTK::startsWith(id, "entity:"))
         return std::make_shared<FTK::Entity>(j.get<FTK::Entity>());
     throw std::invalid_argument("Unknown serial type");
 }
@@ -349,27 +352,17 @@ NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::World)
 {
     const auto dimension = j["dimension"].get<FTK::Vec2i>();
     const auto pattern = j["pattern"].get<std::vector<std::string>>();
-    const auto key = j["key"].get<std::map<std::string, FTK::Rect>>();
-    const auto visibility = j.contains("visibility") ? j["visibility"].get<std::vector<std::string>>() : std::vector<std::string>(dimension.getY(), std::string(dimension.getX(), 'F'));
-
-    std::vector<std::shared_ptr<FTK::Rect>> rects;
-    if (pattern.size() != dimension.getY())
-        throw std::invalid_argument("Rect data row dimension not match\nrequired: " + std::to_string(dimension.getY()) + " found:" + std::to_string(pattern.size()));
-    for (int i = 0; i < dimension.getY(); i++)
-    {
-        if (pattern[i].size() != dimension.getX())
-            throw std::invalid_argument("Rect data column dimension not match at row " + std::to_string(i) + "\nrequired: " + std::to_string(dimension.getX()) + " found:" + std::to_string(pattern[i].size()));
-        for (int j = 0; j < dimension.getX(); j++)
-        {
-            auto symbol = std::string(1, pattern[i][j]);
-            if (!key.count(symbol))
-                throw std::invalid_argument("Invalid symbol '" + symbol + "'at position (" + std::to_string(j) + ", " + std::to_string(i) + ") in Rect data");
-            auto rect = std::make_shared<FTK::Rect>(key.at(symbol));
-            if (visibility[i][j] == 'T')
-                rect->markVisible();
-            rects.push_back(rect);
-        }
-    }
+    FTK::RectSymbolTable key;
+    for (auto &el : j["key"].items())
+        if (el.key().size() == 1)
+            key.set(el.key()[0], el.value().get<FTK::Rect>());
+    const auto visibility = j.contains("visibility_rle")
+                                ? FTK::VisibilityMap::decode(dimension, j["visibility_rle"].get<std::vector<size_t>>())
+                            : j.contains("visibility")
+                                ? FTK::VisibilityMap::fromRows(dimension, j["visibility"].get<std::vector<std::string>>())
+                                : FTK::VisibilityMap(dimension);
+
+    auto rects = key.build(dimension, pattern);
 
     const auto rectEntities = j["rect_entities"].get<std::vector<std::shared_ptr<FTK::RectEntity>>>();
     for (auto re : rectEntities)
@@ -380,7 +373,7 @@ NLOHMANN_JSON_ADL_DESERIALIZE_DEFINITION(FTK::World)
     const auto entities = j["entities"].get<std::vector<std::shared_ptr<FTK::Entity>>>();
     const auto players = j["players"].get<std::vector<std::shared_ptr<FTK::Player>>>();
 
-    return FTK::World(dimension, rects /*, {}*/, entities, players);
+    return FTK::World(dimension, rects /*, {}*/, entities, players, visibility);
 }
 
 NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::World, world)
@@ -394,19 +387,13 @@ NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::World, world)
 
     j["dimension"] = world.dimension;
     std::vector<std::string> pattern;
-    std::vector<std::string> visibility;
     std::vector<std::shared_ptr<FTK::RectEntity>> rectEntities;
     for (int i = 0; i < world.dimension.getY(); i++)
     {
         pattern.push_back({});
-        visibility.push_back({});
         for (int j = 0; j < world.dimension.getX(); j++)
         {
             auto cur = world.rects[i * world.dimension.getX() + j];
-            if (cur->isVisible())
-                visibility[i].push_back('T');
-            else
-                visibility[i].push_back('F');
             if (cur->hasRectEntity())
                 rectEntities.push_back(cur->getRectEntity());
             if (auto it = std::find_if(rectSymbolMap.begin(), rectSymbolMap.end(), [cur](auto p)
@@ -433,7 +420,7 @@ NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_DEFINITION(FTK::World, world)
     for (auto e : rectSymbolMap)
         key.emplace(std::string(1, e.first), e.second);
     j["key"] = key;
-    j["visibility"] = visibility;
+    j["visibility_rle"] = world.visibility.encode();
     j["rect_entities"] = rectEntities;
     j["entities"] = world.entities;
     j["players"] = world.players;
@@ -281,7 +281,7 @@ NLOHMANN_JSON_ADL_DESERIALIZE_TEMPLATE_DEFINITION(FTK::Registry, T)
 }
 NLOHMANN_ORDERED_JSON_ADL_SERIALIZE_TEMPLATE_DEFINITION(FTK::Registry, T, registry)
 {
-    j = std::vector<T>(registry);
+    j = std::vector<T>(registry.begin(), registry.end());
 }
 NLOHMANN_JSON_ADL_SERIALIZER_DECLARATION_END
 
@@ -0,0 +1,127 @@
+#include "SessionHost.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace FTK
+{
+    SessionHost::SessionHost(size_t workerCount)
+    {
+        for (size_t i = 0; i < std::max<size_t>(workerCount, 1); i++)
+            workers.emplace_back(&SessionHost::work, this);
+    }
+
+    SessionHost::~SessionHost()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto &t : workers)
+            t.join();
+    }
+
+    SessionHost::SessionID SessionHost::createSession()
+    {
+        return addSession(std::make_shared<GameSession>());
+    }
+
+    SessionHost::SessionID SessionHost::createSession(unsigned int seed)
+    {
+        return addSession(std::make_shared<GameSession>(seed));
+    }
+
+    void SessionHost::closeSession(SessionID id)
+    {
+        std::lock_guard lock(mutex);
+        slots.erase(id);
+    }
+
+    bool SessionHost::hasSession(SessionID id) const
+    {
+        std::lock_guard lock(mutex);
+        return slots.count(id);
+    }
+
+    size_t SessionHost::getSessionCount() const
+    {
+        std::lock_guard lock(mutex);
+        return slots.size();
+    }
+
+    size_t SessionHost::getWorkerCount() const
+    {
+        return workers.size();
+    }
+
+    std::future<void> SessionHost::submit(SessionID id, const Command &command)
+    {
+        std::lock_guard lock(mutex);
+        auto it = slots.find(id);
+        if (it == slots.end())
+            throw std::invalid_argument("Session " + std::to_string(id) + " does not exist");
+        auto slot = it->second;
+        std::packaged_task<void()> task([session = slot->session, command]()
+                                        {
+                                            GameSession::Scope scope(*session);
+                                            command(*session); });
+        auto res = task.get_future();
+        slot->commands.push_back(std::move(task));
+        if (!slot->scheduled)
+        {
+            slot->scheduled = true;
+            runQueue.push_back(slot);
+            ready.notify_one();
+        }
+        return res;
+    }
+
+    void SessionHost::wait()
+    {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this]()
+                  { return runQueue.empty() && !busy; });
+    }
+
+    SessionHost::SessionID SessionHost::addSession(const std::shared_ptr<GameSession> &session)
+    {
+        std::lock_guard lock(mutex);
+        auto slot = std::make_shared<Slot>();
+        slot->session = session;
+        slots.emplace(nextID, slot);
+        return nextID++;
+    }
+
+    void SessionHost::work()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            ready.wait(lock, [this]()
+                       { return stopping || !runQueue.empty(); });
+            if (runQueue.empty())
+                return;
+            auto slot = runQueue.front();
+            runQueue.pop_front();
+            auto task = std::move(slot->commands.front());
+            slot->commands.pop_front();
+            busy++;
+
+            lock.unlock();
+            task();
+            lock.lock();
+
+            busy--;
+            if (slot->commands.empty())
+                slot->scheduled = false;
+            else
+            {
+                runQueue.push_back(slot);
+                ready.notify_one();
+            }
+            if (runQueue.empty() && !busy)
+                idle.notify_all();
+        }
+    }
+} // namespace FTK
@@ -0,0 +1,71 @@
+#ifndef FTK_SESSION_HOST_H
+#define FTK_SESSION_HOST_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GameSession.h"
+
+namespace FTK
+{
+    // Runs many GameSessions on a fixed pool of worker threads.
+    // Commands submitted to one session run one after another in submission order, commands of
+    // different sessions run in parallel. A session with queued commands is rescheduled behind the
+    // other ready sessions after each command, so a busy session cannot starve the rest.
+    class SessionHost
+    {
+    public:
+        using SessionID = size_t;
+        using Command = std::function<void(GameSession &)>;
+
+        explicit SessionHost(size_t workerCount = std::max(1u, std::thread::hardware_concurrency()));
+        SessionHost(const SessionHost &other) = delete;
+        ~SessionHost();
+
+        SessionID createSession();
+        SessionID createSession(unsigned int seed);
+        // commands already queued for the session still run
+        void closeSession(SessionID id);
+
+        bool hasSession(SessionID id) const;
+        size_t getSessionCount() const;
+        size_t getWorkerCount() const;
+
+        // the future carries any exception thrown by the command
+        std::future<void> submit(SessionID id, const Command &command);
+        void wait();
+
+    private:
+        struct Slot
+        {
+            std::shared_ptr<GameSession> session;
+            std::deque<std::packaged_task<void()>> commands;
+            bool scheduled = false;
+        };
+
+        SessionID addSession(const std::shared_ptr<GameSession> &session);
+        void work();
+
+        mutable std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable idle;
+
+        std::map<SessionID, std::shared_ptr<Slot>> slots;
+        std::deque<std::shared_ptr<Slot>> runQueue;
+        SessionID nextID = 0;
+        size_t busy = 0;
+        bool stopping = false;
+
+        std::vector<std::thread> workers;
+    };
+} // namespace FTK
+
+#endif // FTK_SESSION_HOST_H
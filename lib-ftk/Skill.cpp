@@ -2,16 +2,20 @@
 
 namespace FTK
 {
-    Math::Context ActiveSkill::getContext(const std::string &key, const Math::Context &base)
+    void ActiveSkill::bindContext(const std::string &key, Math::Bindings &bindings) const
     {
-        auto res = base;
-        res[key] = Math::Context();
-        res[key]["skill_type"] = (int)skillType;
-        res[key]["target_type"] = (int)targetType;
-        res[key]["dice_rolls"] = diceRolls;
-        res[key]["allow_partial"] = allowPartial;
-        res["dice_rolls"] = diceRolls;
-        return res;
+        bindings.bind(key, [skillType = skillType, targetType = targetType, diceRolls = diceRolls, allowPartial = allowPartial](const std::string &field) -> cparse::packToken
+                      {
+                          if (field == "skill_type")
+                              return (int)skillType;
+                          if (field == "target_type")
+                              return (int)targetType;
+                          if (field == "dice_rolls")
+                              return diceRolls;
+                          if (field == "allow_partial")
+                              return allowPartial;
+                          return cparse::packToken::None(); });
+        bindings["dice_rolls"] = diceRolls;
     }
 
 } // namespace FTK
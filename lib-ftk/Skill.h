@@ -27,7 +27,8 @@ namespace FTK
         const size_t baseCooldown;
         const std::string description;
 
-        Math::Context getContext(const std::string &key, const Math::Context &base = Math::Context::default_global());
+        // binds key to the skill's types, dice and partial flag, and sets the plain dice_rolls
+        void bindContext(const std::string &key, Math::Bindings &bindings) const;
     };
 
     enum class PassiveTriggerType
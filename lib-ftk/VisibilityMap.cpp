@@ -0,0 +1,139 @@
+#include "VisibilityMap.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace FTK
+{
+    VisibilityMap::VisibilityMap(const Vec2i &dimension) : dimension(dimension), wordsPerRow((std::max(0, dimension.getX()) + 63) / 64)
+    {
+        bits.assign(wordsPerRow * std::max(0, dimension.getY()), 0);
+    }
+
+    bool VisibilityMap::isVisible(int x, int y) const
+    {
+        if (x < 0 || x >= dimension.getX() || y < 0 || y >= dimension.getY())
+            return false;
+        return bits[y * wordsPerRow + x / 64] >> (x % 64) & 1;
+    }
+
+    bool VisibilityMap::isVisible(const Vec2i &pos) const
+    {
+        return isVisible(pos.getX(), pos.getY());
+    }
+
+    size_t VisibilityMap::countVisible() const
+    {
+        size_t res = 0;
+        for (auto w : bits)
+            for (; w; w &= w - 1)
+                res++;
+        return res;
+    }
+
+    void VisibilityMap::markVisible(const Vec2i &pos)
+    {
+        markSpan(pos.getY(), pos.getX(), pos.getX());
+    }
+
+    void VisibilityMap::reveal(const Vec2i &center, int radius)
+    {
+        for (int dy = -radius; dy <= radius; dy++)
+        {
+            auto reach = radius - std::abs(dy);
+            markSpan(center.getY() + dy, center.getX() - reach, center.getX() + reach);
+        }
+    }
+
+    const std::vector<Vec2i> &VisibilityMap::getChangedCells() const
+    {
+        return changed;
+    }
+
+    void VisibilityMap::clearChangedCells()
+    {
+        changed.clear();
+    }
+
+    std::vector<size_t> VisibilityMap::encode() const
+    {
+        std::vector<size_t> runs{0};
+        bool current = false;
+        for (int y = 0; y < dimension.getY(); y++)
+            for (int x = 0; x < dimension.getX(); x++)
+            {
+                if (isVisible(x, y) != current)
+                {
+                    current = !current;
+                    runs.push_back(0);
+                }
+                runs.back()++;
+            }
+        return runs;
+    }
+
+    VisibilityMap VisibilityMap::decode(const Vec2i &dimension, const std::vector<size_t> &runs)
+    {
+        VisibilityMap res(dimension);
+        size_t cell = 0;
+        size_t total = (size_t)std::max(0, dimension.getX()) * std::max(0, dimension.getY());
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            if (cell + runs[i] > total)
+                throw std::invalid_argument("Visibility runs exceed the world dimension");
+            if (i % 2)
+                for (size_t k = cell; k < cell + runs[i]; k++)
+                    res.bits[k / dimension.getX() * res.wordsPerRow + k % dimension.getX() / 64] |= 1ull << (k % dimension.getX() % 64);
+            cell += runs[i];
+        }
+        return res;
+    }
+
+    std::vector<std::string> VisibilityMap::toRows() const
+    {
+        std::vector<std::string> res;
+        for (int y = 0; y < dimension.getY(); y++)
+        {
+            res.push_back({});
+            for (int x = 0; x < dimension.getX(); x++)
+                res.back().push_back(isVisible(x, y) ? 'T' : 'F');
+        }
+        return res;
+    }
+
+    VisibilityMap VisibilityMap::fromRows(const Vec2i &dimension, const std::vector<std::string> &rows)
+    {
+        VisibilityMap res(dimension);
+        for (int y = 0; y < std::min((int)rows.size(), dimension.getY()); y++)
+            for (int x = 0; x < std::min((int)rows[y].size(), dimension.getX()); x++)
+                if (rows[y][x] == 'T')
+                    res.bits[y * res.wordsPerRow + x / 64] |= 1ull << (x % 64);
+        return res;
+    }
+
+    void VisibilityMap::markSpan(int y, int x0, int x1)
+    {
+        if (y < 0 || y >= dimension.getY())
+            return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, dimension.getX() - 1);
+        if (x0 > x1)
+            return;
+        for (int word = x0 / 64; word <= x1 / 64; word++)
+        {
+            auto lo = std::max(x0, word * 64) - word * 64;
+            auto hi = std::min(x1, word * 64 + 63) - word * 64;
+            auto mask = (hi == 63 ? ~0ull : (1ull << (hi + 1)) - 1) & ~((1ull << lo) - 1);
+            auto &w = bits[y * wordsPerRow + word];
+            for (auto fresh = mask & ~w; fresh; fresh &= fresh - 1)
+            {
+                int bit = 0;
+                while (!(fresh >> bit & 1))
+                    bit++;
+                changed.emplace_back(word * 64 + bit, y);
+            }
+            w |= mask;
+        }
+    }
+} // namespace FTK
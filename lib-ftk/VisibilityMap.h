@@ -0,0 +1,49 @@
+#ifndef FTK_VISIBILITY_MAP_H
+#define FTK_VISIBILITY_MAP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    // Fog of war as one bit per cell, rows padded to whole 64-bit words.
+    // reveal() stamps a Manhattan diamond a row span at a time and records the cells that
+    // became visible, so a renderer can refresh only those.
+    class VisibilityMap
+    {
+    public:
+        explicit VisibilityMap(const Vec2i &dimension = Vec2i(0, 0));
+
+        bool isVisible(int x, int y) const;
+        bool isVisible(const Vec2i &pos) const;
+        size_t countVisible() const;
+
+        void markVisible(const Vec2i &pos);
+        void reveal(const Vec2i &center, int radius = 3);
+
+        const std::vector<Vec2i> &getChangedCells() const;
+        void clearChangedCells();
+
+        // alternating run lengths in row-major order, starting with a (possibly empty) hidden run
+        std::vector<size_t> encode() const;
+        static VisibilityMap decode(const Vec2i &dimension, const std::vector<size_t> &runs);
+
+        // the older save layout, one string of 'T'/'F' per row
+        std::vector<std::string> toRows() const;
+        static VisibilityMap fromRows(const Vec2i &dimension, const std::vector<std::string> &rows);
+
+        const Vec2i dimension;
+
+    private:
+        void markSpan(int y, int x0, int x1);
+
+        size_t wordsPerRow;
+        std::vector<uint64_t> bits;
+        std::vector<Vec2i> changed;
+    };
+} // namespace FTK
+
+#endif // FTK_VISIBILITY_MAP_H
@@ -1,17 +1,19 @@
 #include "World.h"
 
 #include "utils.h"
+#include "EventBus.h"
 namespace FTK
 {
-    World::World(const Vec2i &dimension) : World(dimension, {}, {}, {})
+    World::World(const Vec2i &dimension) : World(dimension, {}, {}, {}, VisibilityMap(dimension))
     {
         for (int i = 0; i < dimension.getY(); i++)
             for (int j = 0; j < dimension.getX(); j++)
                 rects.push_back(std::make_shared<Rect>("rect:path", 0));
     }
 
-    World::World(const World &other) : World(other.dimension, other.rects, other.entities, other.players)
+    World::World(const World &other) : World(other.dimension, other.rects, other.entities, other.players, other.visibility)
     {
+        chunkRevisions = other.chunkRevisions;
     }
 
     std::vector<std::shared_ptr<Player>> World::getPlayers() const
@@ -34,8 +36,11 @@ namespace FTK
 
     std::shared_ptr<Player> World::getPlayerByUUID(const uuids::uuid &uuid) const
     {
-        return getPlayerBy([uuid](auto ep)
-                           { return ep->uuid == uuid; });
+        if (!components.contains(uuid))
+            return nullptr;
+        if (auto handle = getHandle(uuid); handle.isPlayer())
+            return std::static_pointer_cast<Player>(handle.get());
+        return nullptr;
     }
 
     std::shared_ptr<Player> World::getPlayerByName(const std::string &name) const
@@ -58,14 +63,19 @@ namespace FTK
 
     std::vector<std::shared_ptr<Player>> World::getPlayersAt(const Vec2i &pos) const
     {
-        return filter(players, [pos](std::shared_ptr<Player> ep)
-                      { return ep->getPos() == pos; });
+        std::vector<std::shared_ptr<Player>> res;
+        components.forEachAt(pos, ComponentFlag_Player, ComponentFlag_Player, [&res](const EntityHandle &h)
+                             { res.push_back(std::static_pointer_cast<Player>(h.get())); });
+        return res;
     }
 
     std::shared_ptr<Entity> World::getEntityByUUID(const uuids::uuid &uuid) const
     {
-        return getEntityBy([uuid](auto ent)
-                           { return ent->uuid == uuid; });
+        if (!components.contains(uuid))
+            return nullptr;
+        if (auto handle = getHandle(uuid); !handle.isPlayer())
+            return handle.get();
+        return nullptr;
     }
 
     std::vector<std::shared_ptr<Entity>> World::getEntitiesAt(int x, int y) const
@@ -75,8 +85,58 @@ namespace FTK
 
     std::vector<std::shared_ptr<Entity>> World::getEntitiesAt(const Vec2i &pos) const
     {
-        return filter(entities, [pos](std::shared_ptr<Entity> e)
-                      { return e->getPos() == pos; });
+        std::vector<std::shared_ptr<Entity>> res;
+        components.forEachAt(pos, ComponentFlag_Player, ComponentFlag_None, [&res](const EntityHandle &h)
+                             { res.push_back(h.get()); });
+        return res;
+    }
+
+    void World::getPlayersInRadius(const Vec2i &center, int radius, std::vector<EntityHandle> &out) const
+    {
+        components.queryRadius(center, radius, ComponentFlag_Player, ComponentFlag_Player, out);
+    }
+
+    void World::getPlayersInRect(const Vec2i &min, const Vec2i &max, std::vector<EntityHandle> &out) const
+    {
+        components.queryRect(min, max, ComponentFlag_Player, ComponentFlag_Player, out);
+    }
+
+    void World::getEntitiesInRadius(const Vec2i &center, int radius, std::vector<EntityHandle> &out) const
+    {
+        components.queryRadius(center, radius, ComponentFlag_Player, ComponentFlag_None, out);
+    }
+
+    void World::getEntitiesInRect(const Vec2i &min, const Vec2i &max, std::vector<EntityHandle> &out) const
+    {
+        components.queryRect(min, max, ComponentFlag_Player, ComponentFlag_None, out);
+    }
+
+    const ComponentTable &World::getComponents() const
+    {
+        return components;
+    }
+
+    std::shared_ptr<Pathfinder> World::getPathfinder() const
+    {
+        return pathfinder;
+    }
+
+    size_t World::getTerrainVersion() const
+    {
+        return terrainVersion;
+    }
+
+    std::vector<EntityHandle> World::getHandlesAt(const Vec2i &pos) const
+    {
+        std::vector<EntityHandle> res;
+        components.forEachAt(pos, ComponentFlag_None, ComponentFlag_None, [&res](const EntityHandle &h)
+                             { res.push_back(h); });
+        return res;
+    }
+
+    EntityHandle World::getHandle(const uuids::uuid &uuid) const
+    {
+        return components.getHandle(components.indexOf(uuid));
     }
 
     std::shared_ptr<Rect> World::getRectAt(int x, int y) const
@@ -103,6 +163,40 @@ namespace FTK
         return getRectEntityAt(pos.getX(), pos.getY());
     }
 
+    const VisibilityMap &World::getVisibility() const
+    {
+        return visibility;
+    }
+
+    bool World::isVisible(int x, int y) const
+    {
+        return visibility.isVisible(x, y);
+    }
+
+    bool World::isVisible(const Vec2i &pos) const
+    {
+        return visibility.isVisible(pos);
+    }
+
+    void World::reveal(const Vec2i &center)
+    {
+        auto first = visibility.getChangedCells().size();
+        visibility.reveal(center);
+        auto bus = EventBus::getInstance();
+        for (auto i = first; i < visibility.getChangedCells().size(); i++)
+            bus->publish(RectRevealedEvent{visibility.getChangedCells()[i]});
+    }
+
+    const std::vector<Vec2i> &World::getVisibilityChanges() const
+    {
+        return visibility.getChangedCells();
+    }
+
+    void World::clearVisibilityChanges()
+    {
+        visibility.clearChangedCells();
+    }
+
     bool World::inBound(int x, int y) const
     {
         return x >= 0 && x < dimension.getX() && y >= 0 && y < dimension.getY();
@@ -113,9 +207,53 @@ namespace FTK
         return inBound(v.getX(), v.getY());
     }
 
+    size_t World::getChunkCount() const
+    {
+        return chunkRevisions.size();
+    }
+
+    size_t World::getChunkIndex(const Vec2i &pos) const
+    {
+        return pos.getY() / ChunkSize * getChunkColumns(dimension) + pos.getX() / ChunkSize;
+    }
+
+    uint64_t World::getChunkRevision(size_t chunk) const
+    {
+        return chunkRevisions[chunk];
+    }
+
+    std::vector<size_t> World::getChunkRectIndices(size_t chunk) const
+    {
+        return getChunkRectIndices(dimension, chunk);
+    }
+
+    void World::markRectChanged(const Vec2i &pos)
+    {
+        if (inBound(pos))
+            chunkRevisions[getChunkIndex(pos)] = nextRevision();
+    }
+
+    std::vector<size_t> World::getChunkRectIndices(const Vec2i &dimension, size_t chunk)
+    {
+        std::vector<size_t> res;
+        int x0 = chunk % getChunkColumns(dimension) * ChunkSize;
+        int y0 = chunk / getChunkColumns(dimension) * ChunkSize;
+        for (int y = y0; y < std::min(y0 + ChunkSize, dimension.getY()); y++)
+            for (int x = x0; x < std::min(x0 + ChunkSize, dimension.getX()); x++)
+                res.push_back(y * dimension.getX() + x);
+        return res;
+    }
+
+    int World::getChunkColumns(const Vec2i &dimension)
+    {
+        return (dimension.getX() + ChunkSize - 1) / ChunkSize;
+    }
+
     void World::addEntity(const std::shared_ptr<Entity> &e)
     {
         entities.push_back(e);
+        components.add(e);
+        terrainVersion++;
     }
 
     void World::removeEntity(const uuids::uuid &entityUUID)
@@ -125,12 +263,15 @@ namespace FTK
             it != entities.end())
         {
             entities.erase(it);
+            components.remove(entityUUID);
+            terrainVersion++;
         }
     }
 
     void World::addPlayer(const std::shared_ptr<Player> &ep)
     {
         players.push_back(ep);
+        components.add(ep, ComponentFlag_Player);
     }
 
     void World::removePlayer(const uuids::uuid &playerUUID)
@@ -140,13 +281,18 @@ namespace FTK
             it != players.end())
         {
             players.erase(it);
+            components.remove(playerUUID);
         }
     }
 
     void World::addRectEntityAt(const std::shared_ptr<RectEntity> &re, int x, int y)
     {
         if (auto rect = getRectAt(x, y); rect)
+        {
             rect->attachRectEntity(re);
+            markRectChanged({x, y});
+            terrainVersion++;
+        }
     }
 
     void World::addRectEntityAt(const std::shared_ptr<RectEntity> &re, const Vec2i &pos)
@@ -157,7 +303,11 @@ namespace FTK
     void World::removeRectEntityAt(int x, int y)
     {
         if (auto rect = getRectAt(x, y); rect)
+        {
             rect->removeRectEntity();
+            markRectChanged({x, y});
+            terrainVersion++;
+        }
     }
 
     void World::removeRectEntityAt(const Vec2i &pos)
@@ -165,19 +315,20 @@ namespace FTK
         removeRectEntityAt(pos.getX(), pos.getY());
     }
 
-    World::World(const Vec2i &dimension, const std::vector<std::shared_ptr<Rect>> &rects, const std::vector<std::shared_ptr<Entity>> &entities, const std::vector<std::shared_ptr<Player>> &players)
-        : dimension(dimension), rects(rects), entities(entities), players(players)
+    World::World(const Vec2i &dimension, const std::vector<std::shared_ptr<Rect>> &rects, const std::vector<std::shared_ptr<Entity>> &entities, const std::vector<std::shared_ptr<Player>> &players, const VisibilityMap &visibility)
+        : dimension(dimension), rects(rects), entities(entities), players(players), visibility(visibility)
     {
+        pathfinder = std::make_shared<Pathfinder>(*this);
+        chunkRevisions.resize((size_t)getChunkColumns(dimension) * ((dimension.getY() + ChunkSize - 1) / ChunkSize));
+        for (auto &r : chunkRevisions)
+            r = nextRevision();
+        for (auto &e : this->entities)
+            components.add(e);
+        for (auto &ep : this->players)
+            components.add(ep, ComponentFlag_Player);
         for (auto ep : this->players)
-        {
-            auto ctr = ep->getPos();
-            for (auto offset : FTK::ManhattanDistanceOffsets)
-            {
-                auto target = ctr + offset;
-                if (inBound(target))
-                    getRectAt(target)->markVisible();
-            }
-        }
+            this->visibility.reveal(ep->getPos());
+        this->visibility.clearChangedCells();
     }
 
 } // namespace FTK
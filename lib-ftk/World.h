@@ -7,7 +7,10 @@
 #include <memory>
 
 #include "Vec.h"
+#include "ComponentTable.h"
+#include "Pathfinder.h"
 #include "Rect.h"
+#include "VisibilityMap.h"
 #include "Entity.h"
 
 namespace FTK
@@ -50,15 +53,44 @@ namespace FTK
         std::vector<std::shared_ptr<Entity>> getEntitiesAt(int x, int y) const;
         std::vector<std::shared_ptr<Entity>> getEntitiesAt(const Vec2i &pos) const;
 
+        void getPlayersInRadius(const Vec2i &center, int radius, std::vector<EntityHandle> &out) const;
+        void getPlayersInRect(const Vec2i &min, const Vec2i &max, std::vector<EntityHandle> &out) const;
+        void getEntitiesInRadius(const Vec2i &center, int radius, std::vector<EntityHandle> &out) const;
+        void getEntitiesInRect(const Vec2i &min, const Vec2i &max, std::vector<EntityHandle> &out) const;
+
+        const ComponentTable &getComponents() const;
+        std::shared_ptr<Pathfinder> getPathfinder() const;
+        size_t getTerrainVersion() const;
+        std::vector<EntityHandle> getHandlesAt(const Vec2i &pos) const;
+        EntityHandle getHandle(const uuids::uuid &uuid) const;
+
         std::shared_ptr<Rect> getRectAt(int x, int y) const;
         std::shared_ptr<Rect> getRectAt(const Vec2i &pos) const;
 
         std::shared_ptr<RectEntity> getRectEntityAt(int x, int y) const;
         std::shared_ptr<RectEntity> getRectEntityAt(const Vec2i &pos) const;
 
+        const VisibilityMap &getVisibility() const;
+        bool isVisible(int x, int y) const;
+        bool isVisible(const Vec2i &pos) const;
+        void reveal(const Vec2i &center);
+        const std::vector<Vec2i> &getVisibilityChanges() const;
+        void clearVisibilityChanges();
+
         bool inBound(int x, int y) const;
         bool inBound(const Vec2i &v) const;
 
+        // rects are grouped into ChunkSize x ChunkSize chunks, a chunk's revision changes with any rect in it
+        size_t getChunkCount() const;
+        size_t getChunkIndex(const Vec2i &pos) const;
+        uint64_t getChunkRevision(size_t chunk) const;
+        std::vector<size_t> getChunkRectIndices(size_t chunk) const;
+        void markRectChanged(const Vec2i &pos);
+
+        static std::vector<size_t> getChunkRectIndices(const Vec2i &dimension, size_t chunk);
+
+        static constexpr int ChunkSize = 16;
+
         void addEntity(const std::shared_ptr<Entity> &e);
         void removeEntity(const uuids::uuid &entityUUID);
 
@@ -71,7 +103,7 @@ namespace FTK
         void removeRectEntityAt(const Vec2i &pos);
 
     private:
-        World(const Vec2i &dimension, const std::vector<std::shared_ptr<Rect>> &rects, const std::vector<std::shared_ptr<Entity>> &entities, const std::vector<std::shared_ptr<Player>> &players);
+        World(const Vec2i &dimension, const std::vector<std::shared_ptr<Rect>> &rects, const std::vector<std::shared_ptr<Entity>> &entities, const std::vector<std::shared_ptr<Player>> &players, const VisibilityMap &visibility);
 
     public:
         Vec2i dimension;
@@ -79,6 +111,17 @@ namespace FTK
         std::vector<std::shared_ptr<Entity>> entities;
         std::vector<std::shared_ptr<Player>> players;
 
+    private:
+        ComponentTable components;
+        VisibilityMap visibility;
+        size_t terrainVersion = 0;
+        std::vector<uint64_t> chunkRevisions;
+        std::shared_ptr<Pathfinder> pathfinder;
+
+        static int getChunkColumns(const Vec2i &dimension);
+
+        friend class GameSnapshot;
+        friend class MapLoader;
         friend nlohmann::adl_serializer<World>;
     };
 } // namespace FTK
@@ -0,0 +1,214 @@
+#include "WorldGenerator.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+#include "defs.h"
+#include "IDSource.h"
+#include "Registry.h"
+#include "Serializer.h"
+
+namespace FTK
+{
+    struct AttributeRange
+    {
+        std::string name;
+        int min;
+        int max;
+    };
+
+    static const std::vector<AttributeRange> EnemyAttributeRanges{
+        {"max_hp", 20, 200},
+        {"p_atk", 1, 100},
+        {"p_def", 0, 50},
+        {"m_atk", 0, 30},
+        {"m_def", 0, 30},
+        {"hit_rate", 50, 100},
+        {"speed", 30, 80}};
+
+    static const std::vector<AttributeRange> PlayerAttributeRanges{
+        {"max_hp", 20, 40},
+        {"max_focus", 3, 6},
+        {"p_atk", 5, 25},
+        {"p_def", 0, 8},
+        {"m_atk", 0, 20},
+        {"m_def", 0, 5},
+        {"hit_rate", 10, 90},
+        {"speed", 30, 90}};
+
+    static const std::vector<std::string> EnemyIDs{
+        "enemy:generic_enemy",
+        "enemy:slime"};
+
+    WorldGenerator::WorldGenerator(const WorldGeneratorOptions &options) : options(options), state(options.seed)
+    {
+        if (options.dimension.getX() <= 0 || options.dimension.getY() <= 0)
+            throw std::invalid_argument("World dimension must be positive");
+    }
+
+    nlohmann::ordered_json WorldGenerator::generate()
+    {
+        state = options.seed;
+        const auto width = options.dimension.getX();
+        const auto height = options.dimension.getY();
+
+        std::vector<std::string> pattern(height, std::string(width, '.'));
+        for (auto &row : pattern)
+            for (auto &c : row)
+                if (nextBool(options.rockDensity))
+                    c = '#';
+
+        auto cells = pickFreeCells(pattern, options.playerCount + options.enemyCount + options.shopCount);
+        auto cell = cells.begin();
+
+        nlohmann::ordered_json world;
+        world["dimension"] = options.dimension;
+        world["pattern"] = pattern;
+        world["key"] = {{".", {{"id", "rect:grass"}, {"metadata", 0}}},
+                        {"#", {{"id", "rect:rock"}, {"metadata", 0}}}};
+
+        world["entities"] = nlohmann::ordered_json::array();
+        for (size_t i = 0; i < options.enemyCount; i++)
+            world["entities"].push_back(generateEntity(EnemyIDs[nextInt(0, (int)EnemyIDs.size() - 1)], "Enemy" + std::to_string(i + 1), *cell++, false));
+
+        world["rect_entities"] = nlohmann::ordered_json::array();
+        for (size_t i = 0; i < options.shopCount; i++)
+            world["rect_entities"].push_back(generateShop(i, *cell++));
+
+        world["players"] = nlohmann::ordered_json::array();
+        for (size_t i = 0; i < options.playerCount; i++)
+            world["players"].push_back(generateEntity("player:generic_player", "Role" + std::to_string(i + 1), *cell++, true));
+
+        nlohmann::ordered_json res;
+        res["world"] = world;
+        res["inventory"] = generateInventory(options.startingGold, options.startingItems, 0);
+        return res;
+    }
+
+    void WorldGenerator::generate(const std::string &path)
+    {
+        if (auto parent = std::filesystem::path(path).parent_path(); !parent.empty() && !std::filesystem::exists(parent))
+            std::filesystem::create_directories(parent);
+        std::ofstream ofs(path);
+        ofs << generate();
+    }
+
+    nlohmann::ordered_json WorldGenerator::generateEntity(const std::string &id, const std::string &name, const Vec2i &pos, bool player)
+    {
+        nlohmann::ordered_json res;
+        res["uuid"] = nextUUID();
+        res["id"] = id;
+        res["name"] = name;
+        res["attributes"] = nlohmann::ordered_json::array();
+        for (auto &range : player ? PlayerAttributeRanges : EnemyAttributeRanges)
+            res["attributes"].push_back({{"name", range.name}, {"base", nextInt(range.min, range.max)}});
+        res["pos"] = pos;
+
+        auto registry = MainRegistry::getInstance();
+
+        auto buffs = nlohmann::ordered_json::array();
+        std::vector<std::string> buffIDs;
+        for (auto &b : *registry->buffTemplates)
+            buffIDs.push_back(b.id);
+        for (size_t i = 0; i < options.maxBuffsPerEntity && !buffIDs.empty(); i++)
+            if (nextBool(options.buffChance))
+                buffs.push_back({{"uuid", nextUUID()}, {"id", buffIDs[nextInt(0, (int)buffIDs.size() - 1)]}, {"turns", nextInt(1, 5)}});
+        if (!buffs.empty())
+            res["buffs"] = buffs;
+
+        std::map<EquipmentType, std::vector<std::string>> bySlot;
+        for (auto &e : *registry->equipmentTemplates)
+            bySlot[e.equipmentType].push_back(e.id);
+        auto equipments = nlohmann::ordered_json::object();
+        for (auto slot : {EquipmentType::Weapon, EquipmentType::Armor, EquipmentType::Accessory})
+        {
+            auto &candidates = bySlot[slot];
+            if (!candidates.empty() && nextBool(options.equipmentChance))
+                equipments[nlohmann::ordered_json(slot).get<std::string>()] = {{"uuid", nextUUID()}, {"id", candidates[nextInt(0, (int)candidates.size() - 1)]}};
+        }
+        res["equipments"] = equipments;
+        return res;
+    }
+
+    nlohmann::ordered_json WorldGenerator::generateShop(size_t index, const Vec2i &pos)
+    {
+        nlohmann::ordered_json res;
+        res["uuid"] = nextUUID();
+        res["id"] = "re.shop:generated_shop_" + std::to_string(index + 1);
+        res["name"] = "Shop " + std::to_string(index + 1);
+        res["type"] = RectEntityType::Shop;
+        res["pos"] = pos;
+        res["inventory"] = generateInventory(0, 0, options.shopStock);
+        return res;
+    }
+
+    nlohmann::ordered_json WorldGenerator::generateInventory(int gold, size_t itemCount, size_t equipmentCount)
+    {
+        auto registry = MainRegistry::getInstance();
+
+        std::map<std::string, int> items;
+        std::vector<std::string> itemIDs;
+        for (auto &i : *registry->itemTemplates)
+            itemIDs.push_back(i.id);
+        for (size_t i = 0; i < itemCount && !itemIDs.empty(); i++)
+            items[itemIDs[nextInt(0, (int)itemIDs.size() - 1)]]++;
+
+        std::vector<std::string> equipmentIDs;
+        for (auto &e : *registry->equipmentTemplates)
+            equipmentIDs.push_back(e.id);
+
+        nlohmann::ordered_json res;
+        res["gold"] = gold;
+        res["items"] = nlohmann::ordered_json::array();
+        for (auto &p : items)
+            res["items"].push_back({{"id", p.first}, {"amount", p.second}});
+        res["equipments"] = nlohmann::ordered_json::array();
+        for (size_t i = 0; i < equipmentCount && !equipmentIDs.empty(); i++)
+            res["equipments"].push_back({{"uuid", nextUUID()}, {"id", equipmentIDs[nextInt(0, (int)equipmentIDs.size() - 1)]}});
+        return res;
+    }
+
+    std::vector<Vec2i> WorldGenerator::pickFreeCells(const std::vector<std::string> &pattern, size_t amount)
+    {
+        std::vector<Vec2i> cells;
+        for (int y = 0; y < (int)pattern.size(); y++)
+            for (int x = 0; x < (int)pattern[y].size(); x++)
+                if (pattern[y][x] == '.')
+                    cells.emplace_back(x, y);
+        if (cells.size() < amount)
+            throw std::invalid_argument("Not enough traversable cells (" + std::to_string(cells.size()) + ") to place " + std::to_string(amount) + " objects");
+
+        // partial Fisher-Yates, only the picked prefix is shuffled
+        for (size_t i = 0; i < amount; i++)
+            std::swap(cells[i], cells[i + nextInt(0, (int)(cells.size() - i - 1))]);
+        cells.resize(amount);
+        return cells;
+    }
+
+    uuids::uuid WorldGenerator::nextUUID()
+    {
+        auto high = next();
+        auto low = next();
+        return IDSource::fromBits(high, low);
+    }
+
+    // splitmix64, so the output only depends on the seed and not on the standard library in use
+    unsigned long long WorldGenerator::next()
+    {
+        state += 0x9E3779B97F4A7C15ull;
+        return SeededIDSource::mix(state);
+    }
+
+    int WorldGenerator::nextInt(int min, int max)
+    {
+        return min + (int)(next() % ((unsigned long long)((long long)max - min) + 1));
+    }
+
+    bool WorldGenerator::nextBool(double chance)
+    {
+        return nextInt(0, 999999) < chance * 1000000;
+    }
+} // namespace FTK
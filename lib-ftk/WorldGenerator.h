@@ -0,0 +1,58 @@
+#ifndef FTK_WORLD_GENERATOR_H
+#define FTK_WORLD_GENERATOR_H
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <uuid.h>
+
+#include "Vec.h"
+
+namespace FTK
+{
+    struct WorldGeneratorOptions
+    {
+        unsigned int seed = 0;
+        Vec2i dimension = Vec2i(140, 50);
+        double rockDensity = 0.15;
+        size_t shopCount = 1;
+        size_t shopStock = 5;
+        size_t enemyCount = 10;
+        size_t playerCount = 3;
+        double equipmentChance = 0.5;
+        double buffChance = 0.1;
+        size_t maxBuffsPerEntity = 2;
+        int startingGold = 0;
+        size_t startingItems = 0;
+    };
+
+    // Produces map documents in the same layout as assets/gamedata/demo_map.json,
+    // equipment and buffs are written unbuilt and get built by GameManager::loadMap.
+    // The same options (seed included) always produce the same document.
+    class WorldGenerator
+    {
+    public:
+        explicit WorldGenerator(const WorldGeneratorOptions &options);
+
+        nlohmann::ordered_json generate();
+        void generate(const std::string &path);
+
+    private:
+        nlohmann::ordered_json generateEntity(const std::string &id, const std::string &name, const Vec2i &pos, bool player);
+        nlohmann::ordered_json generateShop(size_t index, const Vec2i &pos);
+        nlohmann::ordered_json generateInventory(int gold, size_t itemCount, size_t equipmentCount);
+
+        std::vector<Vec2i> pickFreeCells(const std::vector<std::string> &pattern, size_t amount);
+
+        uuids::uuid nextUUID();
+        unsigned long long next();
+        int nextInt(int min, int max);
+        bool nextBool(double chance);
+
+        WorldGeneratorOptions options;
+        unsigned long long state;
+    };
+} // namespace FTK
+
+#endif // FTK_WORLD_GENERATOR_H
@@ -2,13 +2,17 @@
 
 #include <stack>
 
-#include <effolkronium/random.hpp>
-
 #include "utils.h"
+#include "AllocTracker.h"
+#include "CombatAI.h"
+#include "CommandLog.h"
 #include "Dice.h"
 #include "Registry.h"
 #include "GameManager.h"
 #include "Serializer.h"
+#include "EventBus.h"
+#include "GameSession.h"
+#include "Random.h"
 
 template <typename R, typename T>
 static std::vector<std::shared_ptr<R>> vectorCastSharedPtrTo(const std::vector<std::shared_ptr<T>> vec)
@@ -150,6 +154,13 @@ namespace FTK
 
     void CombatSystem::beginBattle(std::vector<std::shared_ptr<Player>> players, std::vector<std::shared_ptr<Enemy>> enemies, bool ambushFailed)
     {
+        CommandLog::Scope logScope(CommandType::BeginBattle,
+                                   map<uuids::uuid>(players, [](const std::shared_ptr<Player> &ep)
+                                                    { return ep->uuid; }),
+                                   map<uuids::uuid>(enemies, [](const std::shared_ptr<Enemy> &en)
+                                                    { return en->uuid; }),
+                                   ambushFailed);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::None)
         {
             reset();
@@ -161,12 +172,14 @@ namespace FTK
                 for (auto enm : this->enemies)
                     enm->addBuff(speedUp.build(2));
             }
-            combatState = CombatState::BeginRound;
+            setCombatState(CombatState::BeginRound);
         }
     }
 
     void CombatSystem::beginRound()
     {
+        CommandLog::Scope logScope(CommandType::CombatBeginRound);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::BeginRound)
         {
             actionPerformed.clear();
@@ -174,28 +187,31 @@ namespace FTK
                 actionPerformed.try_emplace(ent->uuid, 0);
             updatePriorities();
             round++;
-            combatState = CombatState::BeginTurn;
+            setCombatState(CombatState::BeginTurn);
         }
     }
 
     void CombatSystem::beginTurn()
     {
+        CommandLog::Scope logScope(CommandType::CombatBeginTurn);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::BeginTurn)
         {
+            pinRegistry(true);
             turn++;
             getCurrentEntity()->updateSkillCD();
             auto buffs = MainRegistry::getInstance()->buffTemplates;
-            for (auto b : getCurrentEntity()->getBuffs())
+            for (auto &b : getCurrentEntity()->viewBuffs())
             {
                 if (buffs->get(b.id).effectType == EffectType::SkipTurn)
                 {
-                    combatState = CombatState::EndTurn;
+                    setCombatState(CombatState::EndTurn);
                     return;
                 }
             }
 
             setActionSelectionType(ActionSelectionType::Skill);
-            combatState = CombatState::ChooseAction;
+            setCombatState(CombatState::ChooseAction);
             if (getCurrentEntity()->isEnemy())
                 chooseAction();
         }
@@ -203,8 +219,27 @@ namespace FTK
 
     void CombatSystem::chooseAction()
     {
+        CommandLog::Scope logScope(CommandType::ChooseAction);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::ChooseAction)
         {
+            if (getCurrentEntity()->isEnemy())
+            {
+                // a replay takes the choice the recorded game made, the search is not run again
+                CombatAI::Choice choice;
+                if (!CommandLog::takeChoice(choice.actionID, choice.target) && enemyAI)
+                {
+                    choice = enemyAI->decide(*this);
+                    if (!choice.actionID.empty())
+                        CommandLog::recordChoice(choice.actionID, choice.target);
+                }
+                if (!choice.actionID.empty())
+                {
+                    markActionSelected(choice.actionID);
+                    markTargetSelected(choice.target);
+                    return;
+                }
+            }
             selectSkill();
             selectTarget();
         }
@@ -212,10 +247,11 @@ namespace FTK
 
     void CombatSystem::selectSkill()
     {
+        CommandLog::Scope logScope(CommandType::SelectSkill);
         if (combatState == CombatState::ChooseAction && !actionCandidates.empty())
         {
             std::vector<std::string> box = actionCandidates;
-            effolkronium::random_static::shuffle(box);
+            Random::getInstance()->shuffle(box);
             selectedActionID = box.front();
             prepSelectTarget();
         }
@@ -223,21 +259,26 @@ namespace FTK
 
     void CombatSystem::selectTarget()
     {
+        CommandLog::Scope logScope(CommandType::SelectTarget);
         if (combatState == CombatState::ChooseAction && !targetCandidates.empty())
         {
             std::vector<uuids::uuid> box = targetCandidates;
-            effolkronium::random_static::shuffle(box);
+            Random::getInstance()->shuffle(box);
             selectedTarget = box.front();
         }
     }
 
     void CombatSystem::rollDice()
     {
+        CommandLog::Scope logScope(CommandType::RollDice);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::RollDice)
         {
             auto skillData = MainRegistry::getInstance()->activeSkills->get(selectedActionID);
             auto ent = getCurrentEntity();
-            auto rollChance = skillData.rollChanceExpr.eval(ent->getMathContext("self")) / 100;
+            Math::Bindings bindings;
+            ent->bindMathContext("self", bindings);
+            auto rollChance = skillData.rollChanceExpr.eval(bindings) / 100;
             auto diceRolls = skillData.diceRolls;
             if (skillData.id == "active:basic_attack")
                 diceRolls = ent->getWeaponDiceRoll();
@@ -247,6 +288,8 @@ namespace FTK
 
     void CombatSystem::resolveActions()
     {
+        CommandLog::Scope logScope(CommandType::ResolveActions);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::ResolveActions)
         {
             std::deque<std::deque<std::shared_ptr<ActionNode>>> actionGroups;
@@ -259,6 +302,7 @@ namespace FTK
                     auto node = std::make_shared<ActionNode>();
                     node->action = act;
                     node->actionID = selectedActionID;
+                    node->actionSource = ActionSource::ActiveSkill;
                     node->source = getCurrentEntity();
                     node->target = getEntityByUUID(selectedTarget);
                     node->mainTarget = getEntityByUUID(selectedTarget);
@@ -275,6 +319,7 @@ namespace FTK
                     auto node = std::make_shared<ActionNode>();
                     node->action = act;
                     node->actionID = selectedActionID;
+                    node->actionSource = ActionSource::Item;
                     node->source = getCurrentEntity();
                     node->target = getEntityByUUID(selectedTarget);
                     node->mainTarget = getEntityByUUID(selectedTarget);
@@ -284,7 +329,7 @@ namespace FTK
             }
             if (auto buffs = MainRegistry::getInstance()->buffTemplates)
             {
-                for (auto b : getCurrentEntity()->getBuffs())
+                for (auto &b : getCurrentEntity()->viewBuffs())
                 {
                     std::deque<std::shared_ptr<ActionNode>> actions;
                     auto buff = buffs->get(b.id);
@@ -310,33 +355,41 @@ namespace FTK
                 }
                 actionGroupQueue.push_back(nodes);
             }
-            combatState = CombatState::ProcessActions;
+            setCombatState(CombatState::ProcessActions);
             processActions();
         }
     }
 
     void CombatSystem::processActions()
     {
+        CommandLog::Scope logScope(CommandType::ProcessActions);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::ProcessActions)
         {
             for (auto actionGroup : actionGroupQueue)
             {
                 ActionContext ctx;
-                ctx.mathContext = Math::Context::default_global();
-                for (auto action : actionGroup)
+                for (size_t i = 0; i < actionGroup.size();)
                 {
-                    processAction(action, ctx);
+                    auto count = getBatchSize(actionGroup, i);
+                    if (count > 1)
+                        processBatch(actionGroup, i, count, ctx);
+                    else
+                        processAction(actionGroup[i], ctx);
+                    i += count;
                 }
                 if (!actionGroup.empty() && actionGroup.front()->fromItem())
                     GameManager::getInstance()->getInventory()->removeItem(actionGroup.front()->actionID);
             }
             actionGroupQueue.clear();
-            combatState = CombatState::EndTurn;
+            setCombatState(CombatState::EndTurn);
         }
     }
 
     void CombatSystem::endTurn()
     {
+        CommandLog::Scope logScope(CommandType::CombatEndTurn);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::EndTurn)
         {
             actionPerformed[getCurrentEntity()->uuid]++;
@@ -392,32 +445,38 @@ namespace FTK
             diceRollResult = {};
 
             actionGroupQueue = {};
+            pinRegistry(false);
 
             if (shouldEndBattle() || shouldEndRound())
-                combatState = CombatState::EndRound;
+                setCombatState(CombatState::EndRound);
             else
             {
                 updatePriorities();
-                combatState = CombatState::BeginTurn;
+                setCombatState(CombatState::BeginTurn);
             }
+            AllocTracker::completeInterval(AllocTag::CombatTurn);
         }
     }
 
     void CombatSystem::endRound()
     {
+        CommandLog::Scope logScope(CommandType::CombatEndRound);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::EndRound)
         {
             if (shouldEndBattle())
-                combatState = CombatState::EndBattle;
+                setCombatState(CombatState::EndBattle);
             else
             {
-                combatState = CombatState::BeginRound;
+                setCombatState(CombatState::BeginRound);
             }
         }
     }
 
     void CombatSystem::endBattle()
     {
+        CommandLog::Scope logScope(CommandType::EndBattle);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (combatState == CombatState::EndBattle)
         {
             auto gameMgr = GameManager::getInstance();
@@ -439,21 +498,24 @@ namespace FTK
 
     void CombatSystem::setActionSelectionType(ActionSelectionType type)
     {
+        CommandLog::Scope logScope(CommandType::SetActionSelectionType, type);
         actionSelectionType = type;
         prepSelectAction();
     }
 
     void CombatSystem::prepSelectAction()
     {
+        CommandLog::Scope logScope(CommandType::PrepSelectAction);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         actionCandidates.clear();
         selectedActionID = {};
         if (actionSelectionType == ActionSelectionType::Skill)
         {
             auto ent = getCurrentEntity();
-            for (auto p : ent->getSkillCD())
+            for (auto &slot : ent->viewActiveSkills())
             {
-                if (p.first._Starts_with("active") && !p.second)
-                    actionCandidates.push_back(p.first);
+                if (!slot.cd)
+                    actionCandidates.push_back(slot.id);
             }
         }
         else if (actionSelectionType == ActionSelectionType::Item)
@@ -470,12 +532,15 @@ namespace FTK
 
     void CombatSystem::markActionSelected(const std::string &actionID)
     {
+        CommandLog::Scope logScope(CommandType::MarkActionSelected, actionID);
         selectedActionID = actionID;
         prepSelectTarget();
     }
 
     void CombatSystem::prepSelectTarget()
     {
+        CommandLog::Scope logScope(CommandType::PrepSelectTarget);
+        AllocTracker::Scope allocScope(AllocTag::CombatTurn);
         if (selectedActionID.empty())
             return;
         if (actionSelectionType == ActionSelectionType::Skill)
@@ -523,6 +588,7 @@ namespace FTK
 
     void CombatSystem::markTargetSelected(uuids::uuid uuid)
     {
+        CommandLog::Scope logScope(CommandType::MarkTargetSelected, uuid);
         selectedTarget = uuid;
     }
 
@@ -537,6 +603,7 @@ namespace FTK
 
     void CombatSystem::confirmChoice()
     {
+        CommandLog::Scope logScope(CommandType::ConfirmChoice);
         prepRollDice();
         if (getCurrentEntity()->isEnemy())
             rollDice();
@@ -544,18 +611,23 @@ namespace FTK
 
     void CombatSystem::prepRollDice()
     {
-        combatState = CombatState::RollDice;
+        CommandLog::Scope logScope(CommandType::PrepRollDice);
+        setCombatState(CombatState::RollDice);
     }
 
     void CombatSystem::markDiceRolled(size_t rolledAmount)
     {
-        diceRollResult = rolledAmount;
-        combatState = CombatState::ResolveActions;
+        CommandLog::Scope logScope(CommandType::MarkDiceRolled, rolledAmount);
+        if (combatState == CombatState::RollDice)
+        {
+            diceRollResult = rolledAmount;
+            setCombatState(CombatState::ResolveActions);
+        }
     }
 
     void CombatSystem::reset()
     {
-        combatState = CombatState::None;
+        setCombatState(CombatState::None);
         round = 0;
         turn = 0;
 
@@ -566,6 +638,7 @@ namespace FTK
         diceRollResult = 0;
 
         actionGroupQueue = {};
+        pinRegistry(false);
 
         playerDeaths.clear();
         enemyDeaths.clear();
@@ -577,6 +650,40 @@ namespace FTK
         enemies.clear();
     }
 
+    std::shared_ptr<CombatSystem> CombatSystem::fork() const
+    {
+        auto res = std::shared_ptr<CombatSystem>(new CombatSystem());
+        res->combatState = combatState;
+        res->round = round;
+        res->turn = turn;
+        res->actionSelectionType = actionSelectionType;
+        res->actionCandidates = actionCandidates;
+        res->selectedActionID = selectedActionID;
+        res->targetCandidates = targetCandidates;
+        res->selectedTarget = selectedTarget;
+        res->diceRollResult = diceRollResult;
+        res->playerDeaths = playerDeaths;
+        res->playersEscaped = playersEscaped;
+        res->enemyDeaths = enemyDeaths;
+        res->actionPerformed = actionPerformed;
+        res->priorities = priorities;
+        for (auto &ep : players)
+            res->players.push_back(std::static_pointer_cast<Player>(ep->clone()));
+        for (auto &en : enemies)
+            res->enemies.push_back(std::static_pointer_cast<Enemy>(en->clone()));
+        return res;
+    }
+
+    void CombatSystem::setEnemyAI(const std::shared_ptr<CombatAI> &ai)
+    {
+        enemyAI = ai;
+    }
+
+    std::shared_ptr<CombatAI> CombatSystem::getEnemyAI() const
+    {
+        return enemyAI;
+    }
+
     nlohmann::ordered_json CombatSystem::saveState()
     {
         auto res = nlohmann::ordered_json::object();
@@ -609,7 +716,7 @@ namespace FTK
         if (!j.empty())
         {
             reset();
-            combatState = j["combat_state"];
+            setCombatState(j["combat_state"].get<CombatState>());
             round = j["round"];
             turn = j["turn"];
             actionSelectionType = j["action_selection_type"];
@@ -637,13 +744,31 @@ namespace FTK
 
     std::shared_ptr<CombatSystem> CombatSystem::getInstance()
     {
+        if (auto session = GameSession::getCurrent())
+            return session->getCombatSystem();
         static auto instance = std::shared_ptr<CombatSystem>(new CombatSystem());
         return instance;
     }
 
+    void CombatSystem::pinRegistry(bool pinned)
+    {
+        if (getInstance().get() != this)
+            return;
+        MainRegistry::pin(nullptr);
+        if (pinned)
+            MainRegistry::pin(MainRegistry::getInstance());
+    }
+
+    void CombatSystem::setCombatState(CombatState state)
+    {
+        auto from = combatState;
+        combatState = state;
+        EventBus::getInstance()->publish(CombatStateChangedEvent{from, state});
+    }
+
     void CombatSystem::updatePriorities()
     {
-        static auto calcPri = [this](auto ent) -> int
+        auto calcPri = [this](auto ent) -> int
         {
             return (int)((actionPerformed[ent->uuid] + 1) / ent->get("speed") * 100);
         };
@@ -659,7 +784,7 @@ namespace FTK
                          { return (e1->get("p_atk") + e1->get("m_atk")) > (e2->get("p_atk") + e2->get("m_atk")); });
         std::stable_sort(ents.begin(), ents.end(), [](auto e1, auto e2)
                          { return e1->get("speed") > e2->get("speed"); });
-        std::stable_sort(ents.begin(), ents.end(), [](auto e1, auto e2)
+        std::stable_sort(ents.begin(), ents.end(), [&calcPri](auto e1, auto e2)
                          { return calcPri(e1) < calcPri(e2); });
 
         priorities = map<uuids::uuid>(ents, [](auto ent)
@@ -732,12 +857,11 @@ namespace FTK
         {
             auto collectPassives = [diceRolled, &cur, &passivesData](std::shared_ptr<Entity> ent, bool isTarget = false)
             {
-                auto passiveCDs = ent->getPassiveSkillCD();
-                for (auto p : passiveCDs)
+                for (auto &slot : ent->viewPassiveSkills())
                 {
-                    if (p.second)
+                    if (slot.cd)
                         continue;
-                    auto passive = passivesData->get(p.first);
+                    auto &passive = passivesData->getByHandle(slot.handle);
                     if ((passive.id != cur->actionID && (!passive.requireActiveSkill || cur->fromActiveSkill())))
                     {
 
@@ -751,6 +875,7 @@ namespace FTK
                                 node->target = {};
                             }
                             node->actionID = passive.id;
+                            node->actionSource = ActionSource::PassiveSkill;
                             node->parent = cur;
                             node->before.clear();
                             node->after.clear();
@@ -803,29 +928,29 @@ namespace FTK
     {
         if (!actionNode->parent)
         {
-            ctx.mathContext = actionNode->source->getMathContext("self", ctx.mathContext);
-            ctx.mathContext = actionNode->target->getMathContext("target", ctx.mathContext);
+            actionNode->source->bindMathContext("self", ctx.bindings);
+            actionNode->target->bindMathContext("target", ctx.bindings);
             if (actionNode->fromActiveSkill())
-                ctx.mathContext = MainRegistry::getInstance()->activeSkills->get(actionNode->actionID).getContext("skill", ctx.mathContext);
-            ctx.mathContext = actionNode->action->getContext("sourceAction", ctx.mathContext);
+                MainRegistry::getInstance()->activeSkills->get(actionNode->actionID).bindContext("skill", ctx.bindings);
+            actionNode->action->bindContext("sourceAction", ctx.bindings);
             if (actionNode->actionID == "active:basic_attack")
-                ctx.mathContext["dice_rolls"] = actionNode->source->getWeaponDiceRoll();
-            ctx.mathContext["rolled_result"] = diceRollResult;
+                ctx.bindings["dice_rolls"] = actionNode->source->getWeaponDiceRoll();
+            ctx.bindings["rolled_result"] = diceRollResult;
         }
 
         for (auto beforeAct : actionNode->before)
         {
-            ctx.mathContext = actionNode->action->getContext("sourceAction", ctx.mathContext);
+            actionNode->action->bindContext("sourceAction", ctx.bindings);
             processAction(beforeAct, ctx);
         }
 
-        ctx.mathContext = actionNode->source->getMathContext("self", ctx.mathContext);
-        ctx.mathContext = actionNode->target->getMathContext("target", ctx.mathContext);
+        actionNode->source->bindMathContext("self", ctx.bindings);
+        actionNode->target->bindMathContext("target", ctx.bindings);
         if (actionNode->fromActiveSkill())
         {
-            ctx.mathContext = MainRegistry::getInstance()->activeSkills->get(actionNode->actionID).getContext("skill", ctx.mathContext);
+            MainRegistry::getInstance()->activeSkills->get(actionNode->actionID).bindContext("skill", ctx.bindings);
             if (actionNode->actionID == "active:basic_attack")
-                ctx.mathContext["dice_rolls"] = actionNode->source->getWeaponDiceRoll();
+                ctx.bindings["dice_rolls"] = actionNode->source->getWeaponDiceRoll();
         }
         if (actionNode->fromPassiveSkill())
             ctx.condition = MainRegistry::getInstance()->passiveSkills->get(actionNode->actionID).condition;
@@ -857,19 +982,70 @@ namespace FTK
         }
     }
 
+    size_t CombatSystem::getBatchSize(const std::deque<std::shared_ptr<ActionNode>> &actionGroup, size_t index) const
+    {
+        auto isBatchable = [](const ActionNode &node)
+        {
+            return !node.parent && node.before.empty() && node.after.empty() && !node.fromPassiveSkill() && node.target != node.source;
+        };
+
+        auto &first = *actionGroup[index];
+        auto damageAction = std::dynamic_pointer_cast<DamageAction>(first.action);
+        if (!damageAction || damageAction->actionType != ActionType::Damage || !damageAction->canApplyBatch())
+            return 1;
+        if (damageAction->targetType != TargetType::Splash && damageAction->targetType != TargetType::SplashExcludingMain)
+            return 1;
+        if (!isBatchable(first))
+            return 1;
+        size_t count = 1;
+        while (index + count < actionGroup.size())
+        {
+            auto &node = *actionGroup[index + count];
+            if (node.action != first.action || node.actionID != first.actionID || node.actionSource != first.actionSource || node.source != first.source || !isBatchable(node))
+                break;
+            count++;
+        }
+        return count;
+    }
+
+    // processAction on each node, with the damage of all targets applied in one DamageAction::applyBatch
+    void CombatSystem::processBatch(const std::deque<std::shared_ptr<ActionNode>> &actionGroup, size_t index, size_t count, ActionContext &ctx)
+    {
+        auto &first = actionGroup[index];
+        auto damageAction = std::static_pointer_cast<DamageAction>(first->action);
+        std::vector<std::shared_ptr<Entity>> targets;
+        for (size_t i = index; i < index + count; i++)
+            targets.push_back(actionGroup[i]->target);
+
+        first->source->bindMathContext("self", ctx.bindings);
+        first->target->bindMathContext("target", ctx.bindings);
+        if (first->fromActiveSkill())
+            MainRegistry::getInstance()->activeSkills->get(first->actionID).bindContext("skill", ctx.bindings);
+        first->action->bindContext("sourceAction", ctx.bindings);
+        if (first->actionID == "active:basic_attack")
+            ctx.bindings["dice_rolls"] = first->source->getWeaponDiceRoll();
+        ctx.bindings["rolled_result"] = diceRollResult;
+        ctx.condition = Math::Condition("1");
+
+        if (damageAction->shouldHaveEffect(ctx, first->fromActiveSkill()))
+            damageAction->applyBatch(first->source, targets, ctx, first->fromActiveSkill());
+        if (first->fromActiveSkill())
+            first->source->resetSkillCD(first->actionID);
+    }
+
     bool ActionNode::fromActiveSkill() const
     {
-        return actionID._Starts_with("active");
+        return actionSource == ActionSource::ActiveSkill;
     }
 
     bool ActionNode::fromPassiveSkill() const
     {
-        return actionID._Starts_with("passive");
+        return actionSource == ActionSource::PassiveSkill;
     }
 
     bool ActionNode::fromItem() const
     {
-        return actionID._Starts_with("item");
+        return actionSource == ActionSource::Item;
     }
 
 } // namespace FTK
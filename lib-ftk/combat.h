@@ -12,10 +12,21 @@
 
 namespace FTK
 {
+    class CombatAI;
+
+    enum class ActionSource
+    {
+        None,
+        ActiveSkill,
+        PassiveSkill,
+        Item
+    };
+
     struct ActionNode
     {
         std::shared_ptr<Action> action;
         std::string actionID;
+        ActionSource actionSource = ActionSource::None;
         std::shared_ptr<Entity> source;
         std::shared_ptr<Entity> target;
         std::shared_ptr<Entity> mainTarget;
@@ -120,6 +131,14 @@ namespace FTK
 
         void reset();
 
+        // the running battle with every combatant cloned, to be played on without touching this one;
+        // only taken between actions, queued action nodes are not carried over
+        std::shared_ptr<CombatSystem> fork() const;
+
+        // picks the skills and targets of enemies, without one they choose at random
+        void setEnemyAI(const std::shared_ptr<CombatAI> &ai);
+        std::shared_ptr<CombatAI> getEnemyAI() const;
+
         nlohmann::ordered_json saveState();
         void retoreState(const nlohmann::json &j);
 
@@ -127,12 +146,21 @@ namespace FTK
 
     private:
         CombatSystem() = default;
+        friend class GameSession;
+        friend class GameSnapshot;
 
         void updatePriorities();
+        void setCombatState(CombatState state);
+        // pins the registry snapshot for the turn, null releases it; gamedata reloaded meanwhile is only
+        // seen from the next turn on. Only the session's own combat pins, forks are searched under MainRegistry::Scope
+        void pinRegistry(bool pinned);
 
         std::deque<std::shared_ptr<ActionNode>> resolveAction(const std::shared_ptr<ActionNode> &actionNode);
         void processAction(const std::shared_ptr<ActionNode> actionNode, ActionContext &ctx);
-        CombatState combatState;
+        // the nodes from index on that splash one damage action without passives around them, 1 when the node is processed alone
+        size_t getBatchSize(const std::deque<std::shared_ptr<ActionNode>> &actionGroup, size_t index) const;
+        void processBatch(const std::deque<std::shared_ptr<ActionNode>> &actionGroup, size_t index, size_t count, ActionContext &ctx);
+        CombatState combatState = CombatState::None;
         size_t round;
         size_t turn;
 
@@ -153,6 +181,8 @@ namespace FTK
         std::vector<uuids::uuid> priorities;
         std::vector<std::shared_ptr<Player>> players;
         std::vector<std::shared_ptr<Enemy>> enemies;
+
+        std::shared_ptr<CombatAI> enemyAI;
     };
 } // namespace FTK
 
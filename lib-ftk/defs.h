@@ -148,6 +148,8 @@ namespace FTK
         Vec2i(0, 1),
         Vec2i(-1, 0)};
 
+    constexpr const int BattleRadius = 3;
+
     constexpr const std::array<Vec2i, 25> ManhattanDistanceOffsets{
         // center
         Vec2i(0, 0),
@@ -1,6 +1,7 @@
 #include "utils.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
 
 namespace FTK
@@ -19,4 +20,15 @@ namespace FTK
         return res;
     }
 
+    bool startsWith(const std::string &str, const std::string &prefix)
+    {
+        return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    uint64_t nextRevision()
+    {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
 } // namespace FTK
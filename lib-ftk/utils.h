@@ -1,6 +1,7 @@
 #ifndef FTK_UTILS_H
 #define FTK_UTILS_H
 
+#include <cstdint>
 #include <string>
 
 namespace FTK
@@ -45,6 +46,11 @@ namespace FTK
 
     std::string toLower(const std::string &str);
     std::string toUpper(const std::string &str);
+
+    bool startsWith(const std::string &str, const std::string &prefix);
+
+    // process-wide increasing stamp, two objects carrying the same revision hold the same state
+    uint64_t nextRevision();
 } // namespace FTK
 
 #endif // FTK_UTILS_H